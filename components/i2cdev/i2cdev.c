@@ -36,17 +36,56 @@
 #include <freertos/task.h>
 #include <esp_log.h>
 #include "i2cdev.h"
+#if CONFIG_I2CDEV_MASTER_BUS
+#include <driver/i2c_master.h>
+#include <esp_attr.h>
+#endif
 
 static const char *TAG = "i2cdev";
 
+#if CONFIG_I2CDEV_MASTER_BUS
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 2, 0)
+#error "CONFIG_I2CDEV_MASTER_BUS needs ESP-IDF 5.2 or newer"
+#endif
+
+#define BUS_WRITE_MAX 64 // Register address and data of i2c_dev_write() together
+
+typedef struct {
+    uint16_t addr;
+    uint32_t clk_speed;
+    i2c_master_dev_handle_t handle;
+    SemaphoreHandle_t done;         // Taken while a transaction is in flight, given back by the completion callback
+    StaticSemaphore_t done_buf;
+    i2c_dev_trans_t *async;         // Transaction whose callback is due, NULL for a blocking one
+    esp_err_t result;
+} i2c_bus_dev_t;
+#endif
+
 typedef struct {
     SemaphoreHandle_t lock;
     i2c_config_t config;
     bool installed;
+    uint32_t generation;            // Bumped whenever the port is reconfigured
+    const i2c_dev_t *dev;           // Device the port was last set up for
+#if CONFIG_I2CDEV_MASTER_BUS
+    i2c_master_bus_handle_t bus;
+    i2c_bus_dev_t devices[CONFIG_I2CDEV_MASTER_BUS_DEVICES];
+#else
+    uint32_t timeout_ticks;         // Bus timeout last set on the port, 0 when unknown
+#endif
 } i2c_port_state_t;
 
 static i2c_port_state_t states[I2C_NUM_MAX];
 
+#if HELPER_TARGET_IS_ESP8266
+// The ESP8266 RTOS SDK has no command links in caller-provided buffers
+#define CMD_LINK_CREATE(buf) i2c_cmd_link_create()
+#define CMD_LINK_DELETE(cmd) i2c_cmd_link_delete(cmd)
+#else
+#define CMD_LINK_CREATE(buf) i2c_cmd_link_create_static(buf, sizeof(buf))
+#define CMD_LINK_DELETE(cmd) i2c_cmd_link_delete_static(cmd)
+#endif
+
 #if CONFIG_I2CDEV_NOLOCK
 #define SEMAPHORE_TAKE(port)
 #else
@@ -90,6 +129,22 @@ esp_err_t i2cdev_init()
     return ESP_OK;
 }
 
+#if CONFIG_I2CDEV_MASTER_BUS
+static void i2c_delete_bus(i2c_port_state_t *state)
+{
+    for (int i = 0; i < CONFIG_I2CDEV_MASTER_BUS_DEVICES; i++)
+    {
+        if (!state->devices[i].handle) continue;
+        i2c_master_bus_rm_device(state->devices[i].handle);
+        vSemaphoreDelete(state->devices[i].done);
+    }
+    memset(state->devices, 0, sizeof(state->devices));
+    i2c_del_master_bus(state->bus);
+    state->bus = NULL;
+    state->installed = false;
+}
+#endif
+
 esp_err_t i2cdev_done()
 {
     for (int i = 0; i < I2C_NUM_MAX; i++)
@@ -99,8 +154,13 @@ esp_err_t i2cdev_done()
         if (states[i].installed)
         {
             SEMAPHORE_TAKE(i);
+#if CONFIG_I2CDEV_MASTER_BUS
+            i2c_delete_bus(&states[i]);
+#else
             i2c_driver_delete(i);
             states[i].installed = false;
+#endif
+            states[i].generation++;
             SEMAPHORE_GIVE(i);
         }
 #if !CONFIG_I2CDEV_NOLOCK
@@ -173,11 +233,13 @@ esp_err_t i2c_dev_give_mutex(i2c_dev_t *dev)
     return ESP_OK;
 }
 
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+
 inline static bool cfg_equal(const i2c_config_t *a, const i2c_config_t *b)
 {
     return a->scl_io_num == b->scl_io_num
         && a->sda_io_num == b->sda_io_num
-#if HELPER_TARGET_IS_ESP32
+#if HELPER_TARGET_IS_ESP32 && !CONFIG_I2CDEV_MASTER_BUS
         && a->master.clk_speed == b->master.clk_speed
 #elif HELPER_TARGET_IS_ESP8266
         && ((a->clk_stretch_tick && a->clk_stretch_tick == b->clk_stretch_tick) 
@@ -188,6 +250,149 @@ inline static bool cfg_equal(const i2c_config_t *a, const i2c_config_t *b)
         && a->sda_pullup_en == b->sda_pullup_en;
 }
 
+#if CONFIG_I2CDEV_MASTER_BUS
+
+static bool IRAM_ATTR on_trans_done(i2c_master_dev_handle_t handle, const i2c_master_event_data_t *evt_data, void *arg)
+{
+    i2c_bus_dev_t *bus_dev = arg;
+    bus_dev->result = evt_data->event == I2C_EVENT_DONE ? ESP_OK
+        : evt_data->event == I2C_EVENT_NACK ? ESP_FAIL : ESP_ERR_TIMEOUT;
+
+    i2c_dev_trans_t *trans = bus_dev->async;
+    bus_dev->async = NULL;
+    if (trans && trans->cb)
+        trans->cb(trans, bus_dev->result, trans->cb_arg);
+
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(bus_dev->done, &woken);
+    return woken == pdTRUE;
+}
+
+// Creates the bus of the port, or recreates it when the pins changed. The clock speed belongs to the devices.
+static esp_err_t i2c_setup_bus(const i2c_dev_t *dev)
+{
+    if (dev->port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+
+    i2c_port_state_t *state = &states[dev->port];
+    if (state->installed && cfg_equal(&dev->cfg, &state->config))
+        return ESP_OK;
+
+    ESP_LOGD(TAG, "Reconfiguring I2C bus on port %d", dev->port);
+    if (state->installed)
+        i2c_delete_bus(state);
+
+    i2c_master_bus_config_t bus_cfg = {
+        .i2c_port = dev->port,
+        .sda_io_num = dev->cfg.sda_io_num,
+        .scl_io_num = dev->cfg.scl_io_num,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .trans_queue_depth = CONFIG_I2CDEV_MASTER_BUS_QUEUE_DEPTH,
+        .flags.enable_internal_pullup = dev->cfg.sda_pullup_en || dev->cfg.scl_pullup_en,
+    };
+    CHECK(i2c_new_master_bus(&bus_cfg, &state->bus));
+
+    state->installed = true;
+    state->generation++;
+    memcpy(&state->config, &dev->cfg, sizeof(i2c_config_t));
+    ESP_LOGD(TAG, "I2C bus successfully reconfigured on port %d", dev->port);
+    return ESP_OK;
+}
+
+// Finds the device on the bus of its port, or adds it
+static esp_err_t i2c_setup_bus_dev(const i2c_dev_t *dev, i2c_bus_dev_t **bus_dev)
+{
+    CHECK(i2c_setup_bus(dev));
+
+    i2c_port_state_t *state = &states[dev->port];
+    i2c_bus_dev_t *free_dev = NULL;
+    for (int i = 0; i < CONFIG_I2CDEV_MASTER_BUS_DEVICES; i++)
+    {
+        i2c_bus_dev_t *d = &state->devices[i];
+        if (d->handle && d->addr == dev->addr && d->clk_speed == dev->cfg.master.clk_speed)
+        {
+            *bus_dev = d;
+            state->dev = dev;
+            return ESP_OK;
+        }
+        if (!d->handle && !free_dev)
+            free_dev = d;
+    }
+    if (!free_dev)
+    {
+        ESP_LOGE(TAG, "[0x%02x at %d] No room for the device on the bus, see CONFIG_I2CDEV_MASTER_BUS_DEVICES",
+                dev->addr, dev->port);
+        return ESP_ERR_NO_MEM;
+    }
+
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = dev->addr,
+        .scl_speed_hz = dev->cfg.master.clk_speed,
+    };
+    CHECK(i2c_master_bus_add_device(state->bus, &dev_cfg, &free_dev->handle));
+
+    // Every transaction completes through the callback, blocking ones wait for it on `done`
+    free_dev->done = xSemaphoreCreateBinaryStatic(&free_dev->done_buf);
+    xSemaphoreGive(free_dev->done);
+    i2c_master_event_callbacks_t cbs = {
+        .on_trans_done = on_trans_done,
+    };
+    esp_err_t res = i2c_master_register_event_callbacks(free_dev->handle, &cbs, free_dev);
+    if (res != ESP_OK)
+    {
+        i2c_master_bus_rm_device(free_dev->handle);
+        memset(free_dev, 0, sizeof(i2c_bus_dev_t));
+        return res;
+    }
+
+    free_dev->addr = dev->addr;
+    free_dev->clk_speed = dev->cfg.master.clk_speed;
+    *bus_dev = free_dev;
+    state->dev = dev;
+    return ESP_OK;
+}
+
+// Queues a transfer, and waits for it unless `async` is given
+static esp_err_t i2c_bus_transfer(i2c_bus_dev_t *bus_dev, i2c_dev_trans_t *async, i2c_dev_trans_cb_t cb, void *arg,
+        const uint8_t *out_data, size_t out_size, uint8_t *in_data, size_t in_size)
+{
+    if (!xSemaphoreTake(bus_dev->done, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT)))
+        return ESP_ERR_TIMEOUT;
+
+    if (async)
+    {
+        async->cb = cb;
+        async->cb_arg = arg;
+    }
+    bus_dev->async = async;
+
+    esp_err_t res;
+    if (out_size && in_size)
+        res = i2c_master_transmit_receive(bus_dev->handle, out_data, out_size, in_data, in_size, CONFIG_I2CDEV_TIMEOUT);
+    else if (in_size)
+        res = i2c_master_receive(bus_dev->handle, in_data, in_size, CONFIG_I2CDEV_TIMEOUT);
+    else
+        res = i2c_master_transmit(bus_dev->handle, out_data, out_size, CONFIG_I2CDEV_TIMEOUT);
+
+    if (res != ESP_OK)
+    {
+        bus_dev->async = NULL;
+        xSemaphoreGive(bus_dev->done);
+        return res;
+    }
+    if (async)
+        return ESP_OK;
+
+    if (!xSemaphoreTake(bus_dev->done, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT)))
+        return ESP_ERR_TIMEOUT;
+    res = bus_dev->result;
+    xSemaphoreGive(bus_dev->done);
+    return res;
+}
+
+#else
+
 static esp_err_t i2c_setup_port(const i2c_dev_t *dev)
 {
     if (dev->port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
@@ -229,42 +434,97 @@ static esp_err_t i2c_setup_port(const i2c_dev_t *dev)
             return res;
 #endif
         states[dev->port].installed = true;
+        states[dev->port].timeout_ticks = 0;
+        states[dev->port].generation++;
 
         memcpy(&states[dev->port].config, &temp, sizeof(i2c_config_t));
         ESP_LOGD(TAG, "I2C driver successfully reconfigured on port %d", dev->port);
     }
 #if HELPER_TARGET_IS_ESP32
-    int t;
-    if ((res = i2c_get_timeout(dev->port, &t)) != ESP_OK)
-        return res;
+    // Only this function sets the timeout, so the one set last is known without asking the driver
     // Timeout cannot be 0
     uint32_t ticks = dev->timeout_ticks ? dev->timeout_ticks : I2CDEV_MAX_STRETCH_TIME;
-    if ((ticks != t) && (res = i2c_set_timeout(dev->port, ticks)) != ESP_OK)
-        return res;
-    ESP_LOGD(TAG, "Timeout: ticks = %" PRIu32 " (%" PRIu32 " usec) on port %d", dev->timeout_ticks, dev->timeout_ticks / 80, dev->port);
+    if (ticks != states[dev->port].timeout_ticks)
+    {
+        if ((res = i2c_set_timeout(dev->port, ticks)) != ESP_OK)
+            return res;
+        states[dev->port].timeout_ticks = ticks;
+        states[dev->port].generation++;
+        ESP_LOGD(TAG, "Timeout: ticks = %" PRIu32 " (%" PRIu32 " usec) on port %d", dev->timeout_ticks, dev->timeout_ticks / 80, dev->port);
+    }
 #endif
+    states[dev->port].dev = dev;
 
     return ESP_OK;
 }
 
+static esp_err_t i2c_build_cmd(i2c_cmd_handle_t cmd, const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size,
+        const void *out_data, size_t out_size, void *in_data, size_t in_size)
+{
+    if (!cmd) return ESP_ERR_NO_MEM;
+
+    if ((out_reg && out_reg_size) || (out_data && out_size))
+    {
+        CHECK(i2c_master_start(cmd));
+        CHECK(i2c_master_write_byte(cmd, dev->addr << 1, true));
+        if (out_reg && out_reg_size)
+            CHECK(i2c_master_write(cmd, (void *)out_reg, out_reg_size, true));
+        if (out_data && out_size)
+            CHECK(i2c_master_write(cmd, (void *)out_data, out_size, true));
+    }
+    if (in_data && in_size)
+    {
+        CHECK(i2c_master_start(cmd));
+        CHECK(i2c_master_write_byte(cmd, (dev->addr << 1) | 1, true));
+        CHECK(i2c_master_read(cmd, in_data, in_size, I2C_MASTER_LAST_NACK));
+    }
+    return i2c_master_stop(cmd);
+}
+
+// Builds the command link on the stack, so a one-off transaction does not allocate either
+static esp_err_t i2c_exec(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size,
+        const void *out_data, size_t out_size, void *in_data, size_t in_size)
+{
+    uint8_t link[I2CDEV_LINK_SIZE] = { 0 };
+    i2c_cmd_handle_t cmd = CMD_LINK_CREATE(link);
+
+    esp_err_t res = i2c_build_cmd(cmd, dev, out_reg, out_reg_size, out_data, out_size, in_data, in_size);
+    if (res == ESP_OK)
+        res = i2c_master_cmd_begin(dev->port, cmd, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT));
+
+    if (cmd)
+        CMD_LINK_DELETE(cmd);
+    return res;
+}
+
+#endif /* CONFIG_I2CDEV_MASTER_BUS */
+
 esp_err_t i2c_dev_probe(const i2c_dev_t *dev, i2c_dev_type_t operation_type)
 {
     if (!dev) return ESP_ERR_INVALID_ARG;
 
     SEMAPHORE_TAKE(dev->port);
 
+#if CONFIG_I2CDEV_MASTER_BUS
+    // The bus driver probes with an address-only write
+    esp_err_t res = i2c_setup_bus(dev);
+    if (res == ESP_OK)
+        res = i2c_master_probe(states[dev->port].bus, dev->addr, CONFIG_I2CDEV_TIMEOUT);
+#else
     esp_err_t res = i2c_setup_port(dev);
     if (res == ESP_OK)
     {
-        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+        uint8_t link[I2CDEV_LINK_SIZE] = { 0 };
+        i2c_cmd_handle_t cmd = CMD_LINK_CREATE(link);
         i2c_master_start(cmd);
         i2c_master_write_byte(cmd, dev->addr << 1 | (operation_type == I2C_DEV_READ ? 1 : 0), true);
         i2c_master_stop(cmd);
 
         res = i2c_master_cmd_begin(dev->port, cmd, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT));
 
-        i2c_cmd_link_delete(cmd);
+        CMD_LINK_DELETE(cmd);
     }
+#endif
 
     SEMAPHORE_GIVE(dev->port);
 
@@ -277,26 +537,20 @@ esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_si
 
     SEMAPHORE_TAKE(dev->port);
 
+#if CONFIG_I2CDEV_MASTER_BUS
+    i2c_bus_dev_t *bus_dev;
+    esp_err_t res = i2c_setup_bus_dev(dev, &bus_dev);
+    if (res == ESP_OK)
+    {
+        res = i2c_bus_transfer(bus_dev, NULL, NULL, NULL, out_data, out_data ? out_size : 0, in_data, in_size);
+#else
     esp_err_t res = i2c_setup_port(dev);
     if (res == ESP_OK)
     {
-        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-        if (out_data && out_size)
-        {
-            i2c_master_start(cmd);
-            i2c_master_write_byte(cmd, dev->addr << 1, true);
-            i2c_master_write(cmd, (void *)out_data, out_size, true);
-        }
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, (dev->addr << 1) | 1, true);
-        i2c_master_read(cmd, in_data, in_size, I2C_MASTER_LAST_NACK);
-        i2c_master_stop(cmd);
-
-        res = i2c_master_cmd_begin(dev->port, cmd, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT));
+        res = i2c_exec(dev, out_data, out_size, NULL, 0, in_data, in_size);
+#endif
         if (res != ESP_OK)
             ESP_LOGE(TAG, "Could not read from device [0x%02x at %d]: %d (%s)", dev->addr, dev->port, res, esp_err_to_name(res));
-
-        i2c_cmd_link_delete(cmd);
     }
 
     SEMAPHORE_GIVE(dev->port);
@@ -309,20 +563,31 @@ esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_re
 
     SEMAPHORE_TAKE(dev->port);
 
+#if CONFIG_I2CDEV_MASTER_BUS
+    i2c_bus_dev_t *bus_dev;
+    esp_err_t res = i2c_setup_bus_dev(dev, &bus_dev);
+    if (res == ESP_OK)
+    {
+        // The bus driver sends one buffer, so the register address goes in front of the data
+        uint8_t buf[BUS_WRITE_MAX];
+        if (!out_reg || !out_reg_size)
+            res = i2c_bus_transfer(bus_dev, NULL, NULL, NULL, out_data, out_size, NULL, 0);
+        else if (out_reg_size + out_size > sizeof(buf))
+            res = ESP_ERR_INVALID_SIZE;
+        else
+        {
+            memcpy(buf, out_reg, out_reg_size);
+            memcpy(buf + out_reg_size, out_data, out_size);
+            res = i2c_bus_transfer(bus_dev, NULL, NULL, NULL, buf, out_reg_size + out_size, NULL, 0);
+        }
+#else
     esp_err_t res = i2c_setup_port(dev);
     if (res == ESP_OK)
     {
-        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, dev->addr << 1, true);
-        if (out_reg && out_reg_size)
-            i2c_master_write(cmd, (void *)out_reg, out_reg_size, true);
-        i2c_master_write(cmd, (void *)out_data, out_size, true);
-        i2c_master_stop(cmd);
-        res = i2c_master_cmd_begin(dev->port, cmd, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT));
+        res = i2c_exec(dev, out_reg, out_reg_size, out_data, out_size, NULL, 0);
+#endif
         if (res != ESP_OK)
             ESP_LOGE(TAG, "Could not write to device [0x%02x at %d]: %d (%s)", dev->addr, dev->port, res, esp_err_to_name(res));
-        i2c_cmd_link_delete(cmd);
     }
 
     SEMAPHORE_GIVE(dev->port);
@@ -337,4 +602,110 @@ esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg, void *in_data, siz
 esp_err_t i2c_dev_write_reg(const i2c_dev_t *dev, uint8_t reg, const void *out_data, size_t out_size)
 {
     return i2c_dev_write(dev, &reg, 1, out_data, out_size);
-}
\ No newline at end of file
+}
+
+esp_err_t i2c_dev_trans_init(i2c_dev_trans_t *trans, const i2c_dev_t *dev, const void *out_data,
+        size_t out_size, void *in_data, size_t in_size)
+{
+    if (!trans || !dev || dev->port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    if ((out_size && !out_data) || (in_size && !in_data) || (!out_size && !in_size)) return ESP_ERR_INVALID_ARG;
+    if (out_size > I2CDEV_TRANS_MAX_OUT) return ESP_ERR_INVALID_SIZE;
+
+    memset(trans, 0, sizeof(i2c_dev_trans_t));
+    trans->dev = dev;
+    if (out_size)
+        memcpy(trans->out, out_data, out_size);
+    trans->out_size = out_size;
+    trans->in_data = in_data;
+    trans->in_size = in_size;
+    // Check the port setup on the first execution
+    trans->generation = states[dev->port].generation - 1;
+
+#if !CONFIG_I2CDEV_MASTER_BUS
+    trans->cmd = CMD_LINK_CREATE(trans->link);
+    esp_err_t res = i2c_build_cmd(trans->cmd, dev, NULL, 0, trans->out, out_size, in_data, in_size);
+    if (res != ESP_OK)
+    {
+        ESP_LOGE(TAG, "[0x%02x at %d] Could not build transaction: %d (%s)", dev->addr, dev->port, res, esp_err_to_name(res));
+        i2c_dev_trans_free(trans);
+        return res;
+    }
+#endif
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_trans_free(i2c_dev_trans_t *trans)
+{
+    if (!trans) return ESP_ERR_INVALID_ARG;
+
+#if !CONFIG_I2CDEV_MASTER_BUS
+    if (trans->cmd)
+        CMD_LINK_DELETE(trans->cmd);
+#endif
+    memset(trans, 0, sizeof(i2c_dev_trans_t));
+
+    return ESP_OK;
+}
+
+static esp_err_t i2c_trans_start(i2c_dev_trans_t *trans, bool async, i2c_dev_trans_cb_t cb, void *arg)
+{
+    const i2c_dev_t *dev = trans->dev;
+    i2c_port_state_t *state = &states[dev->port];
+
+    SEMAPHORE_TAKE(dev->port);
+
+    // Nothing changed on the port since the last execution, so the device is still set up
+    esp_err_t res = ESP_OK;
+    if (trans->generation != state->generation || state->dev != dev)
+    {
+#if CONFIG_I2CDEV_MASTER_BUS
+        i2c_bus_dev_t *bus_dev = NULL;
+        res = i2c_setup_bus_dev(dev, &bus_dev);
+        if (res == ESP_OK)
+            trans->bus_dev = bus_dev;
+#else
+        res = i2c_setup_port(dev);
+#endif
+        if (res == ESP_OK)
+            trans->generation = state->generation;
+    }
+
+    if (res == ESP_OK)
+    {
+#if CONFIG_I2CDEV_MASTER_BUS
+        res = i2c_bus_transfer(trans->bus_dev, async ? trans : NULL, cb, arg, trans->out, trans->out_size,
+                trans->in_data, trans->in_size);
+#else
+        res = i2c_master_cmd_begin(dev->port, trans->cmd, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT));
+#endif
+        if (res != ESP_OK)
+            ESP_LOGE(TAG, "Could not execute transaction with device [0x%02x at %d]: %d (%s)", dev->addr, dev->port, res, esp_err_to_name(res));
+    }
+
+    SEMAPHORE_GIVE(dev->port);
+    return res;
+}
+
+esp_err_t i2c_dev_trans_exec(i2c_dev_trans_t *trans)
+{
+    if (!trans || !trans->dev) return ESP_ERR_INVALID_ARG;
+
+    return i2c_trans_start(trans, false, NULL, NULL);
+}
+
+esp_err_t i2c_dev_trans_exec_async(i2c_dev_trans_t *trans, i2c_dev_trans_cb_t cb, void *arg)
+{
+    if (!trans || !trans->dev) return ESP_ERR_INVALID_ARG;
+
+#if CONFIG_I2CDEV_MASTER_BUS
+    return i2c_trans_start(trans, true, cb, arg);
+#else
+    trans->cb = cb;
+    trans->cb_arg = arg;
+    esp_err_t res = i2c_trans_start(trans, false, NULL, NULL);
+    if (cb)
+        cb(trans, res, arg);
+    return res;
+#endif
+}
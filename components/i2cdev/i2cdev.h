@@ -62,6 +62,20 @@ extern "C" {
 
 #endif /* HELPER_TARGET_IS_ESP8266 */
 
+#if HELPER_TARGET_IS_ESP8266
+#define I2CDEV_LINK_SIZE 1
+#else
+/**
+ * Size of a command link holding a write followed by a read, see ::i2c_dev_trans_t
+ */
+#define I2CDEV_LINK_SIZE I2C_LINK_RECOMMENDED_SIZE(2)
+#endif
+
+/**
+ * Most bytes a pre-built transaction sends, see ::i2c_dev_trans_init()
+ */
+#define I2CDEV_TRANS_MAX_OUT 8
+
 /**
  * I2C device descriptor
  */
@@ -84,6 +98,40 @@ typedef enum {
     I2C_DEV_READ       /**< Read operation */
 } i2c_dev_type_t;
 
+typedef struct i2c_dev_trans i2c_dev_trans_t;
+
+/**
+ * Completion callback of ::i2c_dev_trans_exec_async()
+ */
+typedef void (*i2c_dev_trans_cb_t)(i2c_dev_trans_t *trans, esp_err_t result, void *arg);
+
+/**
+ * Pre-built I2C transaction
+ *
+ * Holds everything needed to repeat the same transfer with a device, e.g. polling a sensor:
+ * the bytes to send, the command link built once in the descriptor itself, and the generation
+ * of the port setup it was last checked against. Executing it allocates nothing and skips
+ * the port configuration checks while no other device or configuration used the port.
+ * The descriptor must stay at the same address between ::i2c_dev_trans_init() and ::i2c_dev_trans_free().
+ */
+struct i2c_dev_trans
+{
+    const i2c_dev_t *dev;        //!< Device descriptor
+    uint8_t out[I2CDEV_TRANS_MAX_OUT]; //!< Bytes to send
+    size_t out_size;             //!< Number of bytes to send
+    void *in_data;               //!< Buffer the response is read into
+    size_t in_size;              //!< Number of bytes to read
+    uint32_t generation;         //!< Port setup generation the device was last checked at
+    i2c_dev_trans_cb_t cb;       //!< Completion callback of an asynchronous execution
+    void *cb_arg;                //!< Argument of the completion callback
+#if CONFIG_I2CDEV_MASTER_BUS
+    void *bus_dev;               //!< Device on the i2c_master bus
+#else
+    i2c_cmd_handle_t cmd;        //!< Command link, built in `link`
+    uint8_t link[I2CDEV_LINK_SIZE];
+#endif
+};
+
 /**
  * @brief Init library
  *
@@ -215,6 +263,58 @@ esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg,
 esp_err_t i2c_dev_write_reg(const i2c_dev_t *dev, uint8_t reg,
         const void *out_data, size_t out_size);
 
+/**
+ * @brief Build a transaction that can be executed repeatedly
+ *
+ * Writes \p out_size bytes from \p out_data (if any) followed by reading \p in_size
+ * bytes (if any) into \p in_data . The bytes to send are copied into the descriptor,
+ * \p in_data must stay valid for as long as the transaction is used.
+ *
+ * @param trans Transaction descriptor
+ * @param dev Device descriptor, must stay valid and unchanged while the transaction is used
+ * @param out_data Pointer to data to send if non-null, at most ::I2CDEV_TRANS_MAX_OUT bytes
+ * @param out_size Size of data to send
+ * @param[out] in_data Pointer to input data buffer if non-null
+ * @param in_size Number of bytes to read
+ * @return ESP_OK on success
+ */
+esp_err_t i2c_dev_trans_init(i2c_dev_trans_t *trans, const i2c_dev_t *dev, const void *out_data,
+        size_t out_size, void *in_data, size_t in_size);
+
+/**
+ * @brief Release a transaction built by ::i2c_dev_trans_init()
+ *
+ * @param trans Transaction descriptor
+ * @return ESP_OK on success
+ */
+esp_err_t i2c_dev_trans_free(i2c_dev_trans_t *trans);
+
+/**
+ * @brief Execute a pre-built transaction
+ *
+ * Function is thread-safe.
+ *
+ * @param trans Transaction descriptor
+ * @return ESP_OK on success
+ */
+esp_err_t i2c_dev_trans_exec(i2c_dev_trans_t *trans);
+
+/**
+ * @brief Start a pre-built transaction and return without waiting for it
+ *
+ * With CONFIG_I2CDEV_MASTER_BUS the transaction is queued on the i2c_master bus and \p cb
+ * is called from the I2C interrupt when it is done. It must be short and must not block.
+ * With the legacy driver the transaction is executed right away, \p cb is called
+ * before this function returns and the result is returned as well.
+ * Only one transaction per device can be in flight, a second one waits for the first.
+ *
+ * @param trans Transaction descriptor
+ * @param cb Completion callback, may be NULL
+ * @param arg Argument of the completion callback
+ * @return ESP_OK if the transaction was started (legacy driver: if it succeeded)
+ */
+esp_err_t i2c_dev_trans_exec_async(i2c_dev_trans_t *trans, i2c_dev_trans_cb_t cb, void *arg);
+
 #define I2C_DEV_TAKE_MUTEX(dev) do { \
         esp_err_t __ = i2c_dev_take_mutex(dev); \
         if (__ != ESP_OK) return __;\
@@ -1,3 +1,4 @@
+#include <string.h>
 #include "lv_qrcode.h"
 #include "qrcodegen.h"
 
@@ -29,6 +30,74 @@ lv_obj_t * lv_qrcode_create(lv_obj_t * parent, lv_coord_t size, lv_color_t dark_
 
 }
 
+/* Paint `len` pixels starting at `x` dark in a 1-bpp (MSB first) canvas row.
+ * Whole bytes are cleared at once, only the partial head and tail bytes are masked. */
+static void qrcode_row_set_dark(uint8_t * row, int32_t x, int32_t len)
+{
+    int32_t end = x + len - 1;
+    int32_t first = x >> 3;
+    int32_t last = end >> 3;
+    uint8_t head = 0xFF >> (x & 0x7);
+    uint8_t tail = (uint8_t)(0xFF << (7 - (end & 0x7)));
+
+    if(first == last) {
+        row[first] &= (uint8_t)~(head & tail);
+        return;
+    }
+
+    row[first] &= (uint8_t)~head;
+    if(last - first > 1) memset(row + first + 1, 0x00, last - first - 1);
+    row[last] &= (uint8_t)~tail;
+}
+
+/* Blit an encoded QR code into the canvas buffer, centered and scaled by the largest integer factor */
+static lv_res_t qrcode_render(lv_obj_t * qrcode, const uint8_t * qr)
+{
+    lv_img_dsc_t * imgdsc = lv_canvas_get_img(qrcode);
+    lv_coord_t obj_w = imgdsc->header.w;
+    int32_t qr_size = qrcodegen_getSize(qr);
+    int32_t scale = obj_w / qr_size;
+    int32_t scaled = qr_size * scale;
+    int32_t margin = (obj_w - scaled) / 2;
+    uint8_t * buf_u8 = (uint8_t *)imgdsc->data + 8;    /*+8 skip the palette*/
+    uint32_t row_byte_cnt = (obj_w + 7) >> 3;
+
+    /*Start from a light canvas (bit = 1 selects the light palette entry)*/
+    memset(buf_u8, 0xFF, row_byte_cnt * imgdsc->header.h);
+
+    if(scale == 0) {
+        lv_obj_invalidate(qrcode);
+        return LV_RES_INV;
+    }
+
+    /* Build the first pixel row of every module row from runs of dark modules,
+     * then copy it to the remaining `scale - 1` pixel rows */
+    int32_t my;
+    for(my = 0; my < qr_size; my++) {
+        uint8_t * row = buf_u8 + row_byte_cnt * (margin + my * scale);
+        int32_t mx = 0;
+        while(mx < qr_size) {
+            if(!qrcodegen_getModule(qr, mx, my)) {
+                mx++;
+                continue;
+            }
+
+            int32_t run_start = mx;
+            while(mx < qr_size && qrcodegen_getModule(qr, mx, my)) mx++;
+            qrcode_row_set_dark(row, margin + run_start * scale, (mx - run_start) * scale);
+        }
+
+        int32_t s;
+        for(s = 1; s < scale; s++) {
+            memcpy(row + row_byte_cnt * s, row, row_byte_cnt);
+        }
+    }
+
+    lv_obj_invalidate(qrcode);
+
+    return LV_RES_OK;
+}
+
 /**
  * Set the data of a QR code object
  * @param qrcode pointer to aQ code object
@@ -38,83 +107,65 @@ lv_obj_t * lv_qrcode_create(lv_obj_t * parent, lv_coord_t size, lv_color_t dark_
  */
 lv_res_t lv_qrcode_update(lv_obj_t * qrcode, const void * data, uint32_t data_len)
 {
-    lv_color_t c = { .full = 1 };
-    lv_canvas_fill_bg(qrcode, c, LV_OPA_COVER);
-
-    if(data_len > qrcodegen_BUFFER_LEN_FOR_VERSION(10)) return LV_RES_INV;
+    static lv_qrcode_cache_t default_cache = { .mask = qrcodegen_Mask_AUTO };
 
-    uint8_t *qr0 = malloc(qrcodegen_BUFFER_LEN_FOR_VERSION(10));
-    uint8_t *data_tmp = malloc(qrcodegen_BUFFER_LEN_FOR_VERSION(10));
-
-    memcpy(data_tmp, data, data_len);
+    return lv_qrcode_update_cached(qrcode, &default_cache, data, data_len);
+}
 
-    bool ok = qrcodegen_encodeBinary(data_tmp, data_len,
-            qr0, qrcodegen_Ecc_MEDIUM,
-            qrcodegen_VERSION_MIN, qrcodegen_VERSION_MAX,
-            qrcodegen_Mask_AUTO, true);
+/**
+ * Initialize a QR code cache
+ * @param cache pointer to the cache to initialize
+ * @param mask mask pattern to use, `qrcodegen_Mask_AUTO` evaluates all 8 masks on every encode
+ */
+void lv_qrcode_cache_init(lv_qrcode_cache_t * cache, enum qrcodegen_Mask mask)
+{
+    cache->payload_len = 0;
+    cache->mask = mask;
+    cache->valid = false;
+}
 
-    if (!ok) return LV_RES_INV;
+/**
+ * Set the data of a QR code object, encoding into the given cache instead of the heap.
+ * The encoder only runs when `data` differs from the payload already held by the cache.
+ * @param qrcode pointer to a QR code object
+ * @param cache pointer to an initialized cache
+ * @param data data to display
+ * @param data_len length of data in bytes
+ * @return LV_RES_OK: if no error; LV_RES_INV: on error
+ */
+lv_res_t lv_qrcode_update_cached(lv_obj_t * qrcode, lv_qrcode_cache_t * cache, const void * data, uint32_t data_len)
+{
+    bool hit = cache->valid && cache->payload_len == data_len && memcmp(cache->payload, data, data_len) == 0;
 
-    lv_img_dsc_t * imgdsc = lv_canvas_get_img(qrcode);
-    lv_coord_t obj_w = imgdsc->header.w;
-    int qr_size = qrcodegen_getSize(qr0);
-    int scale = obj_w / qr_size;
-    int scaled = qr_size * scale;
-    int margin = (obj_w - scaled) / 2;
-    uint8_t * buf_u8 = (uint8_t *)imgdsc->data + 8;    /*+8 skip the palette*/
+    if(!hit) {
+        cache->valid = false;
 
-    /* Copy the qr code canvas:
-     * A simple `lv_canvas_set_px` would work but it's slow for so many pixels.
-     * So buffer 1 byte (8 px) from the qr code and set it in the canvas image */
-    uint32_t row_byte_cnt = (imgdsc->header.w + 7) >> 3;
-    int y;
-    for (y = margin; y < scaled + margin; y+=scale) {
-        uint8_t b = 0;
-        uint8_t p = 0;
-        bool aligned = false;
-        int x;
-        for (x = margin; x < scaled + margin; x++) {
-            bool a = qrcodegen_getModule(qr0, (x - margin) / scale, (y - margin) / scale);
-
-            if(aligned == false && (x & 0x7) == 0) aligned = true;
-
-            if(aligned == false) {
-                c.full = a ? 0 : 1;
-                lv_canvas_set_px(qrcode, x, y, c);
-            } else {
-                if(!a) b |= (1 << (7 - p));
-                p++;
-                if(p == 8) {
-                    uint32_t px = row_byte_cnt * y + (x >> 3);
-                    buf_u8[px] = b;
-                    b = 0;
-                    p = 0;
-                }
-            }
+        if(data_len > LV_QRCODE_BUF_LEN) {
+            lv_color_t c = { .full = 1 };
+            lv_canvas_fill_bg(qrcode, c, LV_OPA_COVER);
+            return LV_RES_INV;
         }
 
-        /*Process the last byte of the row*/
-        if(p) {
-            /*Make the rest of the bits white*/
-            b |= (1 << (8 - p)) - 1;
+        /*The encoder uses the data buffer as scratch space, so encode from a copy*/
+        memcpy(cache->temp, data, data_len);
+
+        bool ok = qrcodegen_encodeBinary(cache->temp, data_len,
+                cache->qrcode, qrcodegen_Ecc_MEDIUM,
+                qrcodegen_VERSION_MIN, LV_QRCODE_MAX_VERSION,
+                cache->mask, true);
 
-            uint32_t px = row_byte_cnt * y + (x >> 3);
-            buf_u8[px] = b;
+        if(!ok) {
+            lv_color_t c = { .full = 1 };
+            lv_canvas_fill_bg(qrcode, c, LV_OPA_COVER);
+            return LV_RES_INV;
         }
 
-      /*The Qr is probably scaled so simply to the repeated rows*/
-      int s;
-      const uint8_t * row_ori = buf_u8 + row_byte_cnt * y;
-      for(s = 1; s < scale; s++) {
-          memcpy((uint8_t*)buf_u8 + row_byte_cnt * (y + s), row_ori, row_byte_cnt);
-      }
+        memcpy(cache->payload, data, data_len);
+        cache->payload_len = data_len;
+        cache->valid = true;
     }
 
-    // Cleanup before exiting
-    free(qr0);
-    free(data_tmp);
-
-    return LV_RES_OK;
+    return qrcode_render(qrcode, cache->qrcode);
 }
 
 /**
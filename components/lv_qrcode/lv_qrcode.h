@@ -1,4 +1,25 @@
 #include "lvgl.h"
+#include "qrcodegen.h"
+
+/* Highest QR version the encoder may pick. Version 10 at medium ECC holds 213 bytes,
+ * which is plenty for the provisioning and pairing payloads. */
+#define LV_QRCODE_MAX_VERSION   10
+#define LV_QRCODE_BUF_LEN       qrcodegen_BUFFER_LEN_FOR_VERSION(LV_QRCODE_MAX_VERSION)
+
+/**
+ * Caller-owned storage for encoding a QR code without heap allocations.
+ * The encoded matrix is kept together with its payload, so updating a QR code
+ * with the same data again only re-renders the canvas and skips the encoder.
+ * Usually declared `static` next to the screen that shows the QR code.
+ */
+typedef struct {
+    uint8_t qrcode[LV_QRCODE_BUF_LEN];      /*Encoded module matrix (qrcodegen format)*/
+    uint8_t temp[LV_QRCODE_BUF_LEN];        /*Encoder work area*/
+    uint8_t payload[LV_QRCODE_BUF_LEN];     /*Payload the matrix was encoded from*/
+    uint32_t payload_len;
+    enum qrcodegen_Mask mask;               /*Fixed mask, or qrcodegen_Mask_AUTO*/
+    bool valid;
+} lv_qrcode_cache_t;
 
 /**
  * Create an empty QR code (an `lv_canvas`) object.
@@ -19,6 +40,24 @@ lv_obj_t * lv_qrcode_create(lv_obj_t * parent, lv_coord_t size, lv_color_t dark_
  */
 lv_res_t lv_qrcode_update(lv_obj_t * qrcode, const void * data, uint32_t data_len);
 
+/**
+ * Initialize a QR code cache
+ * @param cache pointer to the cache to initialize
+ * @param mask mask pattern to use, `qrcodegen_Mask_AUTO` evaluates all 8 masks on every encode
+ */
+void lv_qrcode_cache_init(lv_qrcode_cache_t * cache, enum qrcodegen_Mask mask);
+
+/**
+ * Set the data of a QR code object, encoding into the given cache instead of the heap.
+ * The encoder only runs when `data` differs from the payload already held by the cache.
+ * @param qrcode pointer to a QR code object
+ * @param cache pointer to an initialized cache
+ * @param data data to display
+ * @param data_len length of data in bytes
+ * @return LV_RES_OK: if no error; LV_RES_INV: on error
+ */
+lv_res_t lv_qrcode_update_cached(lv_obj_t * qrcode, lv_qrcode_cache_t * cache, const void * data, uint32_t data_len);
+
 /**
  * Delete a QR code object
  * @param qrcode pointer to a QR code object
@@ -40,6 +40,7 @@
 #include <freertos/task.h>
 #include <esp_idf_lib_helpers.h>
 #include <esp_timer.h>
+#include <string.h>
 #include "sht4x.h"
 
 #define I2C_FREQ_HZ 1000000 // 1MHz
@@ -141,9 +142,26 @@ static inline esp_err_t send_cmd_nolock(sht4x_t *dev, uint8_t cmd)
     return i2c_dev_write(&dev->i2c_dev, NULL, 0, &cmd, 1);
 }
 
+// The measurement command only changes with the heater and repeatability settings, so it is
+// built once and rebuilt when they change
+static esp_err_t send_meas_cmd_nolock(sht4x_t *dev)
+{
+    uint8_t cmd = get_meas_cmd(dev);
+    if (!dev->meas_trans.dev || dev->meas_cmd != cmd)
+    {
+        i2c_dev_trans_free(&dev->meas_trans);
+        CHECK(i2c_dev_trans_init(&dev->meas_trans, &dev->i2c_dev, &cmd, 1, NULL, 0));
+        dev->meas_cmd = cmd;
+    }
+
+    ESP_LOGD(TAG, "Sending cmd %02x...", cmd);
+    return i2c_dev_trans_exec(&dev->meas_trans);
+}
+
 static inline esp_err_t read_res_nolock(sht4x_t *dev, sht4x_raw_data_t res)
 {
-    CHECK(i2c_dev_read(&dev->i2c_dev, NULL, 0, res, SHT4X_RAW_DATA_SIZE));
+    CHECK(i2c_dev_trans_exec(&dev->read_trans));
+    memcpy(res, dev->raw, SHT4X_RAW_DATA_SIZE);
 
     ESP_LOGD(TAG, "Got response %02x %02x %02x %02x %02x %02x",
             res[0], res[1], res[2], res[3], res[4], res[5]);
@@ -166,6 +184,15 @@ static esp_err_t send_cmd(sht4x_t *dev, uint8_t cmd)
     return ESP_OK;
 }
 
+static esp_err_t send_meas_cmd(sht4x_t *dev)
+{
+    I2C_DEV_TAKE_MUTEX(&dev->i2c_dev);
+    I2C_DEV_CHECK(&dev->i2c_dev, send_meas_cmd_nolock(dev));
+    I2C_DEV_GIVE_MUTEX(&dev->i2c_dev);
+
+    return ESP_OK;
+}
+
 static esp_err_t read_res(sht4x_t *dev, sht4x_raw_data_t res)
 {
     I2C_DEV_TAKE_MUTEX(&dev->i2c_dev);
@@ -186,6 +213,17 @@ static esp_err_t exec_cmd(sht4x_t *dev, uint8_t cmd, size_t delay_ticks, sht4x_r
     return ESP_OK;
 }
 
+static esp_err_t exec_meas(sht4x_t *dev, size_t delay_ticks, sht4x_raw_data_t res)
+{
+    I2C_DEV_TAKE_MUTEX(&dev->i2c_dev);
+    I2C_DEV_CHECK(&dev->i2c_dev, send_meas_cmd_nolock(dev));
+    vTaskDelay(delay_ticks + 1);
+    I2C_DEV_CHECK(&dev->i2c_dev, read_res_nolock(dev, res));
+    I2C_DEV_GIVE_MUTEX(&dev->i2c_dev);
+
+    return ESP_OK;
+}
+
 static inline bool is_measuring(sht4x_t *dev)
 {
     // not running if measurement is not started
@@ -200,17 +238,28 @@ static inline bool is_measuring(sht4x_t *dev)
 ///////////////////////////////////////////////////////////////////////////////
 
 esp_err_t sht4x_init_desc(sht4x_t *dev, i2c_port_t port, gpio_num_t sda_gpio, gpio_num_t scl_gpio)
+{
+    return sht4x_init_desc_addr(dev, SHT4X_I2C_ADDRESS, port, sda_gpio, scl_gpio);
+}
+
+esp_err_t sht4x_init_desc_addr(sht4x_t *dev, uint8_t addr, i2c_port_t port, gpio_num_t sda_gpio, gpio_num_t scl_gpio)
 {
     CHECK_ARG(dev);
 
     dev->i2c_dev.port = port;
-    dev->i2c_dev.addr = SHT4X_I2C_ADDRESS;
+    dev->i2c_dev.addr = addr;
     dev->i2c_dev.cfg.sda_io_num = sda_gpio;
     dev->i2c_dev.cfg.scl_io_num = scl_gpio;
 #if HELPER_TARGET_IS_ESP32
     dev->i2c_dev.cfg.master.clk_speed = I2C_FREQ_HZ;
 #endif
 
+    // The measurement transaction is built on the first measurement, for the command it needs
+    memset(&dev->meas_trans, 0, sizeof(dev->meas_trans));
+
+    // Polling reads the results over and over, so that transaction is built only once
+    CHECK(i2c_dev_trans_init(&dev->read_trans, &dev->i2c_dev, NULL, 0, dev->raw, SHT4X_RAW_DATA_SIZE));
+
     return i2c_dev_create_mutex(&dev->i2c_dev);
 }
 
@@ -218,6 +267,8 @@ esp_err_t sht4x_free_desc(sht4x_t *dev)
 {
     CHECK_ARG(dev);
 
+    i2c_dev_trans_free(&dev->meas_trans);
+    i2c_dev_trans_free(&dev->read_trans);
     return i2c_dev_delete_mutex(&dev->i2c_dev);
 }
 
@@ -251,7 +302,7 @@ esp_err_t sht4x_measure(sht4x_t *dev, float *temperature, float *humidity)
     CHECK_ARG(dev && (temperature || humidity));
 
     sht4x_raw_data_t raw;
-    CHECK(exec_cmd(dev, get_meas_cmd(dev), sht4x_get_measurement_duration(dev), raw));
+    CHECK(exec_meas(dev, sht4x_get_measurement_duration(dev), raw));
 
     return sht4x_compute_values(raw, temperature, humidity);
 }
@@ -267,7 +318,7 @@ esp_err_t sht4x_start_measurement(sht4x_t *dev)
     }
 
     dev->meas_start_time = esp_timer_get_time();
-    CHECK(send_cmd(dev, get_meas_cmd(dev)));
+    CHECK(send_meas_cmd(dev));
     dev->meas_started = true;
 
     return ESP_OK;
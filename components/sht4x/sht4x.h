@@ -91,6 +91,11 @@ typedef struct
 
     bool meas_started;            //!< indicates whether measurement started
     uint64_t meas_start_time;     //!< measurement start time in us
+
+    i2c_dev_trans_t meas_trans;   //!< pre-built measurement command
+    uint8_t meas_cmd;             //!< command meas_trans was built for
+    i2c_dev_trans_t read_trans;   //!< pre-built read of the results into `raw`
+    sht4x_raw_data_t raw;         //!< buffer of read_trans
 } sht4x_t;
 
 /**
@@ -104,6 +109,21 @@ typedef struct
  */
 esp_err_t sht4x_init_desc(sht4x_t *dev, i2c_port_t port, gpio_num_t sda_gpio, gpio_num_t scl_gpio);
 
+/**
+ * @brief Initialize device descriptor of a sensor with a different I2C address
+ *
+ * The SHT4x variants answer on 0x44, 0x45 or 0x46, so up to three of them
+ * can share a bus.
+ *
+ * @param dev       Device descriptor
+ * @param addr      I2C address
+ * @param port      I2C port
+ * @param sda_gpio  SDA GPIO
+ * @param scl_gpio  SCL GPIO
+ * @return          `ESP_OK` on success
+ */
+esp_err_t sht4x_init_desc_addr(sht4x_t *dev, uint8_t addr, i2c_port_t port, gpio_num_t sda_gpio, gpio_num_t scl_gpio);
+
 /**
  * @brief Free device descriptor
  *
@@ -658,6 +658,155 @@
     #endif
 #endif /* Conditional key and cert constant names */
 
+/* HomeKit Accessory Protocol crypto profile
+ *
+ * HAP only needs SRP-6a with SHA-512, HKDF-SHA512, ChaCha20-Poly1305,
+ * X25519 and Ed25519. Everything else enabled above (TLS, X.509/ASN.1,
+ * certificate generation, RSA, DH, NIST curves, AES, SHA-1/224/384, MD5,
+ * SM2/3/4) is stripped, so wolfSSL shrinks to the pieces esp32-homekit
+ * actually links. With this profile esp-tls must use mbedTLS, see the
+ * WOLFSSL_HAP_PROFILE Kconfig option.
+ */
+#if defined(WOLFSSL_HAP_PROFILE) || defined(CONFIG_WOLFSSL_HAP_PROFILE)
+    /* No TLS layer, wolfCrypt only */
+    #undef  WOLFCRYPT_ONLY
+    #define WOLFCRYPT_ONLY
+    #undef  WOLFSSL_TLS13
+    #undef  HAVE_TLS_EXTENSIONS
+    #undef  HAVE_SUPPORTED_CURVES
+    #undef  HAVE_SESSION_TICKET
+    #undef  HAVE_AEAD
+    #define NO_OLD_TLS
+    #define NO_PSK
+    #define NO_SESSION_CACHE
+
+    /* No certificates */
+    #undef  WOLFSSL_KEY_GEN
+    #undef  WOLFSSL_CERT_REQ
+    #undef  WOLFSSL_CERT_GEN
+    #undef  WOLFSSL_CERT_EXT
+    #undef  WOLFSSL_SYS_CA_CERTS
+    #undef  WOLFSSL_CERT_TEXT
+    #undef  WOLFSSL_ASN_TEMPLATE
+    #define NO_ASN
+    #define NO_CERTS
+    #define NO_SIG_WRAPPER
+
+    /* No public key algorithms besides the Curve25519 family (and SRP) */
+    #undef  HAVE_ECC
+    #undef  WC_RSA_PSS
+    #undef  HAVE_DH
+    #undef  WOLFSSL_SM2
+    #define NO_RSA
+    #define NO_DH
+    #define NO_DSA
+
+    /* No symmetric ciphers besides ChaCha20-Poly1305 */
+    #undef  HAVE_AESGCM
+    #undef  WOLFSSL_SM4
+    #define NO_AES
+    #define NO_DES3
+    #define NO_RC4
+
+    /* SHA-512 (SRP, HKDF, Ed25519) and SHA-256 (Hash DRBG) only */
+    #undef  WOLFSSL_SHA224
+    #undef  WOLFSSL_SHA384
+    #undef  WOLFSSL_SHA3
+    #undef  WOLFSSL_SM3
+    #define WOLFSSL_NOSHA512_224
+    #define WOLFSSL_NOSHA512_256
+    #define NO_SHA
+    #define NO_MD4
+    #define NO_MD5
+    #define NO_PWDBASED
+
+    /* What HAP does need */
+    #undef  WOLFCRYPT_HAVE_SRP
+    #define WOLFCRYPT_HAVE_SRP
+    #undef  WOLFSSL_SHA512
+    #define WOLFSSL_SHA512
+    #undef  HAVE_HKDF
+    #define HAVE_HKDF
+    #undef  HAVE_CHACHA
+    #define HAVE_CHACHA
+    #undef  HAVE_POLY1305
+    #define HAVE_POLY1305
+    #undef  HAVE_CURVE25519
+    #define HAVE_CURVE25519
+    #undef  HAVE_ED25519
+    #define HAVE_ED25519
+    #undef  WOLFSSL_BASE64_ENCODE
+    #define WOLFSSL_BASE64_ENCODE
+
+    /* Curve25519/Ed25519 without the ~45 KB of precomputed group tables */
+    #undef  CURVE25519_SMALL
+    #define CURVE25519_SMALL
+    #undef  ED25519_SMALL
+    #define ED25519_SMALL
+    /* ...but with field arithmetic in 32-bit limbs instead of bytes, which
+     * makes X25519 and Ed25519 several times faster at the same stack use.
+     * Comment out to fall back to the byte-wise fe_low_mem.c code. */
+    #undef  CURVED25519_SMALL_32BIT
+    #define CURVED25519_SMALL_32BIT
+
+    /* SHA-512 rounds on 32-bit hi/lo word pairs instead of word64, so the
+     * RV32 compiler keeps the state in registers rather than spilling the
+     * emulated 64-bit rotates to the stack. The C6 has no SHA-512
+     * peripheral, so every SRP/HKDF/Ed25519 hash takes this path. */
+    #if defined(CONFIG_IDF_TARGET_ARCH_RISCV)
+        #undef  WOLFSSL_SHA512_32BIT
+        #define WOLFSSL_SHA512_32BIT
+    #endif
+
+    /* Poly1305 over four blocks per carry chain with r^2..r^4, for the
+     * accessory database and other large encrypted responses. Frames under
+     * POLY1305_4WAY_MIN_SIZE stay on the one-block loop. */
+    #undef  WOLFSSL_POLY1305_4WAY
+    #define WOLFSSL_POLY1305_4WAY
+
+    /* SRP on sp_int instead of tfm. tfm offloads exponentiation to the RSA
+     * peripheral; sp_int is sized for the 3072-bit HomeKit group,
+     * exponentiates in constant time and uses the RISC-V32 assembly for
+     * its multiply-accumulate inner loops. */
+    #if defined(WOLFSSL_HAP_SP_MATH) || defined(CONFIG_WOLFSSL_HAP_SP_MATH)
+        #undef  USE_FAST_MATH
+        #undef  FP_MAX_BITS
+        #undef  WOLFSSL_SP_MATH_ALL
+        #define WOLFSSL_SP_MATH_ALL
+        #undef  SP_INT_BITS
+        #define SP_INT_BITS 3072
+        #if defined(CONFIG_IDF_TARGET_ARCH_RISCV)
+            #undef  WOLFSSL_SP_RISCV32
+            #define WOLFSSL_SP_RISCV32
+        #endif
+    #else
+        /* The SRP private exponents go through fp_exptmod; keep it on the
+         * Montgomery ladder instead of the sliding window. */
+        #undef  TFM_TIMING_RESISTANT
+        #define TFM_TIMING_RESISTANT
+
+        /* 3072-bit operands with double-width products, instead of the
+         * 8192-bit RSA sizing above: each fp_int shrinks from ~2 KB to
+         * ~800 bytes. */
+        #undef  FP_MAX_BITS
+        #define FP_MAX_BITS (3072 * 2)
+
+        /* Time-sliced SRP (wc_SrpGetPublic_nb / wc_SrpComputeKey_nb) on top
+         * of the fp_exptmod_nb state machine, so pair-setup can yield to the
+         * other tasks between steps. */
+        #if defined(WC_SRP_NONBLOCK) || defined(CONFIG_WOLFSSL_HAP_SRP_NONBLOCK)
+            #undef  WC_RSA_NONBLOCK
+            #define WC_RSA_NONBLOCK
+            #undef  WC_SRP_NONBLOCK
+            #define WC_SRP_NONBLOCK
+        #endif
+    #endif
+
+    /* Less rodata and no platform report at wolfCrypt_Init() */
+    #define NO_ERROR_STRINGS
+    #undef  HAVE_VERSION_EXTENDED_INFO
+#endif /* WOLFSSL_HAP_PROFILE */
+
 /* See settings.h for some of the possible hardening options:
  *
  *  #define NO_ESPIDF_DEFAULT
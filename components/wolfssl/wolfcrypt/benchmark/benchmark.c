@@ -161,6 +161,9 @@
 #ifdef HAVE_ED25519
     #include <wolfssl/wolfcrypt/ed25519.h>
 #endif
+#ifdef WOLFCRYPT_HAVE_SRP
+    #include <wolfssl/wolfcrypt/srp.h>
+#endif
 #ifdef HAVE_CURVE448
     #include <wolfssl/wolfcrypt/curve448.h>
 #endif
@@ -631,6 +634,8 @@
 #define BENCH_BLAKE2B            0x00008000
 #define BENCH_BLAKE2S            0x00010000
 #define BENCH_SM3                0x00020000
+#define BENCH_SHA512_SW          0x00040000
+#define BENCH_POLY1305_FRAMES    0x00080000
 
 /* MAC algorithms. */
 #define BENCH_CMAC               0x00000001
@@ -654,6 +659,7 @@
 #define BENCH_RSA                0x00000002
 #define BENCH_RSA_SZ             0x00000004
 #define BENCH_DH                 0x00000010
+#define BENCH_SRP                0x00000100
 #define BENCH_ECC_MAKEKEY        0x00001000
 #define BENCH_ECC                0x00002000
 #define BENCH_ECC_ENCRYPT        0x00004000
@@ -850,6 +856,7 @@ static const bench_alg bench_digest_opt[] = {
 #endif
 #ifdef HAVE_POLY1305
     { "-poly1305",           BENCH_POLY1305          },
+    { "-poly1305-frames",    BENCH_POLY1305_FRAMES   },
 #endif
 #ifndef NO_SHA
     { "-sha",                BENCH_SHA               },
@@ -869,6 +876,7 @@ static const bench_alg bench_digest_opt[] = {
 #endif
 #ifdef WOLFSSL_SHA512
     { "-sha512",             BENCH_SHA512            },
+    { "-sha512-sw",          BENCH_SHA512_SW         },
 #endif
 #ifdef WOLFSSL_SHA3
     { "-sha3",               BENCH_SHA3              },
@@ -990,6 +998,9 @@ static const bench_alg bench_asym_opt[] = {
     { "-ed25519-kg",         BENCH_ED25519_KEYGEN    },
     { "-ed25519",            BENCH_ED25519_SIGN      },
 #endif
+#ifdef WOLFCRYPT_HAVE_SRP
+    { "-srp",                BENCH_SRP               },
+#endif
 #ifdef HAVE_CURVE448
     { "-curve448-kg",        BENCH_CURVE448_KEYGEN   },
     #ifdef HAVE_CURVE448_SHARED_SECRET
@@ -3281,6 +3292,8 @@ static void* benchmarks_do(void* args)
 #ifdef HAVE_POLY1305
     if (bench_all || (bench_digest_algs & BENCH_POLY1305))
         bench_poly1305();
+    if (bench_all || (bench_digest_algs & BENCH_POLY1305_FRAMES))
+        bench_poly1305_frames();
 #endif
 #ifndef NO_SHA
     if (bench_all || (bench_digest_algs & BENCH_SHA)) {
@@ -3331,6 +3344,8 @@ static void* benchmarks_do(void* args)
         bench_sha512(1);
     #endif
     }
+    if (bench_all || (bench_digest_algs & BENCH_SHA512_SW))
+        bench_sha512_sw();
 
 #if !defined(WOLFSSL_NOSHA512_224) && \
    (!defined(HAVE_FIPS) || FIPS_VERSION_GE(5, 3)) && !defined(HAVE_SELFTEST)
@@ -3736,6 +3751,11 @@ static void* benchmarks_do(void* args)
         bench_ed25519KeySign();
 #endif
 
+#if defined(WOLFCRYPT_HAVE_SRP) && defined(WOLFSSL_SHA512)
+    if (bench_all || (bench_asym_algs & BENCH_SRP))
+        bench_srp();
+#endif
+
 #ifdef HAVE_CURVE448
     if (bench_all || (bench_asym_algs & BENCH_CURVE448_KEYGEN))
         bench_curve448KeyGen();
@@ -5424,6 +5444,47 @@ void bench_poly1305(void)
     bench_multi_value_stats(max, min, sum, squareSum, runs);
 #endif
 }
+
+/* One-time key per frame, as in ChaCha20-Poly1305, for frame sizes from
+ * 64 bytes to 1 KB */
+void bench_poly1305_frames(void)
+{
+    Poly1305 enc;
+    byte     mac[16];
+    char     desc[24];
+    double   start;
+    word32   sz;
+    int      ret = 0, i, count;
+    DECLARE_MULTI_VALUE_STATS_VARS()
+
+    for (sz = 64; sz <= 1024 && sz <= bench_size; sz *= 2) {
+        bench_stats_start(&count, &start);
+        do {
+            for (i = 0; i < numBlocks; i++) {
+                ret = wc_Poly1305SetKey(&enc, bench_key, 32);
+                if (ret == 0)
+                    ret = wc_Poly1305Update(&enc, bench_plain, sz);
+                if (ret == 0)
+                    ret = wc_Poly1305Final(&enc, mac);
+                if (ret != 0) {
+                    printf("Poly1305 failed: %d\n", ret);
+                    return;
+                }
+                RECORD_MULTI_VALUE_STATS();
+            }
+            count += i;
+        } while (bench_stats_check(start)
+    #ifdef MULTI_VALUE_STATISTICS
+           || runs < minimum_runs
+    #endif
+           );
+        (void)XSNPRINTF(desc, sizeof(desc), "POLY1305 %dB", (int)sz);
+        bench_stats_sym_finish(desc, 0, count, sz, start, ret);
+    #ifdef MULTI_VALUE_STATISTICS
+        bench_multi_value_stats(max, min, sum, squareSum, runs);
+    #endif
+    }
+}
 #endif /* HAVE_POLY1305 */
 
 
@@ -6840,6 +6901,51 @@ exit:
 }
 #endif /* WOLFSSL_NOSHA512_256 && !FIPS ... */
 
+/* SHA-512 on the software transform only, i.e. what every hash costs while
+ * the SHA peripheral is held by another context (or on chips without one). */
+void bench_sha512_sw(void)
+{
+    wc_Sha512 hash;
+    byte      digest[WC_SHA512_DIGEST_SIZE];
+    double    start;
+    int       ret = 0, count = 0, times;
+    DECLARE_MULTI_VALUE_STATS_VARS()
+
+    ret = wc_InitSha512_ex(&hash, HEAP_HINT, INVALID_DEVID);
+    if (ret != 0) {
+        printf("InitSha512_ex failed, ret = %d\n", ret);
+        return;
+    }
+#if defined(WOLFSSL_USE_ESP32_CRYPT_HASH_HW) && \
+   !defined(NO_WOLFSSL_ESP32_CRYPT_HASH_SHA512)
+    hash.ctx.mode = ESP32_SHA_SW;
+#endif
+
+    bench_stats_start(&count, &start);
+    do {
+        for (times = 0; times < numBlocks; times++) {
+            ret = wc_Sha512Update(&hash, bench_plain, bench_size);
+            if (ret != 0)
+                goto exit_sha512_sw;
+            RECORD_MULTI_VALUE_STATS();
+        }
+        count += times;
+    } while (bench_stats_check(start)
+    #ifdef MULTI_VALUE_STATISTICS
+           || runs < minimum_runs
+    #endif
+           );
+    ret = wc_Sha512Final(&hash, digest);
+
+exit_sha512_sw:
+    bench_stats_sym_finish("SHA-512 SW", 0, count, bench_size, start, ret);
+#ifdef MULTI_VALUE_STATISTICS
+    bench_multi_value_stats(max, min, sum, squareSum, runs);
+#endif
+
+    wc_Sha512Free(&hash);
+}
+
 #endif /* WOLFSSL_SHA512 */
 
 
@@ -11615,6 +11721,190 @@ exit_ed_verify:
 }
 #endif /* HAVE_ED25519 */
 
+#if defined(WOLFCRYPT_HAVE_SRP) && defined(WOLFSSL_SHA512)
+/* SRP-6a with SHA-512 on the RFC 5054 3072-bit group (HomeKit pair-setup).
+ * "key gen" derives the verifier from a password, "agree" is the server side
+ * of an exchange: B = kv + g^b and the premaster secret (A v^u)^b.
+ * Build once per big integer backend (tfm with and without the RSA
+ * peripheral, sp_int) to compare them. */
+void bench_srp(void)
+{
+    static const byte N[] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xc9, 0x0f, 0xda, 0xa2, 0x21, 0x68, 0xc2, 0x34,
+        0xc4, 0xc6, 0x62, 0x8b, 0x80, 0xdc, 0x1c, 0xd1,
+        0x29, 0x02, 0x4e, 0x08, 0x8a, 0x67, 0xcc, 0x74,
+        0x02, 0x0b, 0xbe, 0xa6, 0x3b, 0x13, 0x9b, 0x22,
+        0x51, 0x4a, 0x08, 0x79, 0x8e, 0x34, 0x04, 0xdd,
+        0xef, 0x95, 0x19, 0xb3, 0xcd, 0x3a, 0x43, 0x1b,
+        0x30, 0x2b, 0x0a, 0x6d, 0xf2, 0x5f, 0x14, 0x37,
+        0x4f, 0xe1, 0x35, 0x6d, 0x6d, 0x51, 0xc2, 0x45,
+        0xe4, 0x85, 0xb5, 0x76, 0x62, 0x5e, 0x7e, 0xc6,
+        0xf4, 0x4c, 0x42, 0xe9, 0xa6, 0x37, 0xed, 0x6b,
+        0x0b, 0xff, 0x5c, 0xb6, 0xf4, 0x06, 0xb7, 0xed,
+        0xee, 0x38, 0x6b, 0xfb, 0x5a, 0x89, 0x9f, 0xa5,
+        0xae, 0x9f, 0x24, 0x11, 0x7c, 0x4b, 0x1f, 0xe6,
+        0x49, 0x28, 0x66, 0x51, 0xec, 0xe4, 0x5b, 0x3d,
+        0xc2, 0x00, 0x7c, 0xb8, 0xa1, 0x63, 0xbf, 0x05,
+        0x98, 0xda, 0x48, 0x36, 0x1c, 0x55, 0xd3, 0x9a,
+        0x69, 0x16, 0x3f, 0xa8, 0xfd, 0x24, 0xcf, 0x5f,
+        0x83, 0x65, 0x5d, 0x23, 0xdc, 0xa3, 0xad, 0x96,
+        0x1c, 0x62, 0xf3, 0x56, 0x20, 0x85, 0x52, 0xbb,
+        0x9e, 0xd5, 0x29, 0x07, 0x70, 0x96, 0x96, 0x6d,
+        0x67, 0x0c, 0x35, 0x4e, 0x4a, 0xbc, 0x98, 0x04,
+        0xf1, 0x74, 0x6c, 0x08, 0xca, 0x18, 0x21, 0x7c,
+        0x32, 0x90, 0x5e, 0x46, 0x2e, 0x36, 0xce, 0x3b,
+        0xe3, 0x9e, 0x77, 0x2c, 0x18, 0x0e, 0x86, 0x03,
+        0x9b, 0x27, 0x83, 0xa2, 0xec, 0x07, 0xa2, 0x8f,
+        0xb5, 0xc5, 0x5d, 0xf0, 0x6f, 0x4c, 0x52, 0xc9,
+        0xde, 0x2b, 0xcb, 0xf6, 0x95, 0x58, 0x17, 0x18,
+        0x39, 0x95, 0x49, 0x7c, 0xea, 0x95, 0x6a, 0xe5,
+        0x15, 0xd2, 0x26, 0x18, 0x98, 0xfa, 0x05, 0x10,
+        0x15, 0x72, 0x8e, 0x5a, 0x8a, 0xaa, 0xc4, 0x2d,
+        0xad, 0x33, 0x17, 0x0d, 0x04, 0x50, 0x7a, 0x33,
+        0xa8, 0x55, 0x21, 0xab, 0xdf, 0x1c, 0xba, 0x64,
+        0xec, 0xfb, 0x85, 0x04, 0x58, 0xdb, 0xef, 0x0a,
+        0x8a, 0xea, 0x71, 0x57, 0x5d, 0x06, 0x0c, 0x7d,
+        0xb3, 0x97, 0x0f, 0x85, 0xa6, 0xe1, 0xe4, 0xc7,
+        0xab, 0xf5, 0xae, 0x8c, 0xdb, 0x09, 0x33, 0xd7,
+        0x1e, 0x8c, 0x94, 0xe0, 0x4a, 0x25, 0x61, 0x9d,
+        0xce, 0xe3, 0xd2, 0x26, 0x1a, 0xd2, 0xee, 0x6b,
+        0xf1, 0x2f, 0xfa, 0x06, 0xd9, 0x8a, 0x08, 0x64,
+        0xd8, 0x76, 0x02, 0x73, 0x3e, 0xc8, 0x6a, 0x64,
+        0x52, 0x1f, 0x2b, 0x18, 0x17, 0x7b, 0x20, 0x0c,
+        0xbb, 0xe1, 0x17, 0x57, 0x7a, 0x61, 0x5d, 0x6c,
+        0x77, 0x09, 0x88, 0xc0, 0xba, 0xd9, 0x46, 0xe2,
+        0x08, 0xe2, 0x4f, 0xa0, 0x74, 0xe5, 0xab, 0x31,
+        0x43, 0xdb, 0x5b, 0xfc, 0xe0, 0xfd, 0x10, 0x8e,
+        0x4b, 0x82, 0xd1, 0x20, 0xa9, 0x3a, 0xd2, 0xca,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+    };
+    static const byte g[] = { 0x05 };
+    static const byte salt[16] = { 0 };
+    static const byte username[] = "Pair-Setup";
+    static const byte password[] = "123-45-678";
+    Srp* cli = NULL;
+    Srp* srv = NULL;
+    byte* verifier = NULL;
+    byte* clientPub = NULL;
+    byte* serverPub = NULL;
+    word32 verifierSz = 384, clientPubSz = 384, serverPubSz;
+    double start;
+    int    ret = 0, i, count;
+    const char**desc = bench_desc_words[lng_index];
+    DECLARE_MULTI_VALUE_STATS_VARS()
+
+    cli = (Srp*)XMALLOC(sizeof(Srp), HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    srv = (Srp*)XMALLOC(sizeof(Srp), HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    verifier = (byte*)XMALLOC(3 * 384, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    if (cli == NULL || srv == NULL || verifier == NULL) {
+        printf("bench_srp malloc failed\n");
+        goto exit;
+    }
+    clientPub = verifier + 384;
+    serverPub = verifier + 2 * 384;
+
+    /* Client public value A for the server side benchmark */
+    ret = wc_SrpInit(cli, SRP_TYPE_SHA512, SRP_CLIENT_SIDE);
+    if (ret == 0)
+        ret = wc_SrpSetUsername(cli, username, sizeof(username) - 1);
+    if (ret == 0)
+        ret = wc_SrpSetParams(cli, N, sizeof(N), g, sizeof(g), salt,
+                              sizeof(salt));
+    if (ret == 0)
+        ret = wc_SrpSetPassword(cli, password, sizeof(password) - 1);
+    if (ret == 0)
+        ret = wc_SrpGetPublic(cli, clientPub, &clientPubSz);
+    wc_SrpTerm(cli);
+    if (ret != 0) {
+        printf("SRP client setup failed: %d\n", ret);
+        goto exit;
+    }
+
+    /* Verifier derivation */
+    bench_stats_start(&count, &start);
+    do {
+        for (i = 0; i < genTimes; i++) {
+            verifierSz = 384;
+            ret = wc_SrpInit(cli, SRP_TYPE_SHA512, SRP_CLIENT_SIDE);
+            if (ret == 0)
+                ret = wc_SrpSetUsername(cli, username, sizeof(username) - 1);
+            if (ret == 0)
+                ret = wc_SrpSetParams(cli, N, sizeof(N), g, sizeof(g), salt,
+                                      sizeof(salt));
+            if (ret == 0)
+                ret = wc_SrpSetPassword(cli, password, sizeof(password) - 1);
+            if (ret == 0)
+                ret = wc_SrpGetVerifier(cli, verifier, &verifierSz);
+            wc_SrpTerm(cli);
+            if (ret != 0) {
+                printf("SRP verifier failed: %d\n", ret);
+                goto exit_srp_gen;
+            }
+            RECORD_MULTI_VALUE_STATS();
+        }
+        count += i;
+    } while (bench_stats_check(start)
+#ifdef MULTI_VALUE_STATISTICS
+       || runs < minimum_runs
+#endif
+       );
+
+exit_srp_gen:
+    bench_stats_asym_finish("SRP", 3072, desc[2], 0, count, start, ret);
+#ifdef MULTI_VALUE_STATISTICS
+    bench_multi_value_stats(max, min, sum, squareSum, runs);
+#endif
+    if (ret != 0)
+        goto exit;
+
+    RESET_MULTI_VALUE_STATS_VARS();
+
+    /* Server side of the exchange */
+    bench_stats_start(&count, &start);
+    do {
+        for (i = 0; i < agreeTimes; i++) {
+            serverPubSz = 384;
+            ret = wc_SrpInit(srv, SRP_TYPE_SHA512, SRP_SERVER_SIDE);
+            if (ret == 0)
+                ret = wc_SrpSetUsername(srv, username, sizeof(username) - 1);
+            if (ret == 0)
+                ret = wc_SrpSetParams(srv, N, sizeof(N), g, sizeof(g), salt,
+                                      sizeof(salt));
+            if (ret == 0)
+                ret = wc_SrpSetVerifier(srv, verifier, verifierSz);
+            if (ret == 0)
+                ret = wc_SrpGetPublic(srv, serverPub, &serverPubSz);
+            if (ret == 0)
+                ret = wc_SrpComputeKey(srv, clientPub, clientPubSz, serverPub,
+                                       serverPubSz);
+            wc_SrpTerm(srv);
+            if (ret != 0) {
+                printf("SRP server exchange failed: %d\n", ret);
+                goto exit_srp_agree;
+            }
+            RECORD_MULTI_VALUE_STATS();
+        }
+        count += i;
+    } while (bench_stats_check(start)
+#ifdef MULTI_VALUE_STATISTICS
+       || runs < minimum_runs
+#endif
+       );
+
+exit_srp_agree:
+    bench_stats_asym_finish("SRP", 3072, desc[3], 0, count, start, ret);
+#ifdef MULTI_VALUE_STATISTICS
+    bench_multi_value_stats(max, min, sum, squareSum, runs);
+#endif
+
+exit:
+    XFREE(cli, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(srv, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(verifier, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+}
+#endif /* WOLFCRYPT_HAVE_SRP && WOLFSSL_SHA512 */
+
 #ifdef HAVE_CURVE448
 void bench_curve448KeyGen(void)
 {
@@ -60,6 +60,7 @@ void bench_aescfb(void);
 void bench_aesofb(void);
 void bench_aessiv(void);
 void bench_poly1305(void);
+void bench_poly1305_frames(void);
 void bench_camellia(void);
 void bench_sm4_cbc(void);
 void bench_sm4_gcm(void);
@@ -70,6 +71,7 @@ void bench_sha224(int useDeviceID);
 void bench_sha256(int useDeviceID);
 void bench_sha384(int useDeviceID);
 void bench_sha512(int useDeviceID);
+void bench_sha512_sw(void);
 #if !defined(WOLFSSL_NOSHA512_224) && \
    (!defined(HAVE_FIPS) || FIPS_VERSION_GE(5, 3)) && !defined(HAVE_SELFTEST)
 void bench_sha512_224(int useDeviceID);
@@ -113,6 +115,7 @@ void bench_curve25519KeyGen(int useDeviceID);
 void bench_curve25519KeyAgree(int useDeviceID);
 void bench_ed25519KeyGen(void);
 void bench_ed25519KeySign(void);
+void bench_srp(void);
 void bench_curve448KeyGen(void);
 void bench_curve448KeyAgree(void);
 void bench_ed448KeyGen(void);
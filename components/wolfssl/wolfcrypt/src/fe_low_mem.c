@@ -65,7 +65,331 @@ void fe_init(void)
 }
 #endif
 
+#ifdef CURVED25519_SMALL_32BIT
+/* Field elements as ten signed 32-bit limbs in radix 2^25.5 (alternating
+ * 26 and 25 bits), the representation from ref10, with the products rolled
+ * up into loops instead of unrolled so the code stays small. The byte array
+ * interface converts at its boundaries; the X25519 ladder, inversion and
+ * square root stay in limbs throughout.
+ *
+ * Inputs to fe32_mul()/fe32_sq() must be carried limbs or the sum/difference
+ * of two of them, so that 19 * limb still fits into 32 bits.
+ */
+typedef sword32 fe32[10];
+
+#define FE32_LIMB_BITS(i)   (((i) & 1) ? 25 : 26)
+
+/* Bit offset of each limb in the little endian byte encoding */
+static const byte fe32_offset[10] = {
+    0, 26, 51, 77, 102, 128, 153, 179, 204, 230
+};
+
+static void fe32_frombytes(fe32 h, const byte *s)
+{
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        const byte *p = s + (fe32_offset[i] >> 3);
+        word32 w = (word32)p[0] | ((word32)p[1] << 8) |
+                   ((word32)p[2] << 16) | ((word32)p[3] << 24);
+
+        w >>= fe32_offset[i] & 7;
+        h[i] = (sword32)(w & ((1UL << FE32_LIMB_BITS(i)) - 1));
+    }
+
+    /* Bit 255 is not covered by the limbs, reduce with 2^255 = 19 mod p */
+    h[0] += 19 * (s[31] >> 7);
+}
+
+
+/* Carry the 64-bit column sums into limbs of at most 2^25 in magnitude */
+static void fe32_carry(fe32 r, sword64 *h)
+{
+    sword64 c;
+    int i;
+
+    for (i = 0; i < 9; i++) {
+        c = (h[i] + ((sword64)1 << (FE32_LIMB_BITS(i) - 1))) >>
+            FE32_LIMB_BITS(i);
+        h[i + 1] += c;
+        h[i] -= c * ((sword64)1 << FE32_LIMB_BITS(i));
+    }
+
+    c = (h[9] + ((sword64)1 << 24)) >> 25;
+    h[0] += c * 19;
+    h[9] -= c * ((sword64)1 << 25);
+
+    c = (h[0] + ((sword64)1 << 25)) >> 26;
+    h[1] += c;
+    h[0] -= c * ((sword64)1 << 26);
+
+    for (i = 0; i < 10; i++)
+        r[i] = (sword32)h[i];
+}
+
+
+static void fe32_tobytes(byte *s, const fe32 f)
+{
+    sword64 w[10];
+    sword32 h[10];
+    sword32 q;
+    int i;
+
+    for (i = 0; i < 10; i++)
+        w[i] = f[i];
+    fe32_carry(h, w);
+
+    /* q = floor(h / p), which is 0 or 1 for carried limbs */
+    q = (19 * h[9] + ((sword32)1 << 24)) >> 25;
+    for (i = 0; i < 10; i++)
+        q = (h[i] + q) >> FE32_LIMB_BITS(i);
+
+    /* h - q * p, the carry out of the top limb is the 2^255 that cancels */
+    h[0] += 19 * q;
+    for (i = 0; i < 9; i++) {
+        sword32 c = h[i] >> FE32_LIMB_BITS(i);
+        h[i + 1] += c;
+        h[i] -= c * ((sword32)1 << FE32_LIMB_BITS(i));
+    }
+    h[9] &= ((sword32)1 << 25) - 1;
+
+    /* Every limb shifted to its bit offset spans at most four bytes */
+    for (i = 0; i < F25519_SIZE; i++)
+        s[i] = 0;
+    for (i = 0; i < 10; i++) {
+        const word32 v = (word32)h[i] << (fe32_offset[i] & 7);
+        byte *p = s + (fe32_offset[i] >> 3);
+
+        p[0] |= (byte)v;
+        p[1] |= (byte)(v >> 8);
+        p[2] |= (byte)(v >> 16);
+        p[3] |= (byte)(v >> 24);
+    }
+}
+
+
+static void fe32_add(fe32 r, const fe32 f, const fe32 g)
+{
+    int i;
+
+    for (i = 0; i < 10; i++)
+        r[i] = f[i] + g[i];
+}
+
+
+static void fe32_sub(fe32 r, const fe32 f, const fe32 g)
+{
+    int i;
+
+    for (i = 0; i < 10; i++)
+        r[i] = f[i] - g[i];
+}
+
+
+/* r = f * g. r may alias f or g. */
+static void fe32_mul(fe32 r, const fe32 f, const fe32 g)
+{
+    sword64 h[10];
+    sword32 g19[10];
+    int i, j;
+
+    for (i = 0; i < 10; i++) {
+        h[i] = 0;
+        g19[i] = 19 * g[i];
+    }
+
+    for (i = 0; i < 10; i++) {
+        /* An odd limb times an odd limb is half a bit short of its column
+         * (25 + 25 bits for a 51 bit position), so it counts twice */
+        const sword32 f1 = f[i];
+        const sword32 f2 = (i & 1) ? 2 * f[i] : f[i];
+
+        for (j = 0; j < 10 - i; j++)
+            h[i + j] += (sword64)((j & 1) ? f2 : f1) * g[j];
+        /* Columns past 2^255 wrap around with 2^255 = 19 mod p */
+        for (; j < 10; j++)
+            h[i + j - 10] += (sword64)((j & 1) ? f2 : f1) * g19[j];
+    }
+
+    fe32_carry(r, h);
+}
+
+
+/* r = f^2, using the symmetry of the cross terms. r may alias f. */
+static void fe32_sq(fe32 r, const fe32 f)
+{
+    sword64 h[10];
+    sword32 f19[10];
+    int i, j;
+
+    for (i = 0; i < 10; i++) {
+        h[i] = 0;
+        f19[i] = 19 * f[i];
+    }
+
+    for (i = 0; i < 10; i++) {
+        const int k = 2 * i;
+
+        h[k < 10 ? k : k - 10] += (sword64)((i & 1) ? 2 * f[i] : f[i]) *
+                                  (k < 10 ? f[i] : f19[i]);
+
+        for (j = i + 1; j < 10; j++) {
+            const sword32 a = ((i & j & 1) ? 4 : 2) * f[i];
+
+            if (i + j < 10)
+                h[i + j] += (sword64)a * f[j];
+            else
+                h[i + j - 10] += (sword64)a * f19[j];
+        }
+    }
+
+    fe32_carry(r, h);
+}
+
+
+/* r = f^(2^n), n > 0 */
+static void fe32_sqn(fe32 r, const fe32 f, int n)
+{
+    fe32_sq(r, f);
+    while (--n > 0)
+        fe32_sq(r, r);
+}
+
+
+/* r = f * c for a constant c < 2^24. r may alias f. */
+static void fe32_mul_c(fe32 r, const fe32 f, word32 c)
+{
+    sword64 h[10];
+    int i;
+
+    for (i = 0; i < 10; i++)
+        h[i] = (sword64)f[i] * c;
+
+    fe32_carry(r, h);
+}
+
+
 #ifdef CURVE25519_SMALL
+/* Swap f and g if b == 1, leave them if b == 0, in constant time */
+static void fe32_cswap(fe32 f, fe32 g, word32 b)
+{
+    const sword32 mask = -(sword32)b;
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        const sword32 x = mask & (f[i] ^ g[i]);
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+#endif /* CURVE25519_SMALL */
+
+
+/* r = z^(2^250 - 1) and z11 = z^11, the common head of the addition
+ * chains for the inverse and the square root.
+ */
+static void fe32_pow250(fe32 r, fe32 z11, const fe32 z)
+{
+    fe32 t0;
+    fe32 t1;
+
+    fe32_sq(t0, z);             /* 2 */
+    fe32_sqn(t1, t0, 2);        /* 8 */
+    fe32_mul(t1, z, t1);        /* 9 */
+    fe32_mul(z11, t0, t1);      /* 11 */
+    fe32_sq(t0, z11);           /* 22 */
+    fe32_mul(t1, t1, t0);       /* 2^5 - 1 */
+    fe32_sqn(t0, t1, 5);
+    fe32_mul(t1, t0, t1);       /* 2^10 - 1 */
+    fe32_sqn(t0, t1, 10);
+    fe32_mul(t0, t0, t1);       /* 2^20 - 1 */
+    fe32_sqn(r, t0, 20);
+    fe32_mul(t0, r, t0);        /* 2^40 - 1 */
+    fe32_sqn(t0, t0, 10);
+    fe32_mul(t1, t0, t1);       /* 2^50 - 1 */
+    fe32_sqn(t0, t1, 50);
+    fe32_mul(t0, t0, t1);       /* 2^100 - 1 */
+    fe32_sqn(r, t0, 100);
+    fe32_mul(r, r, t0);         /* 2^200 - 1 */
+    fe32_sqn(r, r, 50);
+    fe32_mul(r, r, t1);         /* 2^250 - 1 */
+}
+
+
+/* r = z^(p - 2) = z^(2^255 - 21) = 1/z */
+static void fe32_invert(fe32 r, const fe32 z)
+{
+    fe32 t;
+    fe32 z11;
+
+    fe32_pow250(t, z11, z);
+    fe32_sqn(t, t, 5);          /* 2^255 - 32 */
+    fe32_mul(r, t, z11);        /* 2^255 - 21 */
+}
+#endif /* CURVED25519_SMALL_32BIT */
+
+
+#ifdef CURVE25519_SMALL
+
+#ifdef CURVED25519_SMALL_32BIT
+#ifndef FREESCALE_LTC_ECC
+int curve25519(byte *result, const byte *n, const byte *p)
+{
+    /* Montgomery ladder from RFC 7748, section 5 */
+    fe32 x1, x2, z2, x3, z3;
+    fe32 a, aa, b, bb, e;
+    word32 swap = 0;
+    int i;
+
+    fe32_frombytes(x1, p);
+    XMEMSET(x2, 0, sizeof(x2));
+    XMEMSET(z2, 0, sizeof(z2));
+    x2[0] = 1;
+    XMEMCPY(x3, x1, sizeof(x3));
+    XMEMSET(z3, 0, sizeof(z3));
+    z3[0] = 1;
+
+    for (i = 254; i >= 0; i--) {
+        const word32 bit = (n[i >> 3] >> (i & 7)) & 1;
+
+        swap ^= bit;
+        fe32_cswap(x2, x3, swap);
+        fe32_cswap(z2, z3, swap);
+        swap = bit;
+
+        fe32_add(a, x2, z2);        /* A = x2 + z2 */
+        fe32_sub(b, x2, z2);        /* B = x2 - z2 */
+        fe32_sq(aa, a);             /* AA = A^2 */
+        fe32_sq(bb, b);             /* BB = B^2 */
+        fe32_sub(e, aa, bb);        /* E = AA - BB */
+
+        fe32_add(x2, x3, z3);       /* C = x3 + z3 */
+        fe32_sub(z2, x3, z3);       /* D = x3 - z3 */
+        fe32_mul(z2, z2, a);        /* DA = D * A */
+        fe32_mul(x2, x2, b);        /* CB = C * B */
+
+        fe32_add(x3, z2, x2);       /* x3 = (DA + CB)^2 */
+        fe32_sq(x3, x3);
+        fe32_sub(z3, z2, x2);       /* z3 = x1 * (DA - CB)^2 */
+        fe32_sq(z3, z3);
+        fe32_mul(z3, z3, x1);
+
+        fe32_mul(x2, aa, bb);       /* x2 = AA * BB */
+        fe32_mul_c(z2, e, 121665);  /* z2 = E * (AA + a24 * E) */
+        fe32_add(z2, z2, aa);
+        fe32_mul(z2, z2, e);
+    }
+    fe32_cswap(x2, x3, swap);
+    fe32_cswap(z2, z3, swap);
+
+    /* Freeze out of projective coordinates */
+    fe32_invert(z2, z2);
+    fe32_mul(x2, x2, z2);
+    fe32_tobytes(result, x2);
+    return 0;
+}
+#endif /* !FREESCALE_LTC_ECC */
+#else
 
 /* Double an X-coordinate */
 static void xc_double(byte *x3, byte *z3,
@@ -185,6 +509,7 @@ int curve25519(byte *result, const byte *n, const byte *p)
     return 0;
 }
 #endif /* !FREESCALE_LTC_ECC */
+#endif /* CURVED25519_SMALL_32BIT */
 #endif /* CURVE25519_SMALL */
 
 
@@ -432,6 +757,18 @@ void lm_neg(byte* r, const byte* a)
 }
 
 
+#ifdef CURVED25519_SMALL_32BIT
+void fe_mul__distinct(byte *r, const byte *a, const byte *b)
+{
+    fe32 fa;
+    fe32 fb;
+
+    fe32_frombytes(fa, a);
+    fe32_frombytes(fb, b);
+    fe32_mul(fa, fa, fb);
+    fe32_tobytes(r, fa);
+}
+#else
 void fe_mul__distinct(byte *r, const byte *a, const byte *b)
 {
     word32 c = 0;
@@ -460,6 +797,7 @@ void fe_mul__distinct(byte *r, const byte *a, const byte *b)
         c >>= 8;
     }
 }
+#endif /* CURVED25519_SMALL_32BIT */
 
 
 void lm_mul(byte *r, const byte* a, const byte *b)
@@ -494,6 +832,16 @@ void fe_mul_c(byte *r, const byte *a, word32 b)
 }
 
 
+#ifdef CURVED25519_SMALL_32BIT
+void fe_inv__distinct(byte *r, const byte *x)
+{
+    fe32 f;
+
+    fe32_frombytes(f, x);
+    fe32_invert(f, f);
+    fe32_tobytes(r, f);
+}
+#else
 void fe_inv__distinct(byte *r, const byte *x)
 {
     byte s[F25519_SIZE];
@@ -543,6 +891,7 @@ void fe_inv__distinct(byte *r, const byte *x)
     fe_mul__distinct(s, r, r);
     fe_mul__distinct(r, s, x);
 }
+#endif /* CURVED25519_SMALL_32BIT */
 
 
 void lm_invert(byte *r, const byte *x)
@@ -554,6 +903,33 @@ void lm_invert(byte *r, const byte *x)
 }
 
 
+#ifdef CURVED25519_SMALL_32BIT
+void fe_sqrt(byte *r, const byte *a)
+{
+    fe32 fa;
+    fe32 v;
+    fe32 i;
+    fe32 x;
+
+    fe32_frombytes(fa, a);
+
+    /* v = (2a)^((p-5)/8) [x = 2a] */
+    fe32_mul_c(x, fa, 2);
+    fe32_pow250(v, i, x);
+    fe32_sqn(v, v, 2);          /* 2^252 - 4 */
+    fe32_mul(v, v, x);          /* 2^252 - 3 */
+
+    /* i = 2av^2 - 1 */
+    fe32_sq(i, v);
+    fe32_mul(i, i, x);
+    i[0] -= 1;
+
+    /* r = avi */
+    fe32_mul(x, v, fa);
+    fe32_mul(x, x, i);
+    fe32_tobytes(r, x);
+}
+#else
 /* Raise x to the power of (p-5)/8 = 2^252-3, using s for temporary
  * storage.
  */
@@ -606,6 +982,7 @@ void fe_sqrt(byte *r, const byte *a)
     fe_mul__distinct(x, v, a);
     fe_mul__distinct(r, x, i);
 }
+#endif /* CURVED25519_SMALL_32BIT */
 
 #endif /* CURVE25519_SMALL || ED25519_SMALL */
 #endif /* HAVE_CURVE25519 || HAVE_ED25519 */
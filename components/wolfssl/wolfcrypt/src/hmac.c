@@ -1439,6 +1439,311 @@ int wolfSSL_GetHmacMaxSize(void)
         return wc_HKDF_Expand(type, prk, hashSz, info, infoSz, out, outSz);
     }
 
+    /* Hash state helpers for the cached PRK. Only the SHA-2 family is
+     * supported; those are the hashes HKDF is used with in practice. */
+    static int HkdfHashCopy(int type, wc_HmacHash* src, wc_HmacHash* dst)
+    {
+        int ret;
+
+        switch (type) {
+        #ifdef WOLFSSL_SHA224
+            case WC_SHA224:
+                wc_Sha224Free(&dst->sha224);
+                ret = wc_Sha224Copy(&src->sha224, &dst->sha224);
+                break;
+        #endif /* WOLFSSL_SHA224 */
+        #ifndef NO_SHA256
+            case WC_SHA256:
+                wc_Sha256Free(&dst->sha256);
+                ret = wc_Sha256Copy(&src->sha256, &dst->sha256);
+                break;
+        #endif /* !NO_SHA256 */
+        #ifdef WOLFSSL_SHA384
+            case WC_SHA384:
+                wc_Sha384Free(&dst->sha384);
+                ret = wc_Sha384Copy(&src->sha384, &dst->sha384);
+                break;
+        #endif /* WOLFSSL_SHA384 */
+        #ifdef WOLFSSL_SHA512
+            case WC_SHA512:
+                wc_Sha512Free(&dst->sha512);
+                ret = wc_Sha512Copy(&src->sha512, &dst->sha512);
+                break;
+        #endif /* WOLFSSL_SHA512 */
+            default:
+                ret = BAD_FUNC_ARG;
+                break;
+        }
+
+        return ret;
+    }
+
+    static int HkdfHashFinal(int type, wc_HmacHash* hash, byte* out)
+    {
+        int ret;
+
+        switch (type) {
+        #ifdef WOLFSSL_SHA224
+            case WC_SHA224:
+                ret = wc_Sha224Final(&hash->sha224, out);
+                break;
+        #endif /* WOLFSSL_SHA224 */
+        #ifndef NO_SHA256
+            case WC_SHA256:
+                ret = wc_Sha256Final(&hash->sha256, out);
+                break;
+        #endif /* !NO_SHA256 */
+        #ifdef WOLFSSL_SHA384
+            case WC_SHA384:
+                ret = wc_Sha384Final(&hash->sha384, out);
+                break;
+        #endif /* WOLFSSL_SHA384 */
+        #ifdef WOLFSSL_SHA512
+            case WC_SHA512:
+                ret = wc_Sha512Final(&hash->sha512, out);
+                break;
+        #endif /* WOLFSSL_SHA512 */
+            default:
+                ret = BAD_FUNC_ARG;
+                break;
+        }
+
+        return ret;
+    }
+
+    static void HkdfHashFree(int type, wc_HmacHash* hash)
+    {
+        switch (type) {
+        #ifdef WOLFSSL_SHA224
+            case WC_SHA224:
+                wc_Sha224Free(&hash->sha224);
+                break;
+        #endif /* WOLFSSL_SHA224 */
+        #ifndef NO_SHA256
+            case WC_SHA256:
+                wc_Sha256Free(&hash->sha256);
+                break;
+        #endif /* !NO_SHA256 */
+        #ifdef WOLFSSL_SHA384
+            case WC_SHA384:
+                wc_Sha384Free(&hash->sha384);
+                break;
+        #endif /* WOLFSSL_SHA384 */
+        #ifdef WOLFSSL_SHA512
+            case WC_SHA512:
+                wc_Sha512Free(&hash->sha512);
+                break;
+        #endif /* WOLFSSL_SHA512 */
+            default:
+                break;
+        }
+    }
+
+    /* Load a pseudorandom key for repeated HMAC-KDF-Expand.
+     * The ipad and opad blocks are hashed once here and their states kept,
+     * so every wc_HKDF_Expand_Prk() call skips the HMAC key schedule.
+     *
+     * prk      The cached key to set up. Free with wc_HKDF_FreePrk().
+     * type     The hash algorithm type, one of the SHA-2 family.
+     * inKey    The pseudorandom key, e.g. the output of HKDF-Extract.
+     * inKeySz  The size of the pseudorandom key.
+     * heap     The heap hint.
+     * returns 0 on success, otherwise failure.
+     */
+    int wc_HKDF_SetPrk(HkdfPrk* prk, int type, const byte* inKey,
+                       word32 inKeySz, void* heap)
+    {
+        Hmac* hmac;
+        int   ret;
+
+        if (prk == NULL || (inKey == NULL && inKeySz != 0)) {
+            return BAD_FUNC_ARG;
+        }
+
+        XMEMSET(prk, 0, sizeof(*prk));
+        hmac = &prk->hmac;
+
+        ret = wc_HmacInit(hmac, heap, INVALID_DEVID);
+        if (ret != 0)
+            return ret;
+    #if FIPS_VERSION3_GE(6,0,0)
+        ret = wc_HmacSetKey_ex(hmac, type, inKey, inKeySz, FIPS_ALLOW_SHORT);
+    #else
+        ret = wc_HmacSetKey(hmac, type, inKey, inKeySz);
+    #endif
+
+        /* Inner state: the hash after the ipad block */
+        if (ret == 0)
+            ret = HmacKeyInnerHash(hmac);
+        if (ret == 0)
+            ret = HkdfHashCopy(type, &hmac->hash, &prk->inner);
+
+        /* Outer state: restart the hash and run it over the opad block */
+        if (ret == 0) {
+            HkdfHashFree(type, &hmac->hash);
+            ret = _InitHmac(hmac, type, heap);
+        }
+        if (ret == 0) {
+            XMEMCPY(hmac->ipad, hmac->opad, sizeof(hmac->ipad));
+            ret = HmacKeyInnerHash(hmac);
+        }
+        if (ret == 0)
+            ret = HkdfHashCopy(type, &hmac->hash, &prk->outer);
+
+        /* The pads are the key itself and are not needed any more */
+        ForceZero(hmac->ipad, sizeof(hmac->ipad));
+        ForceZero(hmac->opad, sizeof(hmac->opad));
+
+        if (ret != 0)
+            wc_HKDF_FreePrk(prk);
+
+        return ret;
+    }
+
+    /* HMAC-KDF-Extract into a cached pseudorandom key.
+     * Same as wc_HKDF_Extract() followed by wc_HKDF_SetPrk().
+     *
+     * prk      The cached key to set up. Free with wc_HKDF_FreePrk().
+     * type     The hash algorithm type, one of the SHA-2 family.
+     * salt     The optional salt value.
+     * saltSz   The size of the salt.
+     * inKey    The input keying material.
+     * inKeySz  The size of the input keying material.
+     * heap     The heap hint.
+     * returns 0 on success, otherwise failure.
+     */
+    int wc_HKDF_Extract_Prk(HkdfPrk* prk, int type, const byte* salt,
+                            word32 saltSz, const byte* inKey, word32 inKeySz,
+                            void* heap)
+    {
+        byte   key[WC_MAX_DIGEST_SIZE];
+        word32 hashSz;
+        int    ret;
+
+        if (prk == NULL) {
+            return BAD_FUNC_ARG;
+        }
+
+        ret = wc_HmacSizeByType(type);
+        if (ret < 0) {
+            return ret;
+        }
+        hashSz = (word32)ret;
+
+        ret = wc_HKDF_Extract_ex(type, salt, saltSz, inKey, inKeySz, key,
+            heap, INVALID_DEVID);
+        if (ret == 0)
+            ret = wc_HKDF_SetPrk(prk, type, key, hashSz, heap);
+
+        ForceZero(key, sizeof(key));
+        return ret;
+    }
+
+    /* HMAC-KDF-Expand from a cached pseudorandom key.
+     * Produces the same output as wc_HKDF_Expand() with the key given to
+     * wc_HKDF_SetPrk(), at two hash compressions per output block fewer.
+     *
+     * prk      The cached key. Not modified in a way visible to the caller,
+     *          any number of expands may follow one set up.
+     * info     The application specific information.
+     * infoSz   The size of the application specific information.
+     * out      The output keying material.
+     * outSz    The size of the output keying material.
+     * returns 0 on success, otherwise failure.
+     */
+    int wc_HKDF_Expand_Prk(HkdfPrk* prk, const byte* info, word32 infoSz,
+                           byte* out, word32 outSz)
+    {
+        byte   tmp[WC_MAX_DIGEST_SIZE];
+        Hmac*  hmac;
+        int    type;
+        int    ret;
+        word32 outIdx = 0;
+        word32 hashSz;
+        byte   n = 0x1;
+
+        if (prk == NULL || out == NULL || (info == NULL && infoSz != 0)) {
+            return BAD_FUNC_ARG;
+        }
+        hmac = &prk->hmac;
+        type = hmac->macType;
+
+        ret = wc_HmacSizeByType(type);
+        if (ret < 0) {
+            return ret;
+        }
+        hashSz = (word32)ret;
+        ret = 0;
+
+        /* RFC 5869: L <= 255*HashLen */
+        if (((outSz/hashSz) + ((outSz % hashSz) != 0)) > 255) {
+            return BAD_FUNC_ARG;
+        }
+
+        while (outIdx < outSz) {
+            word32 tmpSz = (n == 1) ? 0 : hashSz;
+            word32 left = outSz - outIdx;
+
+            /* inner hash: T(n-1) | info | n */
+            ret = HkdfHashCopy(type, &prk->inner, &hmac->hash);
+            if (ret != 0)
+                break;
+            hmac->innerHashKeyed = WC_HMAC_INNER_HASH_KEYED_SW;
+            ret = wc_HmacUpdate(hmac, tmp, tmpSz);
+            if (ret != 0)
+                break;
+            ret = wc_HmacUpdate(hmac, info, infoSz);
+            if (ret != 0)
+                break;
+            ret = wc_HmacUpdate(hmac, &n, 1);
+            if (ret != 0)
+                break;
+            ret = HkdfHashFinal(type, &hmac->hash, (byte*)hmac->innerHash);
+            if (ret != 0)
+                break;
+
+            /* outer hash over the inner digest */
+            ret = HkdfHashCopy(type, &prk->outer, &hmac->hash);
+            if (ret != 0)
+                break;
+            ret = wc_HmacUpdate(hmac, (byte*)hmac->innerHash, hashSz);
+            if (ret != 0)
+                break;
+            ret = HkdfHashFinal(type, &hmac->hash, tmp);
+            if (ret != 0)
+                break;
+
+            left = min(left, hashSz);
+            XMEMCPY(out+outIdx, tmp, left);
+
+            outIdx += hashSz;
+            n++;
+        }
+
+        ForceZero(tmp, sizeof(tmp));
+        ForceZero(hmac->innerHash, sizeof(hmac->innerHash));
+
+        return ret;
+    }
+
+    /* Release and zero a cached pseudorandom key.
+     *
+     * prk      The cached key, may be NULL.
+     */
+    void wc_HKDF_FreePrk(HkdfPrk* prk)
+    {
+        int type;
+
+        if (prk == NULL)
+            return;
+
+        type = prk->hmac.macType;
+        HkdfHashFree(type, &prk->inner);
+        HkdfHashFree(type, &prk->outer);
+        wc_HmacFree(&prk->hmac);
+        ForceZero(prk, sizeof(*prk));
+    }
+
 #endif /* HAVE_HKDF */
 
 #endif /* NO_HMAC */
@@ -262,6 +262,173 @@ static WC_INLINE void u32tole64(const word32 inLe32, byte outLe64[8])
 
 
 #if !defined(WOLFSSL_ARMASM) || !defined(__aarch64__)
+#if defined(POLY130532) && defined(WOLFSSL_POLY1305_4WAY)
+/* Smallest run of blocks worth calculating r^2..r^4 for. Each power costs
+ * a full multiplication, and only the carry chains are saved. */
+#ifndef POLY1305_4WAY_MIN_SIZE
+    #define POLY1305_4WAY_MIN_SIZE (16 * POLY1305_BLOCK_SIZE)
+#endif
+
+/* d += a * r, with s = r[1..4] * 5 */
+static WC_INLINE void poly1305_mul_acc(word64* d, const word32* a,
+    const word32* r, const word32* s)
+{
+    d[0] += ((word64)a[0] * r[0]) + ((word64)a[1] * s[3]) +
+            ((word64)a[2] * s[2]) + ((word64)a[3] * s[1]) +
+            ((word64)a[4] * s[0]);
+    d[1] += ((word64)a[0] * r[1]) + ((word64)a[1] * r[0]) +
+            ((word64)a[2] * s[3]) + ((word64)a[3] * s[2]) +
+            ((word64)a[4] * s[1]);
+    d[2] += ((word64)a[0] * r[2]) + ((word64)a[1] * r[1]) +
+            ((word64)a[2] * r[0]) + ((word64)a[3] * s[3]) +
+            ((word64)a[4] * s[2]);
+    d[3] += ((word64)a[0] * r[3]) + ((word64)a[1] * r[2]) +
+            ((word64)a[2] * r[1]) + ((word64)a[3] * r[0]) +
+            ((word64)a[4] * s[3]);
+    d[4] += ((word64)a[0] * r[4]) + ((word64)a[1] * r[3]) +
+            ((word64)a[2] * r[2]) + ((word64)a[3] * r[1]) +
+            ((word64)a[4] * r[0]);
+}
+
+/* (partial) h = d % p. Four products summed exceed 2^58, so the carries
+ * are kept in 64 bits. */
+static WC_INLINE void poly1305_carry(word32* h, const word64* d)
+{
+    word64 c, t;
+
+                         c = d[0] >> 26; h[0] = (word32)d[0] & 0x3ffffff;
+    t = d[1] + c;        c = t    >> 26; h[1] = (word32)t    & 0x3ffffff;
+    t = d[2] + c;        c = t    >> 26; h[2] = (word32)t    & 0x3ffffff;
+    t = d[3] + c;        c = t    >> 26; h[3] = (word32)t    & 0x3ffffff;
+    t = d[4] + c;        c = t    >> 26; h[4] = (word32)t    & 0x3ffffff;
+    t = h[0] + c * 5;    c = t    >> 26; h[0] = (word32)t    & 0x3ffffff;
+    h[1] += (word32)c;
+}
+
+/* Load a block as five 26-bit limbs, with the 2^128 bit set. The limbs are
+ * split out of four words rather than five overlapping unaligned reads,
+ * and aligned input on little-endian cores is read a word at a time. */
+static WC_INLINE void poly1305_load(word32* a, const unsigned char* m)
+{
+    word32 w0, w1, w2, w3;
+
+#ifdef LITTLE_ENDIAN_ORDER
+    if (((wc_ptr_t)m & 3) == 0) {
+        w0 = ((const word32*)m)[0];
+        w1 = ((const word32*)m)[1];
+        w2 = ((const word32*)m)[2];
+        w3 = ((const word32*)m)[3];
+    }
+    else
+#endif
+    {
+        w0 = U8TO32(m +  0);
+        w1 = U8TO32(m +  4);
+        w2 = U8TO32(m +  8);
+        w3 = U8TO32(m + 12);
+    }
+
+    a[0] = ( w0                    ) & 0x3ffffff;
+    a[1] = ((w0 >> 26) | (w1 <<  6)) & 0x3ffffff;
+    a[2] = ((w1 >> 20) | (w2 << 12)) & 0x3ffffff;
+    a[3] = ((w2 >> 14) | (w3 << 18)) & 0x3ffffff;
+    a[4] = ( w3 >>  8              ) | ((word32)1 << 24);
+}
+
+static WC_INLINE void poly1305_calc_s(word32* s, const word32* r)
+{
+    s[0] = r[1] * 5;
+    s[1] = r[2] * 5;
+    s[2] = r[3] * 5;
+    s[3] = r[4] * 5;
+}
+
+/* r^2, r^3 and r^4, calculated on the first long run of blocks for a key */
+static void poly1305_calc_powers(Poly1305* ctx)
+{
+    word64 d[5];
+    word32 s[4];
+
+    poly1305_calc_s(s, ctx->r);
+    XMEMSET(d, 0, sizeof(d));
+    poly1305_mul_acc(d, ctx->r, ctx->r, s);
+    poly1305_carry(ctx->r_2, d);
+
+    XMEMSET(d, 0, sizeof(d));
+    poly1305_mul_acc(d, ctx->r_2, ctx->r, s);
+    poly1305_carry(ctx->r_3, d);
+
+    poly1305_calc_s(s, ctx->r_2);
+    XMEMSET(d, 0, sizeof(d));
+    poly1305_mul_acc(d, ctx->r_2, ctx->r_2, s);
+    poly1305_carry(ctx->r_4, d);
+
+    ctx->started = 1;
+}
+
+/*
+Horner's rule over four blocks at a time,
+  h = (h + m0) * r^4 + m1 * r^3 + m2 * r^2 + m3 * r,
+then two at a time with r^2 and r. One carry chain per group of blocks
+instead of one per block. Returns the number of bytes processed.
+*/
+static size_t poly1305_blocks_4way(Poly1305* ctx, const unsigned char* m,
+    size_t bytes)
+{
+    word32 s1[4], s2[4], s3[4], s4[4];
+    word32 a[5];
+    word64 d[5];
+    size_t done = 0;
+
+    if (!ctx->started)
+        poly1305_calc_powers(ctx);
+
+    poly1305_calc_s(s1, ctx->r);
+    poly1305_calc_s(s2, ctx->r_2);
+    poly1305_calc_s(s3, ctx->r_3);
+    poly1305_calc_s(s4, ctx->r_4);
+
+    while (bytes - done >= 4 * POLY1305_BLOCK_SIZE) {
+        XMEMSET(d, 0, sizeof(d));
+        poly1305_load(a, m);
+        a[0] += ctx->h[0];
+        a[1] += ctx->h[1];
+        a[2] += ctx->h[2];
+        a[3] += ctx->h[3];
+        a[4] += ctx->h[4];
+        poly1305_mul_acc(d, a, ctx->r_4, s4);
+        poly1305_load(a, m + 1 * POLY1305_BLOCK_SIZE);
+        poly1305_mul_acc(d, a, ctx->r_3, s3);
+        poly1305_load(a, m + 2 * POLY1305_BLOCK_SIZE);
+        poly1305_mul_acc(d, a, ctx->r_2, s2);
+        poly1305_load(a, m + 3 * POLY1305_BLOCK_SIZE);
+        poly1305_mul_acc(d, a, ctx->r, s1);
+        poly1305_carry(ctx->h, d);
+
+        m += 4 * POLY1305_BLOCK_SIZE;
+        done += 4 * POLY1305_BLOCK_SIZE;
+    }
+
+    if (bytes - done >= 2 * POLY1305_BLOCK_SIZE) {
+        XMEMSET(d, 0, sizeof(d));
+        poly1305_load(a, m);
+        a[0] += ctx->h[0];
+        a[1] += ctx->h[1];
+        a[2] += ctx->h[2];
+        a[3] += ctx->h[3];
+        a[4] += ctx->h[4];
+        poly1305_mul_acc(d, a, ctx->r_2, s2);
+        poly1305_load(a, m + POLY1305_BLOCK_SIZE);
+        poly1305_mul_acc(d, a, ctx->r, s1);
+        poly1305_carry(ctx->h, d);
+
+        done += 2 * POLY1305_BLOCK_SIZE;
+    }
+
+    return done;
+}
+#endif /* POLY130532 && WOLFSSL_POLY1305_4WAY */
+
 /*
 This local function operates on a message with a given number of bytes
 with a given ctx pointer to a Poly1305 structure.
@@ -335,6 +502,13 @@ static int poly1305_blocks(Poly1305* ctx, const unsigned char *m,
     word64 d0,d1,d2,d3,d4;
     word32 c;
 
+#ifdef WOLFSSL_POLY1305_4WAY
+    if (bytes >= POLY1305_4WAY_MIN_SIZE && !ctx->finished) {
+        size_t done = poly1305_blocks_4way(ctx, m, bytes);
+        m += done;
+        bytes -= done;
+    }
+#endif
 
     r0 = ctx->r[0];
     r1 = ctx->r[1];
@@ -498,6 +672,9 @@ int wc_Poly1305SetKey(Poly1305* ctx, const byte* key, word32 keySz)
 
     ctx->leftover = 0;
     ctx->finished = 0;
+#ifdef WOLFSSL_POLY1305_4WAY
+    ctx->started = 0;
+#endif
 
 #endif
 
@@ -681,6 +858,14 @@ int wc_Poly1305Final(Poly1305* ctx, byte* mac)
     ctx->pad[1] = 0;
     ctx->pad[2] = 0;
     ctx->pad[3] = 0;
+#ifdef WOLFSSL_POLY1305_4WAY
+    if (ctx->started) {
+        ForceZero(ctx->r_2, sizeof(ctx->r_2));
+        ForceZero(ctx->r_3, sizeof(ctx->r_3));
+        ForceZero(ctx->r_4, sizeof(ctx->r_4));
+        ctx->started = 0;
+    }
+#endif
 
 #endif
 
@@ -867,6 +867,179 @@ static const word64 K512[80] = {
     d(i) += h(i); \
     h(i) += S0(a(i)) + Maj(a(i),b(i),c(i))
 
+#ifdef WOLFSSL_SHA512_32BIT
+/* SHA-512 rounds on 32-bit words, for cores without 64-bit registers. The
+ * working variables and the message schedule are kept as hi/lo halves, so
+ * the compiler does not have to emulate 64-bit rotates and adds on register
+ * pairs, and the state stays in registers across the unrolled rounds. */
+
+/* Multi-block hashing straight from the input, where Sha512Update would
+ * otherwise byte reverse every block into the buffer in software. */
+#if defined(LITTLE_ENDIAN_ORDER) && \
+    !(defined(WOLFSSL_X86_64_BUILD) && defined(USE_INTEL_SPEEDUP) && \
+      (defined(HAVE_INTEL_AVX1) || defined(HAVE_INTEL_AVX2))) && \
+    (!defined(WOLFSSL_ESP32_CRYPT) || defined(NO_WOLFSSL_ESP32_CRYPT_HASH) || \
+     defined(NO_WOLFSSL_ESP32_CRYPT_HASH_SHA512))
+    #define WC_SHA512_32BIT_LEN
+#endif
+
+/* (rh:rl) += (ah:al) */
+#define ADD64_32(rh, rl, ah, al) do {         \
+        word32 l_ = (al);                     \
+        (rl) += l_;                           \
+        (rh) += (ah) + ((rl) < l_);           \
+    } while (0)
+
+/* High and low half of (h:l) rotated right by 0 < n < 32. Rotations by
+ * n >= 32 swap the halves and rotate by n - 32. */
+#define ROTR_HI(h, l, n) (((h) >> (n)) | ((l) << (32 - (n))))
+#define ROTR_LO(h, l, n) (((l) >> (n)) | ((h) << (32 - (n))))
+
+#define S0_HI(h, l) (ROTR_HI(h, l, 28) ^ ROTR_HI(l, h,  2) ^ ROTR_HI(l, h,  7))
+#define S0_LO(h, l) (ROTR_LO(h, l, 28) ^ ROTR_LO(l, h,  2) ^ ROTR_LO(l, h,  7))
+#define S1_HI(h, l) (ROTR_HI(h, l, 14) ^ ROTR_HI(h, l, 18) ^ ROTR_HI(l, h,  9))
+#define S1_LO(h, l) (ROTR_LO(h, l, 14) ^ ROTR_LO(h, l, 18) ^ ROTR_LO(l, h,  9))
+#define s0_HI(h, l) (ROTR_HI(h, l,  1) ^ ROTR_HI(h, l,  8) ^ ((h) >> 7))
+#define s0_LO(h, l) (ROTR_LO(h, l,  1) ^ ROTR_LO(h, l,  8) ^ ROTR_LO(h, l, 7))
+#define s1_HI(h, l) (ROTR_HI(h, l, 19) ^ ROTR_HI(l, h, 29) ^ ((h) >> 6))
+#define s1_LO(h, l) (ROTR_LO(h, l, 19) ^ ROTR_LO(l, h, 29) ^ ROTR_LO(h, l, 6))
+
+/* W[i] += s1(W[i-2]) + W[i-7] + s0(W[i-15]) */
+#define BLK2_32(i) do {                                                  \
+        word32 h2_ = Wh[((i)-2) & 15], l2_ = Wl[((i)-2) & 15];           \
+        word32 h15_ = Wh[((i)-15) & 15], l15_ = Wl[((i)-15) & 15];       \
+        ADD64_32(Wh[i], Wl[i], s1_HI(h2_, l2_), s1_LO(h2_, l2_));        \
+        ADD64_32(Wh[i], Wl[i], Wh[((i)-7) & 15], Wl[((i)-7) & 15]);      \
+        ADD64_32(Wh[i], Wl[i], s0_HI(h15_, l15_), s0_LO(h15_, l15_));    \
+    } while (0)
+
+#define R32(i) do {                                                      \
+        const int a_ = (0-(i)) & 7, b_ = (1-(i)) & 7, c_ = (2-(i)) & 7,  \
+                  d_ = (3-(i)) & 7, e_ = (4-(i)) & 7, f_ = (5-(i)) & 7,  \
+                  g_ = (6-(i)) & 7, h_ = (7-(i)) & 7;                    \
+        word32 th_ = Th[h_], tl_ = Tl[h_];                               \
+        if (j) BLK2_32(i);                                               \
+        ADD64_32(th_, tl_, S1_HI(Th[e_], Tl[e_]), S1_LO(Th[e_], Tl[e_])); \
+        ADD64_32(th_, tl_, Ch(Th[e_], Th[f_], Th[g_]),                   \
+                           Ch(Tl[e_], Tl[f_], Tl[g_]));                  \
+        ADD64_32(th_, tl_, (word32)(K[(i)+j] >> 32), (word32)K[(i)+j]);  \
+        ADD64_32(th_, tl_, Wh[i], Wl[i]);                                \
+        ADD64_32(Th[d_], Tl[d_], th_, tl_);                              \
+        ADD64_32(th_, tl_, S0_HI(Th[a_], Tl[a_]), S0_LO(Th[a_], Tl[a_])); \
+        ADD64_32(th_, tl_, Maj(Th[a_], Th[b_], Th[c_]),                  \
+                           Maj(Tl[a_], Tl[b_], Tl[c_]));                 \
+        Th[h_] = th_; Tl[h_] = tl_;                                      \
+    } while (0)
+
+/* Compresses one block, W holding the message words as hi/lo halves, into
+ * the hi/lo state S. */
+static void Sha512Compress32(word32* Sh, word32* Sl, word32* Wh, word32* Wl)
+{
+    const word64* K = K512;
+    word32 Th[8], Tl[8];
+    word32 j;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        Th[i] = Sh[i];
+        Tl[i] = Sl[i];
+    }
+
+    /* 80 operations, the message schedule unrolled along with the rounds */
+    for (j = 0; j < 80; j += 16) {
+        R32( 0); R32( 1); R32( 2); R32( 3);
+        R32( 4); R32( 5); R32( 6); R32( 7);
+        R32( 8); R32( 9); R32(10); R32(11);
+        R32(12); R32(13); R32(14); R32(15);
+    }
+
+    for (i = 0; i < 8; i++) {
+        ADD64_32(Sh[i], Sl[i], Th[i], Tl[i]);
+    }
+
+    ForceZero(Th, sizeof(Th));
+    ForceZero(Tl, sizeof(Tl));
+}
+
+static void Sha512LoadState32(const wc_Sha512* sha512, word32* Sh, word32* Sl)
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        Sh[i] = (word32)(sha512->digest[i] >> 32);
+        Sl[i] = (word32)sha512->digest[i];
+    }
+}
+
+static void Sha512StoreState32(wc_Sha512* sha512, const word32* Sh,
+                               const word32* Sl)
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        sha512->digest[i] = ((word64)Sh[i] << 32) | Sl[i];
+    }
+}
+
+static int _Transform_Sha512(wc_Sha512* sha512)
+{
+    word32 Sh[8], Sl[8];
+    word32 Wh[16], Wl[16];
+    int i;
+
+    /* the buffer holds the block in host order */
+    for (i = 0; i < 16; i++) {
+        Wh[i] = (word32)(sha512->buffer[i] >> 32);
+        Wl[i] = (word32)sha512->buffer[i];
+    }
+
+    Sha512LoadState32(sha512, Sh, Sl);
+    Sha512Compress32(Sh, Sl, Wh, Wl);
+    Sha512StoreState32(sha512, Sh, Sl);
+
+    ForceZero(Wh, sizeof(Wh));
+    ForceZero(Wl, sizeof(Wl));
+
+    return 0;
+}
+
+#ifdef WC_SHA512_32BIT_LEN
+/* Hashes len bytes, a multiple of the block size, straight from the input:
+ * the big-endian words are loaded into the schedule without copying through
+ * the buffer and byte reversing it, and the state is only converted once. */
+#define LOAD_BE32(p) (((word32)(p)[0] << 24) | ((word32)(p)[1] << 16) | \
+                      ((word32)(p)[2] <<  8) |  (word32)(p)[3])
+
+static int Transform_Sha512_32_Len(wc_Sha512* sha512, const byte* data,
+                                   word32 len)
+{
+    word32 Sh[8], Sl[8];
+    word32 Wh[16], Wl[16];
+    int i;
+
+    Sha512LoadState32(sha512, Sh, Sl);
+
+    for (; len >= WC_SHA512_BLOCK_SIZE; len -= WC_SHA512_BLOCK_SIZE) {
+        for (i = 0; i < 16; i++) {
+            Wh[i] = LOAD_BE32(data + 8 * i);
+            Wl[i] = LOAD_BE32(data + 8 * i + 4);
+        }
+        data += WC_SHA512_BLOCK_SIZE;
+
+        Sha512Compress32(Sh, Sl, Wh, Wl);
+    }
+
+    Sha512StoreState32(sha512, Sh, Sl);
+
+    ForceZero(Wh, sizeof(Wh));
+    ForceZero(Wl, sizeof(Wl));
+
+    return 0;
+}
+#endif /* WC_SHA512_32BIT_LEN */
+
+#else
+
 static int _Transform_Sha512(wc_Sha512* sha512)
 {
     const word64* K = K512;
@@ -932,6 +1105,7 @@ static int _Transform_Sha512(wc_Sha512* sha512)
 
     return 0;
 }
+#endif /* WOLFSSL_SHA512_32BIT */
 
 
 static WC_INLINE void AddLength(wc_Sha512* sha512, word32 len)
@@ -1061,6 +1235,16 @@ static WC_INLINE int Sha512Update(wc_Sha512* sha512, const byte* data, word32 le
                 break;
         }
     }
+#elif defined(WC_SHA512_32BIT_LEN)
+    {
+        word32 blocksLen = len & ~((word32)WC_SHA512_BLOCK_SIZE-1);
+
+        if (blocksLen > 0) {
+            ret = Transform_Sha512_32_Len(sha512, data, blocksLen);
+            data += blocksLen;
+            len  -= blocksLen;
+        }
+    }
 #else
     {
         while (len >= WC_SHA512_BLOCK_SIZE) {
@@ -321,6 +321,11 @@ void wc_SrpTerm(Srp* srp)
             XFREE(srp->key, srp->heap, DYNAMIC_TYPE_SRP);
         }
 
+#ifdef WC_SRP_NONBLOCK
+        if (srp->nb)
+            ForceZero(srp->nb, sizeof(SrpNb));
+#endif
+
         SrpHashFree(&srp->client_proof);
         SrpHashFree(&srp->server_proof);
         ForceZero(srp, sizeof(Srp));
@@ -699,24 +704,191 @@ static int wc_SrpSetKey(Srp* srp, byte* secret, word32 size)
     return r;
 }
 
-int wc_SrpComputeKey(Srp* srp, byte* clientPubKey, word32 clientPubKeySz,
-                               byte* serverPubKey, word32 serverPubKeySz)
+/* u = H(PAD(A) | PAD(B)), the random scrambling parameter. */
+static int SrpComputeU(Srp* srp, const byte* clientPubKey,
+                       word32 clientPubKeySz, const byte* serverPubKey,
+                       word32 serverPubKeySz, mp_int* u)
 {
 #ifdef WOLFSSL_SMALL_STACK
     SrpHash *hash = NULL;
     byte *digest = NULL;
+#else
+    SrpHash hash[1];
+    byte digest[SRP_MAX_DIGEST_SIZE];
+#endif
+    word32 i, modulusSz;
+    byte pad = 0;
+    int r;
+
+    modulusSz = (word32)mp_unsigned_bin_size(&srp->N);
+
+    if ((modulusSz < clientPubKeySz) || (modulusSz < serverPubKeySz))
+        return BAD_FUNC_ARG;
+
+#ifdef WOLFSSL_SMALL_STACK
+    hash = (SrpHash *)XMALLOC(sizeof *hash, srp->heap, DYNAMIC_TYPE_SRP);
+    digest = (byte *)XMALLOC(SRP_MAX_DIGEST_SIZE, srp->heap, DYNAMIC_TYPE_SRP);
+
+    if ((hash == NULL) || (digest == NULL)) {
+        r = MEMORY_E;
+        goto out;
+    }
+#endif
+
+    if ((r = SrpHashInit(hash, srp->type, srp->heap)) != 0)
+        goto out;
+
+    /* H(A) */
+    for (i = 0; i < modulusSz - clientPubKeySz; i++) {
+        if ((r = SrpHashUpdate(hash, &pad, 1)))
+            goto free_hash;
+    }
+
+    if ((r = SrpHashUpdate(hash, clientPubKey, clientPubKeySz)))
+        goto free_hash;
+
+    /* H(A | B) */
+    for (i = 0; i < modulusSz - serverPubKeySz; i++) {
+        if ((r = SrpHashUpdate(hash, &pad, 1)))
+            goto free_hash;
+    }
+    if ((r = SrpHashUpdate(hash, serverPubKey, serverPubKeySz)))
+        goto free_hash;
+
+    /* set u */
+    if ((r = SrpHashFinal(hash, digest)))
+        goto free_hash;
+    r = mp_read_unsigned_bin(u, digest, SrpHashSize(srp->type));
+
+  free_hash:
+    SrpHashFree(hash);
+
+  out:
+
+#ifdef WOLFSSL_SMALL_STACK
+    if (hash)
+        XFREE(hash, srp->heap, DYNAMIC_TYPE_SRP);
+    if (digest)
+        XFREE(digest, srp->heap, DYNAMIC_TYPE_SRP);
+#endif
+
+    return r;
+}
+
+/* Client side base and exponent of the secret, with temp2 = g ^ x % N on
+ * entry: temp1 = B - k * v and temp2 = a + u * x.
+ * Rejects k == 0, B == 0 and B >= N. */
+static int SrpClientSecretArgs(Srp* srp, const byte* serverPubKey,
+                               word32 serverPubKeySz, mp_int* u, mp_int* s,
+                               mp_int* temp1, mp_int* temp2)
+{
+    int r;
+
+    if ((r = mp_read_unsigned_bin(temp1, srp->k, SrpHashSize(srp->type))))
+        return r;
+    if (mp_iszero(temp1) == MP_YES)
+        return SRP_BAD_KEY_E;
+    if ((r = mp_mulmod(temp1, temp2, &srp->N, s)))
+        return r;
+    if ((r = mp_read_unsigned_bin(temp2, serverPubKey, serverPubKeySz)))
+        return r;
+    if (mp_iszero(temp2) == MP_YES)
+        return SRP_BAD_KEY_E;
+    if (mp_cmp(temp2, &srp->N) != MP_LT)
+        return SRP_BAD_KEY_E;
+    if ((r = mp_submod(temp2, s, &srp->N, temp1)))
+        return r;
+
+    /* temp2 = a + u * x */
+    if ((r = mp_mulmod(u, &srp->auth, &srp->N, s)))
+        return r;
+
+    return mp_add(&srp->priv, s, temp2);
+}
+
+/* Server side base of the secret, with temp1 = v ^ u % N on entry:
+ * temp2 = A * temp1 % N. Rejects A == 0, A >= N and a result of 0, 1 or
+ * -1 % N. */
+static int SrpServerSecretBase(Srp* srp, const byte* clientPubKey,
+                               word32 clientPubKeySz, mp_int* s,
+                               mp_int* temp1, mp_int* temp2)
+{
+    int r;
+
+    if ((r = mp_read_unsigned_bin(s, clientPubKey, clientPubKeySz)))
+        return r;
+    if (mp_iszero(s) == MP_YES)
+        return SRP_BAD_KEY_E;
+    if (mp_cmp(s, &srp->N) != MP_LT)
+        return SRP_BAD_KEY_E;
+    if ((r = mp_mulmod(s, temp1, &srp->N, temp2)))
+        return r;
+
+    /* rejects A * v ^ u % N >= 1, A * v ^ u % N == -1 % N */
+    if ((r = mp_read_unsigned_bin(temp1, (const byte*)"\001", 1)))
+        return r;
+    if (mp_cmp(temp2, temp1) != MP_GT)
+        return SRP_BAD_KEY_E;
+    if ((r = mp_sub(&srp->N, temp1, s)))
+        return r;
+    if (mp_cmp(temp2, s) == MP_EQ)
+        return SRP_BAD_KEY_E;
+
+    return 0;
+}
+
+/* Derives the session key from the secret s and feeds A, B and K into the
+ * proofs. */
+static int SrpSetSessionKey(Srp* srp, mp_int* s, byte* clientPubKey,
+                            word32 clientPubKeySz, byte* serverPubKey,
+                            word32 serverPubKeySz)
+{
+    byte *secret;
+    word32 secretSz = (word32)mp_unsigned_bin_size(&srp->N);
+    int r;
+
+    if ((secret = (byte*)XMALLOC(secretSz, srp->heap, DYNAMIC_TYPE_SRP)) == NULL)
+        return MEMORY_E;
+
+    /* building session key from secret */
+
+    if ((r = mp_to_unsigned_bin(s, secret)))
+        goto out;
+    if ((r = srp->keyGenFunc_cb(srp, secret, (word32)mp_unsigned_bin_size(s))))
+        goto out;
+
+    /* updating client proof = H( H(N) ^ H(g) | H(user) | salt | A | B | K) */
+
+    if ((r = SrpHashUpdate(&srp->client_proof, clientPubKey, clientPubKeySz)))
+        goto out;
+    if ((r = SrpHashUpdate(&srp->client_proof, serverPubKey, serverPubKeySz)))
+        goto out;
+    if ((r = SrpHashUpdate(&srp->client_proof, srp->key,     srp->keySz)))
+        goto out;
+
+    /* updating server proof = H(A) */
+
+    r = SrpHashUpdate(&srp->server_proof, clientPubKey, clientPubKeySz);
+
+  out:
+
+    ForceZero(secret, secretSz);
+    XFREE(secret, srp->heap, DYNAMIC_TYPE_SRP);
+
+    return r;
+}
+
+int wc_SrpComputeKey(Srp* srp, byte* clientPubKey, word32 clientPubKeySz,
+                               byte* serverPubKey, word32 serverPubKeySz)
+{
+#ifdef WOLFSSL_SMALL_STACK
     mp_int *u = NULL;
     mp_int *s = NULL;
     mp_int *temp1 = NULL;
     mp_int *temp2 = NULL;
 #else
-    SrpHash hash[1];
-    byte digest[SRP_MAX_DIGEST_SIZE];
     mp_int u[1], s[1], temp1[1], temp2[1];
 #endif
-    byte *secret = NULL;
-    word32 i, secretSz, digestSz;
-    byte pad = 0;
     int r;
 
     /* validating params */
@@ -727,16 +899,12 @@ int wc_SrpComputeKey(Srp* srp, byte* clientPubKey, word32 clientPubKeySz,
     }
 
 #ifdef WOLFSSL_SMALL_STACK
-    hash = (SrpHash *)XMALLOC(sizeof *hash, srp->heap, DYNAMIC_TYPE_SRP);
-    digest = (byte *)XMALLOC(SRP_MAX_DIGEST_SIZE, srp->heap, DYNAMIC_TYPE_SRP);
     u = (mp_int *)XMALLOC(sizeof *u, srp->heap, DYNAMIC_TYPE_SRP);
     s = (mp_int *)XMALLOC(sizeof *s, srp->heap, DYNAMIC_TYPE_SRP);
     temp1 = (mp_int *)XMALLOC(sizeof *temp1, srp->heap, DYNAMIC_TYPE_SRP);
     temp2 = (mp_int *)XMALLOC(sizeof *temp2, srp->heap, DYNAMIC_TYPE_SRP);
 
-    if ((hash == NULL) ||
-        (digest == NULL) ||
-        (u == NULL) ||
+    if ((u == NULL) ||
         (s == NULL) ||
         (temp1 == NULL) ||
         (temp2 == NULL)) {
@@ -755,82 +923,21 @@ int wc_SrpComputeKey(Srp* srp, byte* clientPubKey, word32 clientPubKeySz,
         goto out;
     }
 
-    /* initializing variables */
-
-    if ((r = SrpHashInit(hash, srp->type, srp->heap)) != 0)
-        goto out;
-
-    digestSz = SrpHashSize(srp->type);
-    secretSz = (word32)mp_unsigned_bin_size(&srp->N);
-
-    if ((secretSz < clientPubKeySz) || (secretSz < serverPubKeySz)) {
-        r = BAD_FUNC_ARG;
-        goto out;
-    }
-
-    if ((secret = (byte*)XMALLOC(secretSz, srp->heap, DYNAMIC_TYPE_SRP)) == NULL) {
-        r = MEMORY_E;
-        goto out;
-    }
-
     /* building u (random scrambling parameter) */
 
-    /* H(A) */
-    for (i = 0; i < secretSz - clientPubKeySz; i++) {
-        if ((r = SrpHashUpdate(hash, &pad, 1)))
-            goto out;
-    }
-
-    if ((r = SrpHashUpdate(hash, clientPubKey, clientPubKeySz)))
-        goto out;
-
-    /* H(A | B) */
-    for (i = 0; i < secretSz - serverPubKeySz; i++) {
-        if ((r = SrpHashUpdate(hash, &pad, 1)))
-            goto out;
-    }
-    if ((r = SrpHashUpdate(hash, serverPubKey, serverPubKeySz)))
+    if ((r = SrpComputeU(srp, clientPubKey, clientPubKeySz,
+                         serverPubKey, serverPubKeySz, u)))
         goto out;
 
-    /* set u */
-    if ((r = SrpHashFinal(hash, digest)))
-        goto out;
-    if ((r = mp_read_unsigned_bin(u, digest, SrpHashSize(srp->type))))
-        goto out;
-    SrpHashFree(hash);
-
     /* building s (secret) */
 
     if (srp->side == SRP_CLIENT_SIDE) {
 
-        /* temp1 = B - k * v; rejects k == 0, B == 0 and B >= N. */
-        if ((r = mp_read_unsigned_bin(temp1, srp->k, digestSz)))
-            goto out;
-        if (mp_iszero(temp1) == MP_YES) {
-            r = SRP_BAD_KEY_E;
-            goto out;
-        }
+        /* temp1 = B - k * v, temp2 = a + u * x */
         if ((r = mp_exptmod(&srp->g, &srp->auth, &srp->N, temp2)))
             goto out;
-        if ((r = mp_mulmod(temp1, temp2, &srp->N, s)))
-            goto out;
-        if ((r = mp_read_unsigned_bin(temp2, serverPubKey, serverPubKeySz)))
-            goto out;
-        if (mp_iszero(temp2) == MP_YES) {
-            r = SRP_BAD_KEY_E;
-            goto out;
-        }
-        if (mp_cmp(temp2, &srp->N) != MP_LT) {
-            r = SRP_BAD_KEY_E;
-            goto out;
-        }
-        if ((r = mp_submod(temp2, s, &srp->N, temp1)))
-            goto out;
-
-        /* temp2 = a + u * x */
-        if ((r = mp_mulmod(u, &srp->auth, &srp->N, s)))
-            goto out;
-        if ((r = mp_add(&srp->priv, s, temp2)))
+        if ((r = SrpClientSecretArgs(srp, serverPubKey, serverPubKeySz,
+                                     u, s, temp1, temp2)))
             goto out;
 
         /* secret = temp1 ^ temp2 % N */
@@ -842,71 +949,22 @@ int wc_SrpComputeKey(Srp* srp, byte* clientPubKey, word32 clientPubKeySz,
         if ((r = mp_exptmod(&srp->auth, u, &srp->N, temp1)))
             goto out;
 
-        /* temp2 = A * temp1 % N; rejects A == 0, A >= N */
-        if ((r = mp_read_unsigned_bin(s, clientPubKey, clientPubKeySz)))
-            goto out;
-        if (mp_iszero(s) == MP_YES) {
-            r = SRP_BAD_KEY_E;
-            goto out;
-        }
-        if (mp_cmp(s, &srp->N) != MP_LT) {
-            r = SRP_BAD_KEY_E;
-            goto out;
-        }
-        if ((r = mp_mulmod(s, temp1, &srp->N, temp2)))
-            goto out;
-
-        /* rejects A * v ^ u % N >= 1, A * v ^ u % N == -1 % N */
-        if ((r = mp_read_unsigned_bin(temp1, (const byte*)"\001", 1)))
+        /* temp2 = A * temp1 % N */
+        if ((r = SrpServerSecretBase(srp, clientPubKey, clientPubKeySz,
+                                     s, temp1, temp2)))
             goto out;
-        if (mp_cmp(temp2, temp1) != MP_GT) {
-            r = SRP_BAD_KEY_E;
-            goto out;
-        }
-        if ((r = mp_sub(&srp->N, temp1, s)))
-            goto out;
-        if (mp_cmp(temp2, s) == MP_EQ) {
-            r = SRP_BAD_KEY_E;
-            goto out;
-        }
 
         /* secret = temp2 * b % N */
         if ((r = mp_exptmod(temp2, &srp->priv, &srp->N, s)))
             goto out;
     }
 
-    /* building session key from secret */
-
-    if ((r = mp_to_unsigned_bin(s, secret)))
-        goto out;
-    if ((r = srp->keyGenFunc_cb(srp, secret, (word32)mp_unsigned_bin_size(s))))
-        goto out;
-
-    /* updating client proof = H( H(N) ^ H(g) | H(user) | salt | A | B | K) */
-
-    if ((r = SrpHashUpdate(&srp->client_proof, clientPubKey, clientPubKeySz)))
-        goto out;
-    if ((r = SrpHashUpdate(&srp->client_proof, serverPubKey, serverPubKeySz)))
-        goto out;
-    if ((r = SrpHashUpdate(&srp->client_proof, srp->key,     srp->keySz)))
-        goto out;
-
-    /* updating server proof = H(A) */
-
-    r = SrpHashUpdate(&srp->server_proof, clientPubKey, clientPubKeySz);
+    r = SrpSetSessionKey(srp, s, clientPubKey, clientPubKeySz,
+                         serverPubKey, serverPubKeySz);
 
   out:
 
-    if (secret) {
-        ForceZero(secret, secretSz);
-        XFREE(secret, srp->heap, DYNAMIC_TYPE_SRP);
-    }
-
 #ifdef WOLFSSL_SMALL_STACK
-    if (hash)
-        XFREE(hash, srp->heap, DYNAMIC_TYPE_SRP);
-    if (digest)
-        XFREE(digest, srp->heap, DYNAMIC_TYPE_SRP);
     if (u) {
         if (r != WC_NO_ERR_TRACE(MP_INIT_E))
             mp_clear(u);
@@ -939,6 +997,193 @@ int wc_SrpComputeKey(Srp* srp, byte* clientPubKey, word32 clientPubKeySz,
     return r;
 }
 
+#ifdef WC_SRP_NONBLOCK
+
+/* Steps of wc_SrpGetPublic_nb and wc_SrpComputeKey_nb. Each call runs one
+ * step, or one step of the fp_exptmod_nb state machine in the EXPTMOD
+ * states, so no call does more than a single 3072-bit multiply and
+ * reduction. */
+enum {
+    SRP_NB_INIT = 0,
+    SRP_NB_EXPTMOD1,
+    SRP_NB_COMBINE,
+    SRP_NB_EXPTMOD2
+};
+
+static void SrpNbReset(SrpNb* nb)
+{
+    /* also wipes the ladder registers of the exponentiation */
+    ForceZero(nb, sizeof(SrpNb));
+}
+
+int wc_SrpSetNonBlock(Srp* srp, SrpNb* nb)
+{
+    if (srp == NULL)
+        return BAD_FUNC_ARG;
+
+    if (nb) {
+        XMEMSET(nb, 0, sizeof(SrpNb));
+    }
+
+    /* Allow nb == NULL to clear non-block mode */
+    srp->nb = nb;
+
+    return 0;
+}
+
+int wc_SrpGetPublic_nb(Srp* srp, byte* pub, word32* size)
+{
+    SrpNb* nb;
+    word32 modulusSz;
+    int r = 0;
+
+    if (!srp || !srp->nb || !pub || !size)
+        return BAD_FUNC_ARG;
+
+    nb = srp->nb;
+    modulusSz = (word32)mp_unsigned_bin_size(&srp->N);
+
+    switch (nb->state) {
+        case SRP_NB_INIT:
+            if (mp_iszero(&srp->auth) == MP_YES)
+                return SRP_CALL_ORDER_E;
+            if (*size < modulusSz)
+                return BUFFER_E;
+            if (mp_init_multi(&nb->u, &nb->s, &nb->t1, &nb->t2, 0, 0) != MP_OKAY)
+                return MP_INIT_E;
+
+            /* priv = random() */
+            if (mp_iszero(&srp->priv) == MP_YES)
+                r = wc_SrpGenPrivate(srp, pub, SRP_PRIVATE_KEY_MIN_BITS / 8);
+            if (!r) nb->state = SRP_NB_EXPTMOD1;
+            break;
+
+        case SRP_NB_EXPTMOD1:
+            /* t1 = g ^ b % N, client side: A = g ^ a % N */
+            r = fp_exptmod_nb(&nb->exptmod, &srp->g, &srp->priv, &srp->N,
+                              &nb->t1);
+            if (r == FP_WOULDBLOCK)
+                return r;
+            if (!r) nb->state = SRP_NB_COMBINE;
+            if (!r && srp->side == SRP_CLIENT_SIDE)
+                goto done;
+            break;
+
+        case SRP_NB_COMBINE:
+            /* server side: B = (k * v + (g ^ b % N)) % N */
+            r = mp_read_unsigned_bin(&nb->t2, srp->k, SrpHashSize(srp->type));
+            if (!r) r = mp_iszero(&nb->t2) == MP_YES ? SRP_BAD_KEY_E : 0;
+            if (!r) r = mp_mulmod(&nb->t2, &srp->auth, &srp->N, &nb->s);
+            if (!r) r = mp_addmod(&nb->t1, &nb->s, &srp->N, &nb->t1);
+            if (!r)
+                goto done;
+            break;
+
+        default:
+            r = BAD_STATE_E;
+            break;
+    }
+
+    if (r) {
+        SrpNbReset(nb);
+        return r;
+    }
+
+    return FP_WOULDBLOCK;
+
+  done:
+
+    /* extract public key to buffer */
+    XMEMSET(pub, 0, modulusSz);
+    r = mp_to_unsigned_bin(&nb->t1, pub);
+    if (!r) *size = (word32)mp_unsigned_bin_size(&nb->t1);
+
+    SrpNbReset(nb);
+
+    return r;
+}
+
+int wc_SrpComputeKey_nb(Srp* srp, byte* clientPubKey, word32 clientPubKeySz,
+                                  byte* serverPubKey, word32 serverPubKeySz)
+{
+    SrpNb* nb;
+    int r = 0;
+
+    if (!srp || !srp->nb || !clientPubKey || clientPubKeySz == 0
+        || !serverPubKey || serverPubKeySz == 0) {
+        return BAD_FUNC_ARG;
+    }
+
+    nb = srp->nb;
+
+    switch (nb->state) {
+        case SRP_NB_INIT:
+            if (mp_iszero(&srp->priv) == MP_YES)
+                return SRP_CALL_ORDER_E;
+            if (mp_init_multi(&nb->u, &nb->s, &nb->t1, &nb->t2, 0, 0) != MP_OKAY)
+                return MP_INIT_E;
+
+            r = SrpComputeU(srp, clientPubKey, clientPubKeySz,
+                            serverPubKey, serverPubKeySz, &nb->u);
+            if (!r) nb->state = SRP_NB_EXPTMOD1;
+            break;
+
+        case SRP_NB_EXPTMOD1:
+            if (srp->side == SRP_CLIENT_SIDE)
+                /* t2 = g ^ x % N */
+                r = fp_exptmod_nb(&nb->exptmod, &srp->g, &srp->auth, &srp->N,
+                                  &nb->t2);
+            else
+                /* t1 = v ^ u % N */
+                r = fp_exptmod_nb(&nb->exptmod, &srp->auth, &nb->u, &srp->N,
+                                  &nb->t1);
+            if (r == FP_WOULDBLOCK)
+                return r;
+            if (!r) nb->state = SRP_NB_COMBINE;
+            break;
+
+        case SRP_NB_COMBINE:
+            if (srp->side == SRP_CLIENT_SIDE)
+                r = SrpClientSecretArgs(srp, serverPubKey, serverPubKeySz,
+                                        &nb->u, &nb->s, &nb->t1, &nb->t2);
+            else
+                r = SrpServerSecretBase(srp, clientPubKey, clientPubKeySz,
+                                        &nb->s, &nb->t1, &nb->t2);
+            if (!r) nb->state = SRP_NB_EXPTMOD2;
+            break;
+
+        case SRP_NB_EXPTMOD2:
+            if (srp->side == SRP_CLIENT_SIDE)
+                /* secret = t1 ^ t2 % N */
+                r = fp_exptmod_nb(&nb->exptmod, &nb->t1, &nb->t2, &srp->N,
+                                  &nb->s);
+            else
+                /* secret = t2 ^ b % N */
+                r = fp_exptmod_nb(&nb->exptmod, &nb->t2, &srp->priv, &srp->N,
+                                  &nb->s);
+            if (r == FP_WOULDBLOCK)
+                return r;
+            if (!r) r = SrpSetSessionKey(srp, &nb->s, clientPubKey,
+                                         clientPubKeySz, serverPubKey,
+                                         serverPubKeySz);
+            SrpNbReset(nb);
+            return r;
+
+        default:
+            r = BAD_STATE_E;
+            break;
+    }
+
+    if (r) {
+        SrpNbReset(nb);
+        return r;
+    }
+
+    return FP_WOULDBLOCK;
+}
+
+#endif /* WC_SRP_NONBLOCK */
+
 int wc_SrpGetProof(Srp* srp, byte* proof, word32* size)
 {
     int r;
@@ -7880,6 +7880,58 @@ WOLFSSL_TEST_SUBROUTINE wc_test_ret_t poly1305_test(void)
         0x61,0x16
     };
 
+    /* RFC 8439 A.3 test vector #3, long enough for the multi-block path */
+    WOLFSSL_SMALL_STACK_STATIC const byte msg7[] =
+    {
+        0x41,0x6e,0x79,0x20,0x73,0x75,0x62,0x6d,
+        0x69,0x73,0x73,0x69,0x6f,0x6e,0x20,0x74,
+        0x6f,0x20,0x74,0x68,0x65,0x20,0x49,0x45,
+        0x54,0x46,0x20,0x69,0x6e,0x74,0x65,0x6e,
+        0x64,0x65,0x64,0x20,0x62,0x79,0x20,0x74,
+        0x68,0x65,0x20,0x43,0x6f,0x6e,0x74,0x72,
+        0x69,0x62,0x75,0x74,0x6f,0x72,0x20,0x66,
+        0x6f,0x72,0x20,0x70,0x75,0x62,0x6c,0x69,
+        0x63,0x61,0x74,0x69,0x6f,0x6e,0x20,0x61,
+        0x73,0x20,0x61,0x6c,0x6c,0x20,0x6f,0x72,
+        0x20,0x70,0x61,0x72,0x74,0x20,0x6f,0x66,
+        0x20,0x61,0x6e,0x20,0x49,0x45,0x54,0x46,
+        0x20,0x49,0x6e,0x74,0x65,0x72,0x6e,0x65,
+        0x74,0x2d,0x44,0x72,0x61,0x66,0x74,0x20,
+        0x6f,0x72,0x20,0x52,0x46,0x43,0x20,0x61,
+        0x6e,0x64,0x20,0x61,0x6e,0x79,0x20,0x73,
+        0x74,0x61,0x74,0x65,0x6d,0x65,0x6e,0x74,
+        0x20,0x6d,0x61,0x64,0x65,0x20,0x77,0x69,
+        0x74,0x68,0x69,0x6e,0x20,0x74,0x68,0x65,
+        0x20,0x63,0x6f,0x6e,0x74,0x65,0x78,0x74,
+        0x20,0x6f,0x66,0x20,0x61,0x6e,0x20,0x49,
+        0x45,0x54,0x46,0x20,0x61,0x63,0x74,0x69,
+        0x76,0x69,0x74,0x79,0x20,0x69,0x73,0x20,
+        0x63,0x6f,0x6e,0x73,0x69,0x64,0x65,0x72,
+        0x65,0x64,0x20,0x61,0x6e,0x20,0x22,0x49,
+        0x45,0x54,0x46,0x20,0x43,0x6f,0x6e,0x74,
+        0x72,0x69,0x62,0x75,0x74,0x69,0x6f,0x6e,
+        0x22,0x2e,0x20,0x53,0x75,0x63,0x68,0x20,
+        0x73,0x74,0x61,0x74,0x65,0x6d,0x65,0x6e,
+        0x74,0x73,0x20,0x69,0x6e,0x63,0x6c,0x75,
+        0x64,0x65,0x20,0x6f,0x72,0x61,0x6c,0x20,
+        0x73,0x74,0x61,0x74,0x65,0x6d,0x65,0x6e,
+        0x74,0x73,0x20,0x69,0x6e,0x20,0x49,0x45,
+        0x54,0x46,0x20,0x73,0x65,0x73,0x73,0x69,
+        0x6f,0x6e,0x73,0x2c,0x20,0x61,0x73,0x20,
+        0x77,0x65,0x6c,0x6c,0x20,0x61,0x73,0x20,
+        0x77,0x72,0x69,0x74,0x74,0x65,0x6e,0x20,
+        0x61,0x6e,0x64,0x20,0x65,0x6c,0x65,0x63,
+        0x74,0x72,0x6f,0x6e,0x69,0x63,0x20,0x63,
+        0x6f,0x6d,0x6d,0x75,0x6e,0x69,0x63,0x61,
+        0x74,0x69,0x6f,0x6e,0x73,0x20,0x6d,0x61,
+        0x64,0x65,0x20,0x61,0x74,0x20,0x61,0x6e,
+        0x79,0x20,0x74,0x69,0x6d,0x65,0x20,0x6f,
+        0x72,0x20,0x70,0x6c,0x61,0x63,0x65,0x2c,
+        0x20,0x77,0x68,0x69,0x63,0x68,0x20,0x61,
+        0x72,0x65,0x20,0x61,0x64,0x64,0x72,0x65,
+        0x73,0x73,0x65,0x64,0x20,0x74,0x6f
+    };
+
     byte additional[] =
     {
         0x50,0x51,0x52,0x53,0xc0,0xc1,0xc2,0xc3,
@@ -7928,6 +7980,12 @@ WOLFSSL_TEST_SUBROUTINE wc_test_ret_t poly1305_test(void)
         0xf7,0xdf,0xda,0x77,0xa2,0xe9,0xaf,0xca
     };
 
+    WOLFSSL_SMALL_STACK_STATIC const byte correct7[] =
+    {
+        0xf3,0x47,0x7e,0x7c,0xd9,0x54,0x17,0xaf,
+        0x89,0xa6,0xb8,0x79,0x4c,0x31,0x0c,0xf0
+    };
+
     WOLFSSL_SMALL_STACK_STATIC const byte key[] = {
         0x85,0xd6,0xbe,0x78,0x57,0x55,0x6d,0x33,
         0x7f,0x44,0x52,0xfe,0x42,0xd5,0x06,0xa8,
@@ -7956,17 +8014,29 @@ WOLFSSL_TEST_SUBROUTINE wc_test_ret_t poly1305_test(void)
         0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
     };
 
-    const byte* msgs[]  = {NULL, msg1, msg2, msg3, msg5, msg6};
+    WOLFSSL_SMALL_STACK_STATIC const byte key7[] = {
+        0x36,0xe5,0xf6,0xb5,0xc5,0xe0,0x60,0x70,
+        0xf0,0xef,0xca,0x96,0x22,0x7a,0x86,0x3e,
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+    };
+
+    const byte* msgs[]  = {NULL, msg1, msg2, msg3, msg5, msg6, msg7};
     word32      szm[]   = {0, sizeof(msg1), sizeof(msg2),
-                           sizeof(msg3), sizeof(msg5), sizeof(msg6)};
-    const byte* keys[]  = {key, key, key2, key2, key5, key};
+                           sizeof(msg3), sizeof(msg5), sizeof(msg6),
+                           sizeof(msg7)};
+    const byte* keys[]  = {key, key, key2, key2, key5, key, key7};
     const byte* tests[] = {correct0, correct1, correct2, correct3, correct5,
-                           correct6};
+                           correct6, correct7};
+    byte  big[1024 + 1];
+    byte  tag2[16];
+    word32 sz;
+    word32 j;
     int i;
     wc_test_ret_t ret = 0;
     WOLFSSL_ENTER("poly1305_test");
 
-    for (i = 0; i < 6; i++) {
+    for (i = 0; i < 7; i++) {
         ret = wc_Poly1305SetKey(&enc, keys[i], 32);
         if (ret != 0)
             return WC_TEST_RET_ENC_I(i);
@@ -8008,6 +8078,30 @@ WOLFSSL_TEST_SUBROUTINE wc_test_ret_t poly1305_test(void)
     if (XMEMCMP(tag, correct4, sizeof(tag)) == 0)
         return WC_TEST_RET_ENC_NC;
 
+    /* One update over the whole message (multi-block path where available)
+     * must match block-at-a-time updates, from aligned and unaligned
+     * buffers. All-ones key and data keep the limbs at their largest. */
+    XMEMSET(big, 0xff, sizeof(big));
+    for (sz = 16; sz <= (word32)sizeof(big) - 1; sz += 48) {
+        ret = wc_Poly1305SetKey(&enc, big, 32);
+        if (ret == 0)
+            ret = wc_Poly1305Update(&enc, big + ((sz / 16) & 1), sz);
+        if (ret == 0)
+            ret = wc_Poly1305Final(&enc, tag);
+        if (ret != 0)
+            return WC_TEST_RET_ENC_EC(ret);
+
+        ret = wc_Poly1305SetKey(&enc, big, 32);
+        for (j = 0; ret == 0 && j < sz; j += 16)
+            ret = wc_Poly1305Update(&enc, big + j, 16);
+        if (ret == 0)
+            ret = wc_Poly1305Final(&enc, tag2);
+        if (ret != 0)
+            return WC_TEST_RET_ENC_EC(ret);
+
+        if (XMEMCMP(tag, tag2, sizeof(tag)) != 0)
+            return WC_TEST_RET_ENC_I(sz);
+    }
 
     return 0;
 }
@@ -23372,6 +23466,253 @@ static wc_test_ret_t srp_test_digest(SrpType dgstType)
     return r;
 }
 
+#ifdef WOLFSSL_SHA512
+/* SRP-6a with SHA-512 on the RFC 5054 3072-bit group, as used by the HomeKit
+ * Accessory Protocol pair-setup. The verifier is the known answer from the
+ * HAP specification test vector, followed by a full exchange on the group. */
+static wc_test_ret_t srp_test_homekit(void)
+{
+    wc_test_ret_t r;
+
+    byte clientPubKey[384]; /* A */
+    byte serverPubKey[384]; /* B */
+    word32 clientPubKeySz = 384;
+    word32 serverPubKeySz = 384;
+
+    byte username[] = "alice";
+    word32 usernameSz = 5;
+
+    byte password[] = "password123";
+    word32 passwordSz = 11;
+
+    WOLFSSL_SMALL_STACK_STATIC const byte N[] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xc9, 0x0f, 0xda, 0xa2, 0x21, 0x68, 0xc2, 0x34,
+        0xc4, 0xc6, 0x62, 0x8b, 0x80, 0xdc, 0x1c, 0xd1,
+        0x29, 0x02, 0x4e, 0x08, 0x8a, 0x67, 0xcc, 0x74,
+        0x02, 0x0b, 0xbe, 0xa6, 0x3b, 0x13, 0x9b, 0x22,
+        0x51, 0x4a, 0x08, 0x79, 0x8e, 0x34, 0x04, 0xdd,
+        0xef, 0x95, 0x19, 0xb3, 0xcd, 0x3a, 0x43, 0x1b,
+        0x30, 0x2b, 0x0a, 0x6d, 0xf2, 0x5f, 0x14, 0x37,
+        0x4f, 0xe1, 0x35, 0x6d, 0x6d, 0x51, 0xc2, 0x45,
+        0xe4, 0x85, 0xb5, 0x76, 0x62, 0x5e, 0x7e, 0xc6,
+        0xf4, 0x4c, 0x42, 0xe9, 0xa6, 0x37, 0xed, 0x6b,
+        0x0b, 0xff, 0x5c, 0xb6, 0xf4, 0x06, 0xb7, 0xed,
+        0xee, 0x38, 0x6b, 0xfb, 0x5a, 0x89, 0x9f, 0xa5,
+        0xae, 0x9f, 0x24, 0x11, 0x7c, 0x4b, 0x1f, 0xe6,
+        0x49, 0x28, 0x66, 0x51, 0xec, 0xe4, 0x5b, 0x3d,
+        0xc2, 0x00, 0x7c, 0xb8, 0xa1, 0x63, 0xbf, 0x05,
+        0x98, 0xda, 0x48, 0x36, 0x1c, 0x55, 0xd3, 0x9a,
+        0x69, 0x16, 0x3f, 0xa8, 0xfd, 0x24, 0xcf, 0x5f,
+        0x83, 0x65, 0x5d, 0x23, 0xdc, 0xa3, 0xad, 0x96,
+        0x1c, 0x62, 0xf3, 0x56, 0x20, 0x85, 0x52, 0xbb,
+        0x9e, 0xd5, 0x29, 0x07, 0x70, 0x96, 0x96, 0x6d,
+        0x67, 0x0c, 0x35, 0x4e, 0x4a, 0xbc, 0x98, 0x04,
+        0xf1, 0x74, 0x6c, 0x08, 0xca, 0x18, 0x21, 0x7c,
+        0x32, 0x90, 0x5e, 0x46, 0x2e, 0x36, 0xce, 0x3b,
+        0xe3, 0x9e, 0x77, 0x2c, 0x18, 0x0e, 0x86, 0x03,
+        0x9b, 0x27, 0x83, 0xa2, 0xec, 0x07, 0xa2, 0x8f,
+        0xb5, 0xc5, 0x5d, 0xf0, 0x6f, 0x4c, 0x52, 0xc9,
+        0xde, 0x2b, 0xcb, 0xf6, 0x95, 0x58, 0x17, 0x18,
+        0x39, 0x95, 0x49, 0x7c, 0xea, 0x95, 0x6a, 0xe5,
+        0x15, 0xd2, 0x26, 0x18, 0x98, 0xfa, 0x05, 0x10,
+        0x15, 0x72, 0x8e, 0x5a, 0x8a, 0xaa, 0xc4, 0x2d,
+        0xad, 0x33, 0x17, 0x0d, 0x04, 0x50, 0x7a, 0x33,
+        0xa8, 0x55, 0x21, 0xab, 0xdf, 0x1c, 0xba, 0x64,
+        0xec, 0xfb, 0x85, 0x04, 0x58, 0xdb, 0xef, 0x0a,
+        0x8a, 0xea, 0x71, 0x57, 0x5d, 0x06, 0x0c, 0x7d,
+        0xb3, 0x97, 0x0f, 0x85, 0xa6, 0xe1, 0xe4, 0xc7,
+        0xab, 0xf5, 0xae, 0x8c, 0xdb, 0x09, 0x33, 0xd7,
+        0x1e, 0x8c, 0x94, 0xe0, 0x4a, 0x25, 0x61, 0x9d,
+        0xce, 0xe3, 0xd2, 0x26, 0x1a, 0xd2, 0xee, 0x6b,
+        0xf1, 0x2f, 0xfa, 0x06, 0xd9, 0x8a, 0x08, 0x64,
+        0xd8, 0x76, 0x02, 0x73, 0x3e, 0xc8, 0x6a, 0x64,
+        0x52, 0x1f, 0x2b, 0x18, 0x17, 0x7b, 0x20, 0x0c,
+        0xbb, 0xe1, 0x17, 0x57, 0x7a, 0x61, 0x5d, 0x6c,
+        0x77, 0x09, 0x88, 0xc0, 0xba, 0xd9, 0x46, 0xe2,
+        0x08, 0xe2, 0x4f, 0xa0, 0x74, 0xe5, 0xab, 0x31,
+        0x43, 0xdb, 0x5b, 0xfc, 0xe0, 0xfd, 0x10, 0x8e,
+        0x4b, 0x82, 0xd1, 0x20, 0xa9, 0x3a, 0xd2, 0xca,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+    };
+
+    WOLFSSL_SMALL_STACK_STATIC const byte g[] = {
+        0x05
+    };
+
+    WOLFSSL_SMALL_STACK_STATIC const byte salt[] = {
+        0xbe, 0xb2, 0x53, 0x79, 0xd1, 0xa8, 0x58, 0x1e,
+        0xb5, 0xa7, 0x27, 0x67, 0x3a, 0x24, 0x41, 0xee
+    };
+
+    WOLFSSL_SMALL_STACK_STATIC const byte expectedVerifier[] = {
+        0x9b, 0x5e, 0x06, 0x17, 0x01, 0xea, 0x7a, 0xeb,
+        0x39, 0xcf, 0x6e, 0x35, 0x19, 0x65, 0x5a, 0x85,
+        0x3c, 0xf9, 0x4c, 0x75, 0xca, 0xf2, 0x55, 0x5e,
+        0xf1, 0xfa, 0xf7, 0x59, 0xbb, 0x79, 0xcb, 0x47,
+        0x70, 0x14, 0xe0, 0x4a, 0x88, 0xd6, 0x8f, 0xfc,
+        0x05, 0x32, 0x38, 0x91, 0xd4, 0xc2, 0x05, 0xb8,
+        0xde, 0x81, 0xc2, 0xf2, 0x03, 0xd8, 0xfa, 0xd1,
+        0xb2, 0x4d, 0x2c, 0x10, 0x97, 0x37, 0xf1, 0xbe,
+        0xbb, 0xd7, 0x1f, 0x91, 0x24, 0x47, 0xc4, 0xa0,
+        0x3c, 0x26, 0xb9, 0xfa, 0xd8, 0xed, 0xb3, 0xe7,
+        0x80, 0x77, 0x8e, 0x30, 0x25, 0x29, 0xed, 0x1e,
+        0xe1, 0x38, 0xcc, 0xfc, 0x36, 0xd4, 0xba, 0x31,
+        0x3c, 0xc4, 0x8b, 0x14, 0xea, 0x8c, 0x22, 0xa0,
+        0x18, 0x6b, 0x22, 0x2e, 0x65, 0x5f, 0x2d, 0xf5,
+        0x60, 0x3f, 0xd7, 0x5d, 0xf7, 0x6b, 0x3b, 0x08,
+        0xff, 0x89, 0x50, 0x06, 0x9a, 0xdd, 0x03, 0xa7,
+        0x54, 0xee, 0x4a, 0xe8, 0x85, 0x87, 0xcc, 0xe1,
+        0xbf, 0xde, 0x36, 0x79, 0x4d, 0xba, 0xe4, 0x59,
+        0x2b, 0x7b, 0x90, 0x4f, 0x44, 0x2b, 0x04, 0x1c,
+        0xb1, 0x7a, 0xeb, 0xad, 0x1e, 0x3a, 0xeb, 0xe3,
+        0xcb, 0xe9, 0x9d, 0xe6, 0x5f, 0x4b, 0xb1, 0xfa,
+        0x00, 0xb0, 0xe7, 0xaf, 0x06, 0x86, 0x3d, 0xb5,
+        0x3b, 0x02, 0x25, 0x4e, 0xc6, 0x6e, 0x78, 0x1e,
+        0x3b, 0x62, 0xa8, 0x21, 0x2c, 0x86, 0xbe, 0xb0,
+        0xd5, 0x0b, 0x5b, 0xa6, 0xd0, 0xb4, 0x78, 0xd8,
+        0xc4, 0xe9, 0xbb, 0xce, 0xc2, 0x17, 0x65, 0x32,
+        0x6f, 0xbd, 0x14, 0x05, 0x8d, 0x2b, 0xbd, 0xe2,
+        0xc3, 0x30, 0x45, 0xf0, 0x38, 0x73, 0xe5, 0x39,
+        0x48, 0xd7, 0x8b, 0x79, 0x4f, 0x07, 0x90, 0xe4,
+        0x8c, 0x36, 0xae, 0xd6, 0xe8, 0x80, 0xf5, 0x57,
+        0x42, 0x7b, 0x2f, 0xc0, 0x6d, 0xb5, 0xe1, 0xe2,
+        0xe1, 0xd7, 0xe6, 0x61, 0xac, 0x48, 0x2d, 0x18,
+        0xe5, 0x28, 0xd7, 0x29, 0x5e, 0xf7, 0x43, 0x72,
+        0x95, 0xff, 0x1a, 0x72, 0xd4, 0x02, 0x77, 0x17,
+        0x13, 0xf1, 0x68, 0x76, 0xdd, 0x05, 0x0a, 0xe5,
+        0xb7, 0xad, 0x53, 0xcc, 0xb9, 0x08, 0x55, 0xc9,
+        0x39, 0x56, 0x64, 0x83, 0x58, 0xad, 0xfd, 0x96,
+        0x64, 0x22, 0xf5, 0x24, 0x98, 0x73, 0x2d, 0x68,
+        0xd1, 0xd7, 0xfb, 0xef, 0x10, 0xd7, 0x80, 0x34,
+        0xab, 0x8d, 0xcb, 0x6f, 0x0f, 0xcf, 0x88, 0x5c,
+        0xc2, 0xb2, 0xea, 0x2c, 0x3e, 0x6a, 0xc8, 0x66,
+        0x09, 0xea, 0x05, 0x8a, 0x9d, 0xa8, 0xcc, 0x63,
+        0x53, 0x1d, 0xc9, 0x15, 0x41, 0x4d, 0xf5, 0x68,
+        0xb0, 0x94, 0x82, 0xdd, 0xac, 0x19, 0x54, 0xde,
+        0xc7, 0xeb, 0x71, 0x4f, 0x6f, 0xf7, 0xd4, 0x4c,
+        0xd5, 0xb8, 0x6f, 0x6b, 0xd1, 0x15, 0x81, 0x09,
+        0x30, 0x63, 0x7c, 0x01, 0xd0, 0xf6, 0x01, 0x3b,
+        0xc9, 0x74, 0x0f, 0xa2, 0xc6, 0x33, 0xba, 0x89
+    };
+
+    word32 v_size = 384;
+    word32 clientProofSz = SRP_MAX_DIGEST_SIZE;
+    word32 serverProofSz = SRP_MAX_DIGEST_SIZE;
+#if defined(WOLFSSL_SMALL_STACK) && !defined(WOLFSSL_NO_MALLOC)
+    Srp *cli = (Srp *)XMALLOC(sizeof *cli, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    Srp *srv = (Srp *)XMALLOC(sizeof *srv, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    byte *verifier = (byte *)XMALLOC(384, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    byte *clientProof = (byte *)XMALLOC(SRP_MAX_DIGEST_SIZE, HEAP_HINT,
+                                        DYNAMIC_TYPE_TMP_BUFFER); /* M1 */
+    byte *serverProof = (byte *)XMALLOC(SRP_MAX_DIGEST_SIZE, HEAP_HINT,
+                                        DYNAMIC_TYPE_TMP_BUFFER); /* M2 */
+#ifdef WC_SRP_NONBLOCK
+    SrpNb *nb = (SrpNb *)XMALLOC(sizeof *nb, HEAP_HINT,
+                                 DYNAMIC_TYPE_TMP_BUFFER);
+#endif
+
+    if ((cli == NULL) ||
+        (srv == NULL) ||
+        (verifier == NULL) ||
+        (clientProof == NULL) ||
+#ifdef WC_SRP_NONBLOCK
+        (nb == NULL) ||
+#endif
+        (serverProof == NULL)) {
+        r = WC_TEST_RET_ENC_NC;
+        goto out;
+    }
+#else
+    Srp cli[1], srv[1];
+    byte verifier[384];
+    byte clientProof[SRP_MAX_DIGEST_SIZE]; /* M1 */
+    byte serverProof[SRP_MAX_DIGEST_SIZE]; /* M2 */
+#ifdef WC_SRP_NONBLOCK
+    SrpNb nb[1];
+#endif
+#endif
+
+    XMEMSET(srv, 0, sizeof *srv);
+    XMEMSET(cli, 0, sizeof *cli);
+
+    r = wc_SrpInit_ex(cli, SRP_TYPE_SHA512, SRP_CLIENT_SIDE, HEAP_HINT, devId);
+    if (!r) r = wc_SrpSetUsername(cli, username, usernameSz);
+    if (!r) r = wc_SrpSetParams(cli, N,    sizeof(N),
+                                      g,    sizeof(g),
+                                      salt, sizeof(salt));
+    if (!r) r = wc_SrpSetPassword(cli, password, passwordSz);
+    if (!r) r = wc_SrpGetVerifier(cli, verifier, &v_size);
+    if (!r && (v_size != sizeof(expectedVerifier) ||
+               XMEMCMP(verifier, expectedVerifier, v_size) != 0)) {
+        r = WC_TEST_RET_ENC_NC;
+    }
+
+    if (!r) r = wc_SrpInit_ex(srv, SRP_TYPE_SHA512, SRP_SERVER_SIDE, HEAP_HINT,
+                              devId);
+    if (!r) r = wc_SrpSetUsername(srv, username, usernameSz);
+    if (!r) r = wc_SrpSetParams(srv, N,    sizeof(N),
+                                      g,    sizeof(g),
+                                      salt, sizeof(salt));
+    if (!r) r = wc_SrpSetVerifier(srv, verifier, v_size);
+#ifdef WC_SRP_NONBLOCK
+    /* the server runs time-sliced, the client blocking */
+    if (!r) r = wc_SrpSetNonBlock(srv, nb);
+    if (!r) {
+        do {
+            r = wc_SrpGetPublic_nb(srv, serverPubKey, &serverPubKeySz);
+        } while (r == FP_WOULDBLOCK);
+    }
+#else
+    if (!r) r = wc_SrpGetPublic(srv, serverPubKey, &serverPubKeySz);
+#endif
+
+    if (!r) r = wc_SrpGetPublic(cli, clientPubKey, &clientPubKeySz);
+    if (!r) r = wc_SrpComputeKey(cli, clientPubKey, clientPubKeySz,
+                                       serverPubKey, serverPubKeySz);
+    if (!r) r = wc_SrpGetProof(cli, clientProof, &clientProofSz);
+
+#ifdef WC_SRP_NONBLOCK
+    if (!r) {
+        do {
+            r = wc_SrpComputeKey_nb(srv, clientPubKey, clientPubKeySz,
+                                          serverPubKey, serverPubKeySz);
+        } while (r == FP_WOULDBLOCK);
+    }
+#else
+    if (!r) r = wc_SrpComputeKey(srv, clientPubKey, clientPubKeySz,
+                                       serverPubKey, serverPubKeySz);
+#endif
+    if (!r) r = wc_SrpVerifyPeersProof(srv, clientProof, clientProofSz);
+    if (!r) r = wc_SrpGetProof(srv, serverProof, &serverProofSz);
+    if (!r) r = wc_SrpVerifyPeersProof(cli, serverProof, serverProofSz);
+
+    wc_SrpTerm(cli);
+    wc_SrpTerm(srv);
+
+#if defined(WOLFSSL_SMALL_STACK) && !defined(WOLFSSL_NO_MALLOC)
+  out:
+
+    if (cli)
+        XFREE(cli, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    if (srv)
+        XFREE(srv, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    if (verifier)
+        XFREE(verifier, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    if (clientProof)
+        XFREE(clientProof, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+    if (serverProof)
+        XFREE(serverProof, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+#ifdef WC_SRP_NONBLOCK
+    if (nb)
+        XFREE(nb, HEAP_HINT, DYNAMIC_TYPE_TMP_BUFFER);
+#endif
+#endif
+
+    return r;
+}
+#endif /* WOLFSSL_SHA512 */
+
 WOLFSSL_TEST_SUBROUTINE wc_test_ret_t srp_test(void)
 {
     wc_test_ret_t ret;
@@ -23396,6 +23737,9 @@ WOLFSSL_TEST_SUBROUTINE wc_test_ret_t srp_test(void)
     ret = srp_test_digest(SRP_TYPE_SHA512);
     if (ret != 0)
         return ret;
+    ret = srp_test_homekit();
+    if (ret != 0)
+        return ret;
 #endif
 
     return ret;
@@ -26768,10 +27112,83 @@ WOLFSSL_TEST_SUBROUTINE wc_test_ret_t hkdf_test(void)
 
     if (XMEMCMP(okm1, res4, L) != 0)
         return WC_TEST_RET_ENC_NC;
+
+    /* Same vector through a cached PRK */
+    {
+        HkdfPrk prk;
+
+        XMEMSET(okm1, 0, sizeof(okm1));
+        ret = wc_HKDF_Extract_Prk(&prk, WC_SHA256, salt1,
+            (word32)sizeof(salt1), ikm1, (word32)sizeof(ikm1), HEAP_HINT);
+        if (ret != 0)
+            return WC_TEST_RET_ENC_EC(ret);
+        ret = wc_HKDF_Expand_Prk(&prk, info1, (word32)sizeof(info1), okm1,
+            (word32)L);
+        wc_HKDF_FreePrk(&prk);
+        if (ret != 0)
+            return WC_TEST_RET_ENC_EC(ret);
+
+        if (XMEMCMP(okm1, res4, L) != 0)
+            return WC_TEST_RET_ENC_NC;
+    }
 #endif /* HAVE_FIPS */
 #endif /* !NO_SHA256 */
 #endif /* !NO_SHA || !NO_SHA256 */
 
+#if defined(WOLFSSL_SHA512) && !defined(HAVE_FIPS)
+    /* Several keys from one cached SHA-512 PRK, as in the HomeKit session
+     * setup, must match independent wc_HKDF_Expand() calls. */
+    {
+        static const char* infos[] = {
+            "Control-Write-Encryption-Key",
+            "Control-Read-Encryption-Key",
+            "Pair-Verify-Encrypt-Info"
+        };
+        static const byte salt[] = "Control-Salt";
+        byte    secret[32];
+        byte    prkKey[WC_SHA512_DIGEST_SIZE];
+        byte    key1[WC_SHA512_DIGEST_SIZE + 36];
+        byte    key2[WC_SHA512_DIGEST_SIZE + 36];
+        HkdfPrk prk;
+        int     i;
+
+        for (i = 0; i < (int)sizeof(secret); i++)
+            secret[i] = (byte)(i * 7 + 1);
+
+        ret = wc_HKDF_Extract(WC_SHA512, salt, (word32)sizeof(salt) - 1,
+            secret, (word32)sizeof(secret), prkKey);
+        if (ret != 0)
+            return WC_TEST_RET_ENC_EC(ret);
+        ret = wc_HKDF_Extract_Prk(&prk, WC_SHA512, salt,
+            (word32)sizeof(salt) - 1, secret, (word32)sizeof(secret),
+            HEAP_HINT);
+        if (ret != 0)
+            return WC_TEST_RET_ENC_EC(ret);
+
+        for (i = 0; i < (int)(sizeof(infos) / sizeof(infos[0])); i++) {
+            /* 32 bytes for the session keys, and a length spanning two
+             * blocks */
+            word32 sz = (i == 2) ? (word32)sizeof(key1) : 32;
+
+            ret = wc_HKDF_Expand(WC_SHA512, prkKey, (word32)sizeof(prkKey),
+                (const byte*)infos[i], (word32)XSTRLEN(infos[i]), key1, sz);
+            if (ret == 0) {
+                ret = wc_HKDF_Expand_Prk(&prk, (const byte*)infos[i],
+                    (word32)XSTRLEN(infos[i]), key2, sz);
+            }
+            if (ret != 0) {
+                wc_HKDF_FreePrk(&prk);
+                return WC_TEST_RET_ENC_EC(ret);
+            }
+            if (XMEMCMP(key1, key2, sz) != 0) {
+                wc_HKDF_FreePrk(&prk);
+                return WC_TEST_RET_ENC_NC;
+            }
+        }
+        wc_HKDF_FreePrk(&prk);
+    }
+#endif /* WOLFSSL_SHA512 && !HAVE_FIPS */
+
     return ret;
 }
 
@@ -239,6 +239,24 @@ WOLFSSL_API int wc_HKDF(int type, const byte* inKey, word32 inKeySz,
                     const byte* info, word32 infoSz,
                     byte* out, word32 outSz);
 
+/* HKDF pseudorandom key with the HMAC inner and outer pad blocks already
+ * hashed, so that each expand only runs the compression function over its
+ * own data. Meant for deriving several keys from one shared secret. */
+typedef struct HkdfPrk {
+    Hmac        hmac;   /* keyed with the PRK, hash is the working state */
+    wc_HmacHash inner;  /* hash state after the ipad block */
+    wc_HmacHash outer;  /* hash state after the opad block */
+} HkdfPrk;
+
+WOLFSSL_API int wc_HKDF_SetPrk(HkdfPrk* prk, int type, const byte* inKey,
+                               word32 inKeySz, void* heap);
+WOLFSSL_API int wc_HKDF_Extract_Prk(HkdfPrk* prk, int type, const byte* salt,
+                                    word32 saltSz, const byte* inKey,
+                                    word32 inKeySz, void* heap);
+WOLFSSL_API int wc_HKDF_Expand_Prk(HkdfPrk* prk, const byte* info,
+                                   word32 infoSz, byte* out, word32 outSz);
+WOLFSSL_API void wc_HKDF_FreePrk(HkdfPrk* prk);
+
 #endif /* HAVE_HKDF */
 
 #ifdef __cplusplus
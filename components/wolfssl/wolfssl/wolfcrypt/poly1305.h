@@ -105,6 +105,12 @@ typedef struct Poly1305 {
     word32 r[5];
     word32 h[5];
     word32 pad[4];
+#ifdef WOLFSSL_POLY1305_4WAY
+    word32 r_2[5]; /* r^2 */
+    word32 r_3[5]; /* r^3 */
+    word32 r_4[5]; /* r^4 */
+    unsigned char started; /* powers of r calculated */
+#endif
 #endif
     size_t leftover;
 #endif /* WOLFSSL_ARMASM */
@@ -100,6 +100,27 @@ typedef struct {
     } data;
 } SrpHash;
 
+#ifdef WC_SRP_NONBLOCK
+    #if !defined(USE_FAST_MATH) || !defined(TFM_TIMING_RESISTANT) || \
+        !defined(WC_RSA_NONBLOCK)
+        #error SRP non-blocking mode needs fast math with \
+               TFM_TIMING_RESISTANT and WC_RSA_NONBLOCK
+    #endif
+
+/**
+ * Working state of wc_SrpGetPublic_nb and wc_SrpComputeKey_nb, owned by the
+ * caller and attached with wc_SrpSetNonBlock.
+ */
+typedef struct SrpNb {
+    exptModNb_t exptmod;            /**< Non-blocking fp_exptmod state.     */
+    mp_int  u;                      /**< Scrambling parameter.              */
+    mp_int  s;                      /**< Premaster secret.                  */
+    mp_int  t1;                     /**< Intermediate values.               */
+    mp_int  t2;
+    int     state;                  /**< Step of the current call.          */
+} SrpNb;
+#endif
+
 typedef struct Srp {
     SrpSide side;                   /**< Client or Server, @see SrpSide.      */
     SrpType type;                   /**< Hash type, @see SrpType.             */
@@ -124,6 +145,9 @@ typedef struct Srp {
         /**< The default function used by this implementation is a modified   */
         /**< version of t_mgf1 that uses the proper hash function according   */
         /**< to srp->type.                                                    */
+#ifdef WC_SRP_NONBLOCK
+    SrpNb*  nb;                     /**< Non-blocking state or NULL.          */
+#endif
     void*   heap;                   /**< heap hint pointer                    */
 } Srp;
 
@@ -305,6 +329,40 @@ WOLFSSL_API int wc_SrpGetProof(Srp* srp, byte* proof, word32* size);
  */
 WOLFSSL_API int wc_SrpVerifyPeersProof(Srp* srp, byte* proof, word32 size);
 
+#ifdef WC_SRP_NONBLOCK
+/**
+ * Enables the non-blocking calls on an Srp struct.
+ *
+ * @param[in,out] srp   the Srp structure.
+ * @param[in]     nb    the working state, cleared here. NULL disables the
+ *                      non-blocking mode again.
+ *
+ * @return 0 on success, {@literal <} 0 on error. @see error-crypt.h
+ */
+WOLFSSL_API int wc_SrpSetNonBlock(Srp* srp, SrpNb* nb);
+
+/**
+ * Non-blocking wc_SrpGetPublic. Every call does a bounded amount of work, at
+ * most one 3072-bit multiplication with its reduction, and returns
+ * FP_WOULDBLOCK until the public value is written. The arguments must not
+ * change between the calls of one operation.
+ *
+ * @return 0 on success, FP_WOULDBLOCK to call again, {@literal <} 0 on
+ *         error. @see error-crypt.h
+ */
+WOLFSSL_API int wc_SrpGetPublic_nb(Srp* srp, byte* pub, word32* size);
+
+/**
+ * Non-blocking wc_SrpComputeKey, called like wc_SrpGetPublic_nb.
+ *
+ * @return 0 on success, FP_WOULDBLOCK to call again, {@literal <} 0 on
+ *         error. @see error-crypt.h
+ */
+WOLFSSL_API int wc_SrpComputeKey_nb(Srp* srp,
+                                    byte* clientPubKey, word32 clientPubKeySz,
+                                    byte* serverPubKey, word32 serverPubKeySz);
+#endif /* WC_SRP_NONBLOCK */
+
 #ifdef __cplusplus
    } /* extern "C" */
 #endif
@@ -0,0 +1,202 @@
+#include "calibration.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <math.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "fusion.h"
+#include "hw/lcd.h"
+#include "hw/relay.h"
+
+static const char *TAG = "CALIBRATION";
+
+// The keys end with the index of the sensor, e.g. "knots0"
+#define CALIBRATION_NVS_NAMESPACE "calib"
+#define CALIBRATION_NVS_KEY_KNOTS "knots"      // Raw temperatures of the table (int16 array, 0.01 °C)
+#define CALIBRATION_NVS_KEY_OFFSETS "offsets"  // Offsets at these temperatures (int16 array, 0.01 °C)
+#define CALIBRATION_NVS_KEY_CPU "cpu"          // Heat of each source when fully on for long (int32, 0.001 °C)
+#define CALIBRATION_NVS_KEY_LIGHT "light"
+#define CALIBRATION_NVS_KEY_RELAY "relay"
+#define CALIBRATION_NVS_KEY_TAU "tau"          // Lag of the heat sources (uint32, seconds)
+#define CALIBRATION_DEFAULT_TAU_S 600
+
+typedef enum {
+  HEAT_CPU,
+  HEAT_LIGHT,
+  HEAT_RELAY,
+  HEAT_SOURCES
+} HeatSource;
+
+typedef struct {
+  int points;
+  float knots[CALIBRATION_MAX_POINTS];
+  float offsets[CALIBRATION_MAX_POINTS];
+  float coefficients[HEAT_SOURCES];
+  float tau_s;
+  float heat[HEAT_SOURCES];           // Lagged level of each source
+} Calibration;
+
+static Calibration calibrations[FUSION_MAX_SENSORS];
+static int sensor_count = 0;
+static float levels[HEAT_SOURCES];    // Level of each source since the last update (0..1)
+static int64_t last_update = 0;
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+static configRUN_TIME_COUNTER_TYPE last_idle = 0;
+#endif
+
+static void calibration_key(char *key, size_t size, const char *name, int index) {
+  snprintf(key, size, "%s%d", name, index);
+}
+
+static bool calibration_load_table(nvs_handle_t nvs, int index, Calibration *c) {
+  char key[NVS_KEY_NAME_MAX_SIZE];
+  int16_t knots[CALIBRATION_MAX_POINTS];
+  int16_t offsets[CALIBRATION_MAX_POINTS];
+  size_t knots_len = sizeof(knots);
+  size_t offsets_len = sizeof(offsets);
+
+  calibration_key(key, sizeof(key), CALIBRATION_NVS_KEY_KNOTS, index);
+  if (nvs_get_blob(nvs, key, knots, &knots_len) != ESP_OK) {
+    return false;
+  }
+  calibration_key(key, sizeof(key), CALIBRATION_NVS_KEY_OFFSETS, index);
+  if (nvs_get_blob(nvs, key, offsets, &offsets_len) != ESP_OK) {
+    return false;
+  }
+  if (knots_len != offsets_len || knots_len < sizeof(int16_t)) {
+    ESP_LOGE(TAG, "Invalid table of sensor %d", index);
+    return false;
+  }
+
+  c->points = knots_len / sizeof(int16_t);
+  for (int i = 0; i < c->points; i++) {
+    c->knots[i] = knots[i] / 100.0f;
+    c->offsets[i] = offsets[i] / 100.0f;
+  }
+
+  static const char *const coefficient_keys[HEAT_SOURCES] = {
+    CALIBRATION_NVS_KEY_CPU,
+    CALIBRATION_NVS_KEY_LIGHT,
+    CALIBRATION_NVS_KEY_RELAY,
+  };
+  for (int i = 0; i < HEAT_SOURCES; i++) {
+    int32_t value = 0;
+    calibration_key(key, sizeof(key), coefficient_keys[i], index);
+    nvs_get_i32(nvs, key, &value);
+    c->coefficients[i] = value / 1000.0f;
+  }
+
+  uint32_t tau = CALIBRATION_DEFAULT_TAU_S;
+  calibration_key(key, sizeof(key), CALIBRATION_NVS_KEY_TAU, index);
+  nvs_get_u32(nvs, key, &tau);
+  c->tau_s = tau > 0 ? tau : CALIBRATION_DEFAULT_TAU_S;
+  return true;
+}
+
+void calibration_init(int sensors) {
+  sensor_count = sensors < FUSION_MAX_SENSORS ? sensors : FUSION_MAX_SENSORS;
+
+  // Until a sensor is calibrated, it gets the fixed offset the thermostat always used
+  for (int i = 0; i < sensor_count; i++) {
+    calibrations[i] = (Calibration){
+      .points = 1,
+      .offsets = {CALIBRATION_DEFAULT_OFFSET},
+      .tau_s = CALIBRATION_DEFAULT_TAU_S,
+    };
+  }
+
+  nvs_handle_t nvs;
+  esp_err_t err = nvs_flash_init_partition(CALIBRATION_PARTITION);
+  if (err == ESP_OK) {
+    err = nvs_open_from_partition(CALIBRATION_PARTITION, CALIBRATION_NVS_NAMESPACE, NVS_READONLY, &nvs);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "No calibration (%s), correcting by %.1f C", esp_err_to_name(err), CALIBRATION_DEFAULT_OFFSET);
+    return;
+  }
+
+  for (int i = 0; i < sensor_count; i++) {
+    Calibration *c = &calibrations[i];
+    if (!calibration_load_table(nvs, i, c)) {
+      ESP_LOGW(TAG, "Sensor %d is not calibrated, correcting by %.1f C", i, CALIBRATION_DEFAULT_OFFSET);
+      continue;
+    }
+    ESP_LOGI(TAG, "Sensor %d: %d points from %.1f to %.1f C, heat %.2f C CPU, %.2f C backlight, %.2f C relay, "
+             "tau %.0f s", i, c->points, c->knots[0], c->knots[c->points - 1], c->coefficients[HEAT_CPU],
+             c->coefficients[HEAT_LIGHT], c->coefficients[HEAT_RELAY], c->tau_s);
+  }
+  nvs_close(nvs);
+}
+
+void calibration_update(void) {
+  int64_t now = esp_timer_get_time();
+  float dt_s = last_update == 0 ? 0 : (now - last_update) / 1e6f;
+
+  // The run time counter ticks with esp_timer, so the idle time is in microseconds too
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  configRUN_TIME_COUNTER_TYPE idle = ulTaskGetIdleRunTimeCounter();
+  if (last_update != 0 && now > last_update) {
+    float duty = 1 - (float)(idle - last_idle) / (now - last_update);
+    levels[HEAT_CPU] = fminf(fmaxf(duty, 0), 1);
+  }
+  last_idle = idle;
+#endif
+  levels[HEAT_LIGHT] = lcd_backlight_level();
+  levels[HEAT_RELAY] = relay_turned_on ? 1 : 0;
+  last_update = now;
+
+  // The enclosure starts cold after power-up
+  for (int i = 0; i < sensor_count; i++) {
+    Calibration *c = &calibrations[i];
+    float alpha = 1 - expf(-dt_s / c->tau_s);
+    for (int j = 0; j < HEAT_SOURCES; j++) {
+      c->heat[j] += alpha * (levels[j] - c->heat[j]);
+    }
+  }
+}
+
+// Water vapour saturation pressure over water (Magnus formula, in hPa)
+static float saturation_pressure(float temp) {
+  return 6.112f * expf(17.62f * temp / (243.12f + temp));
+}
+
+static float calibration_offset(const Calibration *c, float temp) {
+  if (temp <= c->knots[0]) {
+    return c->offsets[0];
+  }
+  for (int i = 1; i < c->points; i++) {
+    if (temp <= c->knots[i]) {
+      float f = (temp - c->knots[i - 1]) / (c->knots[i] - c->knots[i - 1]);
+      return c->offsets[i - 1] + f * (c->offsets[i] - c->offsets[i - 1]);
+    }
+  }
+  return c->offsets[c->points - 1];
+}
+
+void calibration_apply(int index, TempHumidity *temp_humid) {
+  const Calibration *c = &calibrations[index];
+  float raw = temp_humid->temperature;
+
+#if CONFIG_CALIBRATION_LOG
+  // Input of tools/calibration/fit_calibration.py
+  ESP_LOGI("CALIB", "%lld,%d,%.2f,%.2f,%.3f,%.0f,%.0f", (long long)time(NULL), index, raw, temp_humid->humidity,
+           levels[HEAT_CPU], levels[HEAT_LIGHT], levels[HEAT_RELAY]);
+#endif
+
+  float heat = 0;
+  for (int j = 0; j < HEAT_SOURCES; j++) {
+    heat += c->coefficients[j] * c->heat[j];
+  }
+  temp_humid->temperature = raw + calibration_offset(c, raw) - heat;
+
+  // The sensor measures the relative humidity of the air at its own temperature. The same amount of water
+  // vapour gives a different relative humidity at the corrected temperature.
+  float humidity = temp_humid->humidity * saturation_pressure(raw) / saturation_pressure(temp_humid->temperature);
+  temp_humid->humidity = fminf(fmaxf(humidity, 0), 100);
+}
@@ -0,0 +1,26 @@
+#include "hw/sht40.h"
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+// Corrects the sensor readings with a per-sensor calibration from the `calib` partition, which
+// tools/calibration/fit_calibration.py fits to a reference thermometer:
+//   T = T_raw + offset(T_raw) - (cpu * CPU duty + light * backlight + relay * relay state)
+// offset() interpolates a table of up to CALIBRATION_MAX_POINTS raw temperatures linearly. The enclosure warms
+// up slowly, so the three heat sources are lagged with the time constant `tau` before they are weighed.
+
+#define CALIBRATION_PARTITION "calib"   // NVS partition written by tools/calibration
+#define CALIBRATION_MAX_POINTS 8
+#define CALIBRATION_DEFAULT_OFFSET -1.0f // Without a calibration, the SHT40 next to the ESP32 reads about 1 °C high
+
+// Loads the calibration of `sensors` sensors
+void calibration_init(int sensors);
+
+// Measures the CPU duty cycle since the last call and moves the lagged heat sources on to now.
+// Called once per poll, before the readings are corrected.
+void calibration_update(void);
+
+// Corrects the temperature of sensor `index` and recomputes the relative humidity for it
+void calibration_apply(int index, TempHumidity *temp_humid);
+
+#endif
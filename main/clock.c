@@ -0,0 +1,83 @@
+#include "clock.h"
+
+#include <esp_err.h>
+#include <esp_timer.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "datetime.h"
+#include "events.h"
+#include "gui/scr_main.h"
+
+static esp_timer_handle_t clock_timer = NULL;
+
+// What the labels show, so they are only set when it changes
+static char shown_time[6];
+static int shown_day;                     // Year * 1000 + day of the year, -1 for no date
+
+// Runs on the esp_timer task, which must not wait for the LVGL lock, so the event loop sets the labels
+static void on_timer(void *arg) {
+  eventloop_dispatch(HOMEKIT_THERMOSTAT_CLOCK_TICK);
+}
+
+static const esp_timer_create_args_t clock_timer_args = {
+  .callback = &on_timer,
+  .name = "clock"
+};
+
+void clock_start(void) {
+  ESP_ERROR_CHECK(esp_timer_create(&clock_timer_args, &clock_timer));
+  clock_show();
+}
+
+void clock_show(void) {
+  shown_time[0] = '\0';
+  shown_day = -1;
+  clock_update();
+}
+
+void clock_update(void) {
+  if (clock_timer == NULL) {
+    return;
+  }
+
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+
+  char time_text[sizeof(shown_time)];
+  char date_text[25];
+  const char *date = NULL;
+
+  // A clock restored from the checkpoint is behind by how long the power was off, so it is not shown
+  if (datetime_valid()) {
+    struct tm local;
+    localtime_r(&tv.tv_sec, &local);
+    datetime_timef(time_text, sizeof(time_text), &local);
+
+    int day = local.tm_year * 1000 + local.tm_yday;
+    if (day != shown_day) {
+      datetime_datef(date_text, sizeof(date_text), &local);
+      date = date_text;
+      shown_day = day;
+    }
+  } else {
+    strcpy(time_text, "--:--");
+    if (shown_day != -1) {
+      date = "";
+      shown_day = -1;
+    }
+  }
+
+  bool time_changed = strcmp(time_text, shown_time) != 0;
+  if (time_changed || date != NULL) {
+    strcpy(shown_time, time_text);
+    gui_set_datetime(date, time_changed ? time_text : NULL);
+  }
+
+  // Timezones are whole minutes off UTC, so the local minute turns over with the UTC one
+  uint64_t delay_us = (60 - tv.tv_sec % 60) * 1000000ULL - tv.tv_usec + CLOCK_MARGIN_US;
+  esp_timer_stop(clock_timer);
+  ESP_ERROR_CHECK(esp_timer_start_once(clock_timer, delay_us));
+}
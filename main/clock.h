@@ -0,0 +1,19 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+// The clock on the main screen. A one-shot timer fires just after every minute boundary, and only the text that
+// changed is formatted and set, the time once a minute and the date once a day.
+
+#define CLOCK_MARGIN_US 20000             // The timer fires this late, a slewed clock may run a little slow
+
+// Starts the timer, at the boot. Nothing is shown until the main screen is up, see clock_show().
+void clock_start(void);
+
+// The main screen was just created, so its labels are set again
+void clock_show(void);
+
+// Brings the clock up to date and arms the timer for the next minute. Called on HOMEKIT_THERMOSTAT_CLOCK_TICK,
+// and whenever the time was set.
+void clock_update(void);
+
+#endif
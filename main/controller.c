@@ -0,0 +1,335 @@
+#include "controller.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// The model is fitted by recursive least squares, once for every dead time up to CONTROLLER_MAX_DEAD_TIME.
+// The dead time whose model predicts CONTROLLER_CHECK_STEPS samples ahead best wins, as the one-step error
+// is mostly sensor noise and cannot tell the lag of the radiators apart. Temperatures are taken relative to
+// MODEL_TEMP_REF, so the bias `c` stays small and the fit well conditioned.
+#define MODEL_TEMP_REF 20.0f
+#define MODEL_NOISE 1e-3f             // Variance of the one-step equation error (sensor noise and model mismatch)
+#define MODEL_DRIFT_A 1e-8f           // How fast each parameter may wander per sample, as a variance.
+#define MODEL_DRIFT_B 1e-6f           // The room hardly changes, the heater output and the losses follow
+#define MODEL_DRIFT_C 1e-6f           // the boiler and the weather.
+#define MODEL_ERROR_SMOOTHING 0.02f
+#define MODEL_MAX_ERROR 0.3f          // Largest RMS prediction error a usable model may have (in °C)
+#define MODEL_MIN_SWITCHES 2          // The relay must have switched a few times to tell gain from drift
+
+// The planner tries every relay schedule with up to two switches within the horizon and keeps the cheapest.
+// Predictions are in m°C relative to the target, so the costs are integer math.
+#define PLAN_NEVER CONTROLLER_HORIZON
+#define PLAN_COST_OVERSHOOT 8         // Overshoot costs this many times more than the same undershoot
+#define PLAN_COST_UNDERSHOOT 1
+#define PLAN_COST_SWITCH 400000LL     // Roughly 0.2 °C of undershoot held for 10 samples
+
+typedef struct {
+  float theta[3];  // a, b, c
+  float p[3][3];
+  float error;     // Smoothed squared prediction error CONTROLLER_CHECK_STEPS samples ahead
+} model_fit_t;
+
+static float sample_period = 60.0f;
+static float a_min;                             // `a` of CONTROLLER_TAU_MIN_S and CONTROLLER_TAU_MAX_S
+static float a_max;
+static float sensor_delay = 0.0f;
+static int dwell_samples = 1;
+static model_fit_t fits[CONTROLLER_MAX_DEAD_TIME + 1];
+static bool relay_history[CONTROLLER_HISTORY];  // [0] was held during the last sample period
+static float temp_history[CONTROLLER_HISTORY];  // [0] is the last sample, relative to MODEL_TEMP_REF
+static int history_len = 0;
+static int relay_switches = 0;
+static int samples = 0;
+
+static void model_fit_init(model_fit_t *fit) {
+  memset(fit, 0, sizeof(model_fit_t));
+  // Start from a room that loses its heat over about an hour and an unknown heater
+  fit->theta[0] = expf(-sample_period / 3600.0f);
+  fit->p[0][0] = 1e-4f;
+  fit->p[1][1] = 1e-2f;
+  fit->p[2][2] = 1e-2f;
+  fit->error = 1.0f;
+}
+
+// Recursive least squares written as a Kalman filter over the parameters. Adding the drift instead of
+// forgetting old samples keeps the covariance bounded while the relay does not move the temperature much.
+static void model_fit_update(model_fit_t *fit, const float phi[3], float y) {
+  static const float drift[3] = {MODEL_DRIFT_A, MODEL_DRIFT_B, MODEL_DRIFT_C};
+  float p_phi[3];
+  float denom = MODEL_NOISE;
+  float predicted = 0;
+  for (int i = 0; i < 3; i++) {
+    p_phi[i] = fit->p[i][0] * phi[0] + fit->p[i][1] * phi[1] + fit->p[i][2] * phi[2];
+    denom += phi[i] * p_phi[i];
+    predicted += fit->theta[i] * phi[i];
+  }
+
+  float e = y - predicted;
+  for (int i = 0; i < 3; i++) {
+    fit->theta[i] += p_phi[i] / denom * e;
+    for (int j = 0; j < 3; j++) {
+      fit->p[i][j] -= p_phi[i] * p_phi[j] / denom;
+    }
+    fit->p[i][i] += drift[i];
+  }
+
+  // Near the target `a` and `c` are hard to tell apart, and with `a` close to 1 a small `b` already means a huge
+  // gain. Both are held in the range of real rooms, where the fit is still free to find the best model.
+  fit->theta[0] = fminf(fmaxf(fit->theta[0], a_min), a_max);
+  fit->theta[1] = fminf(fmaxf(fit->theta[1], CONTROLLER_GAIN_MIN * (1 - fit->theta[0])),
+                        CONTROLLER_GAIN_MAX * (1 - fit->theta[0]));
+}
+
+// A switch does not show in the samples before the sensor delay has passed, so the relay holds at least that long
+static void controller_update_dwell(void) {
+  dwell_samples = (int)ceilf(fmaxf(CONTROLLER_MIN_DWELL_S, sensor_delay) / sample_period);
+  if (dwell_samples < 1) {
+    dwell_samples = 1;
+  }
+  if (dwell_samples > CONTROLLER_HISTORY) {
+    dwell_samples = CONTROLLER_HISTORY;
+  }
+}
+
+void controller_init(float sample_period_s) {
+  sample_period = sample_period_s;
+  a_min = expf(-sample_period / CONTROLLER_TAU_MIN_S);
+  a_max = expf(-sample_period / CONTROLLER_TAU_MAX_S);
+  sensor_delay = 0.0f;
+  controller_update_dwell();
+
+  for (int d = 0; d <= CONTROLLER_MAX_DEAD_TIME; d++) {
+    model_fit_init(&fits[d]);
+  }
+  memset(relay_history, 0, sizeof(relay_history));
+  memset(temp_history, 0, sizeof(temp_history));
+  history_len = 0;
+  relay_switches = 0;
+  samples = 0;
+}
+
+// Runs the fit for `dead_time` from the sample CONTROLLER_CHECK_STEPS ago to the last one
+static float model_fit_check(const model_fit_t *fit, int dead_time) {
+  float x = temp_history[CONTROLLER_CHECK_STEPS];
+  for (int j = CONTROLLER_CHECK_STEPS - 1; j >= 0; j--) {
+    // relay_history[j] was held between temp_history[j + 1] and temp_history[j]
+    bool on = relay_history[j + dead_time];
+    x = fit->theta[0] * x + fit->theta[1] * (on ? 1.0f : 0.0f) + fit->theta[2];
+  }
+  return temp_history[0] - x;
+}
+
+void controller_sample(float temp, bool relay_on) {
+  if (history_len > 0 && relay_history[0] != relay_on) {
+    relay_switches++;
+  }
+  memmove(&relay_history[1], &relay_history[0], (CONTROLLER_HISTORY - 1) * sizeof(relay_history[0]));
+  memmove(&temp_history[1], &temp_history[0], (CONTROLLER_HISTORY - 1) * sizeof(temp_history[0]));
+  relay_history[0] = relay_on;
+  temp_history[0] = temp - MODEL_TEMP_REF;
+  if (history_len < CONTROLLER_HISTORY) {
+    history_len++;
+  }
+  samples++;
+
+  // The relay state pushed with the first sample was held before anything was measured
+  for (int d = 0; d <= CONTROLLER_MAX_DEAD_TIME && d + 1 < history_len; d++) {
+    float phi[3] = {temp_history[1], relay_history[d] ? 1.0f : 0.0f, 1.0f};
+    model_fit_update(&fits[d], phi, temp_history[0]);
+
+    if (CONTROLLER_CHECK_STEPS + d < history_len) {
+      float e = model_fit_check(&fits[d], d);
+      fits[d].error += MODEL_ERROR_SMOOTHING * (e * e - fits[d].error);
+    }
+  }
+}
+
+ControllerModel controller_model(void) {
+  int best = 0;
+  for (int d = 1; d <= CONTROLLER_MAX_DEAD_TIME; d++) {
+    if (fits[d].error < fits[best].error) {
+      best = d;
+    }
+  }
+
+  const model_fit_t *fit = &fits[best];
+  ControllerModel model = {
+    .a = fit->theta[0],
+    .b = fit->theta[1],
+    .c = fit->theta[2],
+    .dead_time = best,
+    .error = sqrtf(fit->error),
+  };
+
+  if (model.a > 0 && model.a < 1) {
+    model.tau_s = -sample_period / logf(model.a);
+    model.gain = model.b / (1 - model.a);
+  }
+
+  // The room has to cool down on its own and warm up with the heater, or the plan would be nonsense
+  model.ready = samples >= CONTROLLER_MIN_SAMPLES && relay_switches >= MODEL_MIN_SWITCHES && model.a > 0.5f &&
+                model.b > 0 &&
+                model.error < MODEL_MAX_ERROR;
+  return model;
+}
+
+// Samples the relay has been in `relay_on` for, a state the history does not end with has just been entered
+static int controller_dwell(bool relay_on) {
+  int dwell = 0;
+  while (dwell < history_len && relay_history[dwell] == relay_on) {
+    dwell++;
+  }
+  return dwell;
+}
+
+// Temperature change `k` samples from now caused by switching the heater on `s` samples from now
+static inline int32_t step_at(const int32_t *step, int k, int s) {
+  return k > s ? step[k - s] : 0;
+}
+
+static inline int64_t plan_error_cost(int32_t e) {
+  return (int64_t)e * e * (e > 0 ? PLAN_COST_OVERSHOOT : PLAN_COST_UNDERSHOOT);
+}
+
+// Temperature relative to the target `k` samples from now, for a schedule that starts in `on` and switches
+// at `s1` and `s2` (PLAN_NEVER for no switch)
+static int32_t plan_error_at(const int32_t *free_err, const int32_t *step, bool on, int s1, int s2, int k) {
+  if (on) {
+    return free_err[k] + step[k] - step_at(step, k, s1) + step_at(step, k, s2);
+  }
+  return free_err[k] + step_at(step, k, s1) - step_at(step, k, s2);
+}
+
+typedef struct {
+  const int32_t *free_err;
+  const int32_t *step;
+  bool on;
+  int last;                                     // Last sample a switch may be planned at
+  int64_t hold_cost[CONTROLLER_HORIZON + 1];    // Running cost of keeping the relay as it is
+  int64_t cost;                                 // Cheapest schedule so far
+  int s1;
+  int s2;
+} plan_search_t;
+
+// Costs every schedule whose first switch is at `s1`. Both the part before the first and before the second
+// switch is shared between many schedules, and costs only grow along the horizon, so the search stops
+// following a schedule as soon as it costs more than the cheapest one so far.
+static void plan_search(plan_search_t *search, int s1) {
+  int32_t err[CONTROLLER_HORIZON + 1];
+  int64_t cost[CONTROLLER_HORIZON + 1];
+  cost[0] = s1 == PLAN_NEVER ? 0 : PLAN_COST_SWITCH;
+  for (int k = 1; k <= CONTROLLER_HORIZON; k++) {
+    err[k] = plan_error_at(search->free_err, search->step, search->on, s1, PLAN_NEVER, k);
+    cost[k] = cost[k - 1] + plan_error_cost(err[k]);
+  }
+
+  if (s1 == PLAN_NEVER) {
+    memcpy(search->hold_cost, cost, sizeof(cost));
+  }
+  if (cost[CONTROLLER_HORIZON] < search->cost) {
+    search->cost = cost[CONTROLLER_HORIZON];
+    search->s1 = s1;
+    search->s2 = PLAN_NEVER;
+  }
+  if (s1 == PLAN_NEVER) {
+    return;
+  }
+
+  // The second switch undoes the first one
+  int32_t sign = search->on ? 1 : -1;
+  for (int s2 = s1 + dwell_samples; s2 <= search->last; s2++) {
+    int64_t total = cost[s2] + PLAN_COST_SWITCH;
+    if (total >= search->cost) {
+      break;
+    }
+    for (int k = s2 + 1; k <= CONTROLLER_HORIZON && total < search->cost; k++) {
+      total += plan_error_cost(err[k] + sign * search->step[k - s2]);
+    }
+    if (total < search->cost) {
+      search->cost = total;
+      search->s1 = s1;
+      search->s2 = s2;
+    }
+  }
+}
+
+static ControllerDecision controller_hysteresis(float temp, float target, bool relay_on, bool may_switch) {
+  ControllerDecision decision = {
+    .heat = relay_on,
+    .planned = false,
+    .next_switch = -1,
+    .peak = temp,
+  };
+
+  if (may_switch) {
+    if (temp < target - CONTROLLER_HYSTERESIS) {
+      decision.heat = true;
+    } else if (temp > target + CONTROLLER_HYSTERESIS) {
+      decision.heat = false;
+    }
+  }
+  return decision;
+}
+
+void controller_set_sensor_delay(float delay_s) {
+  sensor_delay = delay_s;
+  controller_update_dwell();
+}
+
+ControllerDecision controller_decide(float temp, float target, bool relay_on) {
+  int hold = dwell_samples - controller_dwell(relay_on);
+  if (hold < 0) {
+    hold = 0;
+  }
+
+  ControllerModel model = controller_model();
+  if (!model.ready) {
+    return controller_hysteresis(temp, target, relay_on, hold == 0);
+  }
+
+  // Predict the next samples with the heater off from now on, and the effect of turning it on
+  int32_t free_err[CONTROLLER_HORIZON + 1] = {0};
+  int32_t step[CONTROLLER_HORIZON + 1] = {0};
+  float x = temp - MODEL_TEMP_REF;
+  float s = 0;
+  for (int k = 0; k < CONTROLLER_HORIZON; k++) {
+    // The input acting on this sample was applied `dead_time` samples earlier
+    int applied = k - model.dead_time;
+    bool past_on = applied < 0 && -applied - 1 < history_len && relay_history[-applied - 1];
+    x = model.a * x + model.b * (past_on ? 1.0f : 0.0f) + model.c;
+    s = model.a * s + (applied >= 0 ? model.b : 0.0f);
+    free_err[k + 1] = (int32_t)lroundf((x + MODEL_TEMP_REF - target) * 1000);
+    step[k + 1] = (int32_t)lroundf(s * 1000);
+  }
+
+  // Switches after the last input that still shows up within the horizon cannot be judged
+  plan_search_t search = {
+    .free_err = free_err,
+    .step = step,
+    .on = relay_on,
+    .last = CONTROLLER_HORIZON - model.dead_time - 1,
+    .cost = INT64_MAX,
+  };
+  plan_search(&search, PLAN_NEVER);
+  for (int s1 = hold; s1 <= search.last && search.hold_cost[s1] + PLAN_COST_SWITCH < search.cost; s1++) {
+    plan_search(&search, s1);
+  }
+
+  int32_t peak = INT32_MIN;
+  for (int k = 1; k <= CONTROLLER_HORIZON; k++) {
+    int32_t e = plan_error_at(free_err, step, relay_on, search.s1, search.s2, k);
+    if (e > peak) {
+      peak = e;
+    }
+  }
+
+  ControllerDecision decision = {
+    .heat = search.s1 == 0 ? !relay_on : relay_on,
+    .planned = true,
+    .peak = target + peak / 1000.0f,
+  };
+  int next = search.s1 == 0 ? search.s2 : search.s1;
+  decision.next_switch = next == PLAN_NEVER ? -1 : next;
+  return decision;
+}
@@ -0,0 +1,57 @@
+#include <stdbool.h>
+
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+// Heating controller. It learns a first-order-plus-dead-time model of the room from the temperature samples and
+// the relay state, and plans when to switch the relay so the room reaches the target without overshooting it.
+// `make controller/sim` compares it with plain on/off control in a few simulated rooms.
+// Nothing is locked, so every call has to come from the same task, on the thermostat the temperature task.
+
+#define CONTROLLER_MAX_DEAD_TIME 30   // Longest dead time the model considers (in samples)
+#define CONTROLLER_HORIZON 60         // How far ahead the relay is planned (in samples)
+#define CONTROLLER_CHECK_STEPS 15     // The model is judged by how well it predicts this many samples ahead
+#define CONTROLLER_HISTORY (CONTROLLER_MAX_DEAD_TIME + CONTROLLER_CHECK_STEPS)  // Samples kept for the fit
+#define CONTROLLER_MIN_SAMPLES 90     // Samples to learn from before the model is used for planning
+#define CONTROLLER_MIN_DWELL_S 300    // Shortest time the relay stays on or off (in seconds)
+#define CONTROLLER_HYSTERESIS 0.2f    // Switching band around the target while the model is not ready (in °C)
+#define CONTROLLER_TAU_MIN_S 600      // Range of room time constants the model is held in (in seconds)
+#define CONTROLLER_TAU_MAX_S 36000
+#define CONTROLLER_GAIN_MIN 1.0f      // Range of steady-state temperature rises the model is held in (in °C)
+#define CONTROLLER_GAIN_MAX 30.0f
+
+typedef struct {
+  float a;            // T[k+1] = a * T[k] + b * relay[k - dead_time] + c
+  float b;
+  float c;
+  int dead_time;      // In samples
+  float tau_s;        // Time constant of the room (in seconds)
+  float gain;         // Steady-state temperature rise with the relay on (in °C)
+  float error;        // RMS error of the prediction CONTROLLER_CHECK_STEPS samples ahead (in °C)
+  bool ready;
+} ControllerModel;
+
+typedef struct {
+  bool heat;          // Relay state to hold until the next sample
+  bool planned;       // false while the controller falls back to hysteresis
+  int next_switch;    // Samples until the next planned switch, -1 when there is none within the horizon
+  float peak;         // Highest temperature the plan leads to
+} ControllerDecision;
+
+// Resets the model, `sample_period_s` is the time between two controller_sample() calls
+void controller_init(float sample_period_s);
+
+// How far the samples lag behind the room (in seconds), e.g. the delay of a filter. The relay then stays on or off
+// for at least that long, so it does not switch again before the last switch shows in the samples. It changes the
+// dwell that controller_decide() reads, so it is set on the task that decides, with every sample.
+void controller_set_sensor_delay(float delay_s);
+
+// Learns from the temperature measured at the end of a sample period and the relay state held during it
+void controller_sample(float temp, bool relay_on);
+
+// Plans the relay from the current temperature and returns what to do until the next sample
+ControllerDecision controller_decide(float temp, float target, bool relay_on);
+
+ControllerModel controller_model(void);
+
+#endif
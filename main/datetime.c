@@ -1,41 +1,189 @@
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
 #include <time.h>
+#include "datetime.h"
 #include "esp_attr.h"
-#include "esp_event.h"
+#include "esp_err.h"
 #include "esp_log.h"
 #include "esp_netif_sntp.h"
+#include "esp_private/esp_clk.h"
 #include "esp_sntp.h"
-#include "esp_system.h"
-#include "lwip/ip_addr.h"
-#include "time.h"
-#include "events.h"
+#include "esp_timer.h"
+#include "nvs.h"
 
 static const char *TAG = "TIME";
 
-void datetime_init(void) {
-  ESP_LOGI(TAG, "Fetching current time over NTP.");
+#define DATETIME_NVS_NAMESPACE "datetime"
+#define DATETIME_NVS_KEY "checkpoint"
+#define DATETIME_RTC_MAGIC 0x54494d45     // "TIME"
+#define DATETIME_MIN_TIME 1704067200      // 2024-01-01, an older checkpoint is not a time that was ever synced
 
-  // init NTP to fetch current time from the server
-  esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG("pool.ntp.org");
-  esp_netif_sntp_init(&config);
+// The wall time at an RTC counter reading. The counter keeps running through a reset, so the time now is the
+// wall time plus how far the counter got since. Not initialized at the boot, the check tells garbage after
+// a power loss apart.
+typedef struct {
+  uint32_t magic;
+  uint32_t quality;
+  int64_t wall_us;
+  uint64_t rtc_us;
+  uint32_t check;
+} DatetimeRtcRecord;
+
+static RTC_NOINIT_ATTR DatetimeRtcRecord rtc_record;
+
+static volatile DatetimeQuality quality = DATETIME_NONE;
+static void (*sync_cb)(void) = NULL;
+
+// Both run the checkpoint, on the esp_timer task, so the records are only ever written from there
+static esp_timer_handle_t checkpoint_timer;
+static esp_timer_handle_t checkpoint_now_timer;
+static time_t saved_at = 0;
+static volatile bool save_pending = false;
+
+static uint32_t record_check(const DatetimeRtcRecord *record) {
+  // FNV-1a over everything but the check itself
+  const uint8_t *bytes = (const uint8_t *)record;
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < offsetof(DatetimeRtcRecord, check); i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
 
-  int retry = 0;
-  const int retry_count = 15;
-  while (esp_netif_sntp_sync_wait(2000 / portTICK_PERIOD_MS) == ESP_ERR_TIMEOUT && ++retry < retry_count) {
-    char msg[50];
-    snprintf(msg, sizeof(msg), "Fetching current time... (%d/%d)", retry, retry_count);
-    eventloop_dispatch(HOMEKIT_THERMOSTAT_LOG, msg, strlen(msg) + 1);
+static void set_time(int64_t wall_us) {
+  struct timeval tv = {
+    .tv_sec = wall_us / 1000000,
+    .tv_usec = wall_us % 1000000,
+  };
+  settimeofday(&tv, NULL);
+}
 
-    // Add a short delay to avoid running the loop too fast
-    vTaskDelay(1000 / portTICK_PERIOD_MS); // 1-second delay
+static bool load_checkpoint(int64_t *checkpoint) {
+  nvs_handle_t nvs;
+  if (nvs_open(DATETIME_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+    return false;
   }
 
-  esp_netif_sntp_deinit();
+  esp_err_t err = nvs_get_i64(nvs, DATETIME_NVS_KEY, checkpoint);
+  nvs_close(nvs);
+  return err == ESP_OK;
+}
+
+static void save_checkpoint(int64_t checkpoint) {
+  nvs_handle_t nvs;
+  if (nvs_open(DATETIME_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to open NVS, the time checkpoint is not saved");
+    return;
+  }
+
+  nvs_set_i64(nvs, DATETIME_NVS_KEY, checkpoint);
+  nvs_commit(nvs);
+  nvs_close(nvs);
+}
+
+static void on_checkpoint(void *arg) {
+  // A clock that is only as late as the last checkpoint would hold the next one back, not move it on
+  if (quality < DATETIME_RESTORED) {
+    return;
+  }
+
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  rtc_record.magic = DATETIME_RTC_MAGIC;
+  rtc_record.quality = quality;
+  rtc_record.wall_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+  rtc_record.rtc_us = esp_clk_rtc_time();
+  rtc_record.check = record_check(&rtc_record);
+
+  // The flash only gets a write once in a while, a power loss costs the time since anyway
+  if (save_pending || tv.tv_sec - saved_at >= CONFIG_DATETIME_CHECKPOINT_PERIOD * 60) {
+    save_pending = false;
+    saved_at = tv.tv_sec;
+    save_checkpoint(tv.tv_sec);
+  }
+}
+
+static const esp_timer_create_args_t checkpoint_timer_args = {
+  .callback = &on_checkpoint,
+  .name = "datetime"
+};
+
+static void on_sntp_sync(struct timeval *tv) {
+  bool restored = quality >= DATETIME_RESTORED;
+  quality = DATETIME_SYNCED;
+
+  // The clock is close from now on, so a correction is spread out (adjtime) instead of the clock jumping,
+  // unless it is off by more than adjtime takes
+  sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH);
+  ESP_LOGI(TAG, "Time synced over NTP%s", restored ? ", slewing" : "");
 
-  // set timezone
-  setenv("TZ", "CET-1CEST,M3.5.0/2,M10.5.0/3", 1);  // Prague with the daylight saving time config
+  save_pending = true;
+  esp_timer_start_once(checkpoint_now_timer, 0);
+
+  if (sync_cb != NULL) {
+    sync_cb();
+  }
+}
+
+void datetime_init(void) {
+  // Parsed once here, localtime then only applies the rules
+  setenv("TZ", CONFIG_DATETIME_TIMEZONE, 1);
   tzset();
+
+  int64_t checkpoint = 0;
+  load_checkpoint(&checkpoint);
+
+  uint64_t rtc_now = esp_clk_rtc_time();
+  if (rtc_record.magic == DATETIME_RTC_MAGIC && rtc_record.check == record_check(&rtc_record) &&
+      rtc_now >= rtc_record.rtc_us) {
+    int64_t wall_us = rtc_record.wall_us + (int64_t)(rtc_now - rtc_record.rtc_us);
+
+    // The RTC counter starts over after some resets, which the checkpoint gives away
+    if (wall_us / 1000000 >= checkpoint) {
+      set_time(wall_us);
+      quality = DATETIME_RESTORED;
+    }
+  }
+  if (quality == DATETIME_NONE && checkpoint >= DATETIME_MIN_TIME) {
+    set_time(checkpoint * 1000000);
+    quality = DATETIME_CHECKPOINT;
+  }
+
+  time_t now = time(NULL);
+  if (quality == DATETIME_NONE) {
+    ESP_LOGI(TAG, "Time not set, waiting for NTP");
+  } else {
+    struct tm local = datetime_now();
+    char text[32];
+    strftime(text, sizeof(text), "%d.%m.%Y %H:%M:%S", &local);
+    ESP_LOGI(TAG, "Time restored from the %s: %s", quality == DATETIME_RESTORED ? "RTC" : "last checkpoint", text);
+  }
+
+  saved_at = quality == DATETIME_RESTORED ? now : 0;
+  ESP_ERROR_CHECK(esp_timer_create(&checkpoint_timer_args, &checkpoint_timer));
+  ESP_ERROR_CHECK(esp_timer_create(&checkpoint_timer_args, &checkpoint_now_timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(checkpoint_timer, DATETIME_RTC_PERIOD_S * 1000000ULL));
+}
+
+void datetime_sync(void (*on_sync)(void)) {
+  ESP_LOGI(TAG, "Syncing the time over NTP in the background.");
+  sync_cb = on_sync;
+
+  // A clock restored from the RTC is close already, so even the first sync slews it
+  esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_DATETIME_NTP_SERVER);
+  config.smooth_sync = quality >= DATETIME_RESTORED;
+  config.sync_cb = on_sntp_sync;
+  esp_netif_sntp_init(&config);
+}
+
+DatetimeQuality datetime_quality(void) {
+  return quality;
+}
+
+bool datetime_valid(void) {
+  return quality >= DATETIME_RESTORED;
 }
 
 struct tm datetime_now() {
@@ -52,4 +200,4 @@ void datetime_datef(char* buff, size_t buff_size, struct tm* timeinfo) {
 
 void datetime_timef(char* buff, size_t buff_size, struct tm* timeinfo) {
   strftime(buff, buff_size, "%H:%M", timeinfo);
-}
\ No newline at end of file
+}
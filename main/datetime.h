@@ -1,6 +1,37 @@
+#include <stdbool.h>
 #include <time.h>
 
+#ifndef DATETIME_H
+#define DATETIME_H
+
+// The wall clock. It is carried over a restart, so the schedule and the clock on the screen work right after the
+// boot, and NTP keeps it in sync in the background.
+//  - RTC slow memory keeps the wall time and the RTC counter it was taken at, both survive a reset (not a power loss)
+//  - the NVS checkpoint keeps the last time saved, which after a power loss is only a lower bound of the real time
+
+#define DATETIME_RTC_PERIOD_S 60          // How often the RTC record is refreshed, it only costs a memory write
+
+typedef enum {
+  DATETIME_NONE,                          // The clock is not set
+  DATETIME_CHECKPOINT,                    // Set to the last NVS checkpoint, behind by how long the power was off
+  DATETIME_RESTORED,                      // Carried over a reset by the RTC, off by its drift since the last sync
+  DATETIME_SYNCED,                        // Synced over NTP since the boot
+} DatetimeQuality;
+
+// Sets the timezone and restores the time from the RTC memory or the NVS checkpoint, no network needed
 void datetime_init(void);
+
+// Starts syncing the time over NTP in the background, once the network is up. The first sync steps the clock
+// if it is not restored, later ones slew it. `on_sync` is called after each of them.
+void datetime_sync(void (*on_sync)(void));
+
+DatetimeQuality datetime_quality(void);
+
+// The clock can be trusted for the schedule and the history, it has been synced or restored from the RTC
+bool datetime_valid(void);
+
 struct tm datetime_now(void);
 void datetime_datef(char* buff, size_t buff_size, struct tm* timeinfo);
-void datetime_timef(char* buff, size_t buff_size, struct tm* timeinfo);
\ No newline at end of file
+void datetime_timef(char* buff, size_t buff_size, struct tm* timeinfo);
+
+#endif
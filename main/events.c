@@ -1,28 +1,186 @@
+#include "events.h"
+
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
-#include "events.h"
+#include <freertos/task.h>
+#include <stdatomic.h>
+#include <string.h>
+
+static const char *TAG = "EVENTLOOP";
+
+#define LATENCY_SMOOTHING 8
+
+// Bounded multi-producer ring with a sequence number per slot (D. Vyukov). A producer claims a slot by moving
+// `head` on with a compare-and-swap, fills it and publishes it by setting its sequence. The single consumer
+// reads a slot once its sequence says it was published and hands it back to the producers a lap later.
+typedef struct {
+  atomic_uint sequence;
+  Event event;
+} EventSlot;
+
+typedef struct {
+  EventSlot *slots;
+  unsigned size;
+  atomic_uint head;
+  unsigned tail;                            // Only the event loop task reads
+} EventRing;
+
+static EventSlot control_slots[EVENTLOOP_CONTROL_SIZE];
+static EventSlot log_slots[EVENTLOOP_LOG_SIZE];
+static EventRing control_ring = {.slots = control_slots, .size = EVENTLOOP_CONTROL_SIZE};
+static EventRing log_ring = {.slots = log_slots, .size = EVENTLOOP_LOG_SIZE};
+
+static TaskHandle_t eventloop_task = NULL;
+static eventloop_handler handler = NULL;
+
+// Written by the event loop task only, `dropped` by the producers
+static EventStats stats[HOMEKIT_THERMOSTAT_EVENT_COUNT];
+static atomic_uint dropped[HOMEKIT_THERMOSTAT_EVENT_COUNT];
+
+static void ring_init(EventRing *ring) {
+  for (unsigned i = 0; i < ring->size; i++) {
+    atomic_init(&ring->slots[i].sequence, i);
+  }
+  atomic_init(&ring->head, 0);
+  ring->tail = 0;
+}
+
+static bool ring_push(EventRing *ring, const Event *event) {
+  unsigned pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  while (true) {
+    EventSlot *slot = &ring->slots[pos & (ring->size - 1)];
+    int diff = (int)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - pos);
+    if (diff == 0) {
+      // On failure, `pos` is updated to the head another producer moved on to
+      if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1, memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        slot->event = *event;
+        atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // The consumer has not read this slot since the last lap
+      return false;
+    } else {
+      pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    }
+  }
+}
+
+static bool ring_pop(EventRing *ring, Event *event) {
+  EventSlot *slot = &ring->slots[ring->tail & (ring->size - 1)];
+  if ((int)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - (ring->tail + 1)) < 0) {
+    return false;
+  }
+  *event = slot->event;
+  atomic_store_explicit(&slot->sequence, ring->tail + ring->size, memory_order_release);
+  ring->tail++;
+  return true;
+}
+
+static void handle(const Event *event) {
+  int64_t started = esp_timer_get_time();
+  handler(event);
+  uint32_t took = esp_timer_get_time() - started;
+  uint32_t latency = started - event->posted_us;
 
-// Main event that is used internally by the application
-ESP_EVENT_DEFINE_BASE(HOMEKIT_THERMOSTAT_EVENT);
+  EventStats *s = &stats[event->id];
+  s->handled++;
+  if (s->handled == 1) {
+    s->latency_avg_us = latency;
+  } else {
+    s->latency_avg_us += ((int32_t)latency - (int32_t)s->latency_avg_us) / LATENCY_SMOOTHING;
+  }
+  if (latency > s->latency_max_us) {
+    s->latency_max_us = latency;
+  }
+  if (took > s->handler_max_us) {
+    s->handler_max_us = took;
+  }
+}
+
+static void report(void) {
+  for (int id = 0; id < HOMEKIT_THERMOSTAT_EVENT_COUNT; id++) {
+    EventStats s = eventloop_stats(id);
+    if (s.handled > 0 || s.dropped > 0) {
+      ESP_LOGI(TAG, "Event %d: %lu handled, %lu dropped, latency avg %lu us, max %lu us, handler max %lu us", id,
+               s.handled, s.dropped, s.latency_avg_us, s.latency_max_us, s.handler_max_us);
+    }
+  }
+}
+
+static void eventloop_run(void *arg) {
+  Event event;
+  int64_t reported = esp_timer_get_time();
+
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(EVENTLOOP_REPORT_PERIOD_MS));
 
-static esp_event_loop_handle_t eventloop;
+    // Every log message waits for all pending control events, including those posted while it was handled
+    while (true) {
+      if (ring_pop(&control_ring, &event) || ring_pop(&log_ring, &event)) {
+        handle(&event);
+      } else {
+        break;
+      }
+    }
+
+    if (esp_timer_get_time() - reported >= EVENTLOOP_REPORT_PERIOD_MS * 1000LL) {
+      reported = esp_timer_get_time();
+      report();
+    }
+  }
+}
+
+static void post(EventRing *ring, const Event *event, bool wait) {
+  wait &= xTaskGetCurrentTaskHandle() != eventloop_task;
+  while (!ring_push(ring, event)) {
+    if (!wait) {
+      atomic_fetch_add_explicit(&dropped[event->id], 1, memory_order_relaxed);
+      return;
+    }
+    vTaskDelay(1);
+  }
+
+  if (eventloop_task != NULL) {
+    xTaskNotifyGive(eventloop_task);
+  }
+}
 
 void eventloop_init(eventloop_handler evt_handler) {
-  ESP_LOGI("EVENTLOOP", "Initializing Homekit Thermostat event loop");
-
-  esp_event_loop_args_t args = {
-      .queue_size = 20,                                  // Maximum number of events in the queue
-      .task_name = "eventloop_task",
-      .task_priority = uxTaskPriorityGet(NULL),         // Same priority as current task
-      .task_stack_size = configMINIMAL_STACK_SIZE * 3,  // Stack size for the event task
-      .task_core_id = tskNO_AFFINITY                    // Allow running on any core
+  ESP_LOGI(TAG, "Initializing Homekit Thermostat event loop");
+
+  handler = evt_handler;
+  ring_init(&control_ring);
+  ring_init(&log_ring);
+
+  // Same priority as the current task, like the esp_event loop it replaces
+  BaseType_t created = xTaskCreate(eventloop_run, "eventloop_task", configMINIMAL_STACK_SIZE * 3, NULL,
+                                   uxTaskPriorityGet(NULL), &eventloop_task);
+  ESP_ERROR_CHECK(created == pdPASS ? ESP_OK : ESP_ERR_NO_MEM);
+}
+
+void eventloop_dispatch(HomekitThermostatEventID event_id) {
+  Event event = {
+    .id = event_id,
+    .posted_us = esp_timer_get_time(),
   };
+  post(&control_ring, &event, true);
+}
 
-  ESP_ERROR_CHECK(esp_event_loop_create(&args, &eventloop));
-  ESP_ERROR_CHECK(esp_event_handler_register_with(eventloop, HOMEKIT_THERMOSTAT_EVENT, ESP_EVENT_ANY_ID, evt_handler, NULL));
+void eventloop_log(const char *msg) {
+  Event event = {
+    .id = HOMEKIT_THERMOSTAT_LOG,
+    .posted_us = esp_timer_get_time(),
+  };
+  strncpy(event.data.log, msg, EVENTLOOP_LOG_MAX - 1);
+  post(&log_ring, &event, false);
 }
 
-void eventloop_dispatch(HomekitThermostatEventID event_id, const void* event_data, size_t event_data_size) {
-  ESP_ERROR_CHECK(esp_event_post_to(eventloop, HOMEKIT_THERMOSTAT_EVENT, event_id, event_data, event_data_size, portMAX_DELAY));
-}
\ No newline at end of file
+EventStats eventloop_stats(HomekitThermostatEventID event_id) {
+  EventStats s = stats[event_id];
+  s.dropped = atomic_load_explicit(&dropped[event_id], memory_order_relaxed);
+  return s;
+}
@@ -1,4 +1,18 @@
-#include <esp_event.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+// Application event bus. Events are fixed-size records posted into lock-free multi-producer rings, one for the
+// control events and one for the log messages, and handled one by one by the event loop task, control events
+// first. Posting never allocates and never waits on the handler, so a burst of log messages cannot hold up a
+// control event, and no producer blocks on a full log ring, the message is dropped instead.
+
+#define EVENTLOOP_CONTROL_SIZE 16           // Ring slots, a power of two
+#define EVENTLOOP_LOG_SIZE 32               // Fits the initialization messages, some are posted inside a handler
+#define EVENTLOOP_LOG_MAX 100               // Longest log message, the loading screen shows no more either
+#define EVENTLOOP_REPORT_PERIOD_MS (10 * 60 * 1000)  // How often the latency counters are logged
 
 typedef enum {
   // Trigerred when WiFi credentials are not configured
@@ -11,11 +25,46 @@ typedef enum {
   HOMEKIT_THERMOSTAT_INIT_STARTED,
   // Trigerred when there is an update during the initialization process (e.g. Wifi connected, Homekit started, ...)
   HOMEKIT_THERMOSTAT_LOG,
-  // Trigerred when the initialization has completed, so the thermostat can start working
+  // Trigerred when the main screen can come up, at the boot or right after the provisioning, without waiting for the
+  // HomeKit server
   HOMEKIT_THERMOSTAT_INIT_DONE,
+  // Trigerred when the setpoint schedule reaches its next change
+  HOMEKIT_THERMOSTAT_SCHEDULE_DUE,
+  // Trigerred when the time was synced over NTP, the clock may have been stepped
+  HOMEKIT_THERMOSTAT_TIME_SYNCED,
+  // Trigerred just after every minute boundary, when the clock on the screen changes
+  HOMEKIT_THERMOSTAT_CLOCK_TICK,
+  // Number of event types, not an event
+  HOMEKIT_THERMOSTAT_EVENT_COUNT,
 } HomekitThermostatEventID;
 
-typedef void (*eventloop_handler)(void*, esp_event_base_t, int32_t, void*);
+typedef struct {
+  HomekitThermostatEventID id;
+  int64_t posted_us;                        // esp_timer time of the post
+  union {
+    char log[EVENTLOOP_LOG_MAX];            // HOMEKIT_THERMOSTAT_LOG
+  } data;
+} Event;
+
+typedef struct {
+  uint32_t handled;
+  uint32_t dropped;                         // Posts that found the ring full
+  uint32_t latency_avg_us;                  // From the post until the handler starts
+  uint32_t latency_max_us;
+  uint32_t handler_max_us;                  // Longest time spent in the handler
+} EventStats;
+
+typedef void (*eventloop_handler)(const Event *event);
 
 void eventloop_init(eventloop_handler);
-void eventloop_dispatch(HomekitThermostatEventID event_id, const void* event_data, size_t event_data_size);
+
+// Posts a control event, not from an ISR. When the ring is full, it waits a tick at a time until there is room,
+// except in a handler, which the wait would deadlock; the event is dropped and counted then.
+void eventloop_dispatch(HomekitThermostatEventID event_id);
+
+// Posts a HOMEKIT_THERMOSTAT_LOG message, copied and truncated to EVENTLOOP_LOG_MAX - 1 characters
+void eventloop_log(const char *msg);
+
+EventStats eventloop_stats(HomekitThermostatEventID event_id);
+
+#endif
@@ -0,0 +1,100 @@
+#include "filter.h"
+
+#include <math.h>
+#include <string.h>
+
+static float ema_alpha(const Filter *filter, float dt_s) {
+  if (filter->tau_s <= 0 || dt_s <= 0) {
+    return 1;
+  }
+  return 1 - expf(-dt_s / filter->tau_s);
+}
+
+static void restart(Filter *filter, float value) {
+  for (int i = 0; i < filter->median_len; i++) {
+    filter->ring[i] = value;
+    filter->sorted[i] = value;
+  }
+  filter->count = filter->median_len;
+  filter->head = 0;
+  filter->output = value;
+  filter->held_in_row = 0;
+  filter->ready = true;
+}
+
+// Replaces the oldest sample in the ring and keeps `sorted` in order, in one pass over each
+static float median_add(Filter *filter, float value) {
+  int n = filter->count;  // Samples in `sorted` besides the new one
+  if (n < filter->median_len) {
+    filter->ring[n] = value;
+    filter->count++;
+  } else {
+    float oldest = filter->ring[filter->head];
+    filter->ring[filter->head] = value;
+    filter->head = (filter->head + 1) % n;
+
+    int i = 0;
+    while (filter->sorted[i] != oldest) {
+      i++;
+    }
+    memmove(&filter->sorted[i], &filter->sorted[i + 1], (n - 1 - i) * sizeof(float));
+    n--;
+  }
+
+  int i = n;
+  for (; i > 0 && filter->sorted[i - 1] > value; i--) {
+    filter->sorted[i] = filter->sorted[i - 1];
+  }
+  filter->sorted[i] = value;
+
+  n = filter->count;
+  return n % 2 == 1 ? filter->sorted[n / 2] : (filter->sorted[n / 2 - 1] + filter->sorted[n / 2]) / 2;
+}
+
+void filter_init(Filter *filter, int median_len, float tau_s, float max_rate) {
+  memset(filter, 0, sizeof(Filter));
+  if (median_len < 1) {
+    median_len = 1;
+  }
+  if (median_len > FILTER_MAX_MEDIAN) {
+    median_len = FILTER_MAX_MEDIAN;
+  }
+  filter->median_len = median_len | 1;
+  filter->tau_s = tau_s;
+  filter->max_rate = max_rate;
+}
+
+float filter_add(Filter *filter, float value, float dt_s) {
+  filter->dt_s = dt_s;
+  if (!filter->ready) {
+    restart(filter, value);
+    return filter->output;
+  }
+
+  // The output lags a real change by the group delay, so the gate allows for that too
+  if (filter->max_rate > 0) {
+    float allowed = filter->max_rate * (dt_s + filter_delay_s(filter)) + FILTER_GATE_MARGIN;
+    if (fabsf(value - filter->output) > allowed) {
+      filter->held++;
+      if (++filter->held_in_row < FILTER_GATE_RESEED) {
+        return filter->output;
+      }
+      restart(filter, value);
+      return filter->output;
+    }
+  }
+  filter->held_in_row = 0;
+
+  float median = median_add(filter, value);
+  filter->output += ema_alpha(filter, dt_s) * (median - filter->output);
+  return filter->output;
+}
+
+bool filter_held(const Filter *filter) {
+  return filter->held_in_row > 0;
+}
+
+float filter_delay_s(const Filter *filter) {
+  float alpha = ema_alpha(filter, filter->dt_s);
+  return ((filter->median_len - 1) / 2.0f + (1 - alpha) / alpha) * filter->dt_s;
+}
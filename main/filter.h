@@ -0,0 +1,44 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef FILTER_H
+#define FILTER_H
+
+// Smooths a stream of sensor samples: the median of the last few samples, then an exponential moving average.
+// Samples that move further from the output than the quantity can change are held back before they reach the
+// median, so a single bad sample never gets into the output. Fixed memory and O(FILTER_MAX_MEDIAN) per sample.
+
+#define FILTER_MAX_MEDIAN 9           // Longest median window (in samples)
+#define FILTER_GATE_MARGIN 0.3f       // Noise a sample may add on top of the allowed rate of change
+#define FILTER_GATE_RESEED 3          // Held back this many times in a row, the change is real and the filter restarts
+
+typedef struct {
+  int median_len;
+  float tau_s;                        // EMA time constant, 0 leaves it out
+  float max_rate;                     // Fastest real change (per second), 0 turns the gate off
+  float ring[FILTER_MAX_MEDIAN];      // Last samples, oldest at `head` once full
+  float sorted[FILTER_MAX_MEDIAN];    // The same samples in order
+  int count;
+  int head;
+  float output;
+  bool ready;                         // false until the first sample
+  float dt_s;                         // Time between the last two samples
+  uint16_t held_in_row;
+  uint32_t held;                      // Samples held back by the gate
+} Filter;
+
+// `median_len` is rounded up to an odd number of samples
+void filter_init(Filter *filter, int median_len, float tau_s, float max_rate);
+
+// Adds a sample taken `dt_s` seconds after the previous one and returns the filtered value.
+// The EMA weight follows from `dt_s`, so the smoothing stays the same when the sampling period changes.
+float filter_add(Filter *filter, float value, float dt_s);
+
+// Whether the last sample was held back by the gate
+bool filter_held(const Filter *filter);
+
+// How far (in seconds) the output lags behind a slowly changing input at the last sampling period: half the
+// median window plus the EMA delay. A controller acting on the output should not switch faster than this.
+float filter_delay_s(const Filter *filter);
+
+#endif
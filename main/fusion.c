@@ -0,0 +1,174 @@
+#include "fusion.h"
+
+#include <math.h>
+#include <string.h>
+
+// The largest group of readings that lie within FUSION_MAX_SPREAD of each other is taken, so one bad sensor
+// cannot drag the room temperature along, not even when another one is out too. When groups are equally
+// large, e.g. two sensors that disagree, the one nearest to the last fused temperature wins. The readings
+// of the group are averaged, weighted by how closely each sensor has followed the fused temperature so far.
+// A group made up only of sensors that have been off by more than FUSION_MAX_SPREAD is not used while a
+// trusted sensor merely missed a read, the result is left out instead.
+#define DEVIATION_SMOOTHING 0.1f
+#define DEVIATION_FLOOR 0.05f         // About the repeatability of an SHT4x, so no sensor gets all the weight
+#define LATENCY_SMOOTHING 8           // The average latency follows the last few reads
+
+static int sensor_count = 0;
+static SensorStatus status[FUSION_MAX_SENSORS];
+static uint16_t skipped[FUSION_MAX_SENSORS];  // Measurements since an offline sensor was last tried
+static float last_temperature;
+static bool last_valid = false;
+
+static void record_latency(SensorStatus *s, uint32_t latency_us) {
+  if (s->reads == 1) {
+    s->latency_avg_us = latency_us;
+  } else {
+    s->latency_avg_us += ((int32_t)latency_us - (int32_t)s->latency_avg_us) / LATENCY_SMOOTHING;
+  }
+  if (latency_us > s->latency_max_us) {
+    s->latency_max_us = latency_us;
+  }
+}
+
+// Marks the readings of `candidates` that go into the result in `accepted`
+static void select_readings(const SensorSample *samples, const int *candidates, int n, bool trusted_missing,
+                            bool *accepted) {
+  int best_count = 0;
+  float best_low = 0;
+  float best_distance = 0;
+  bool best_trusted = false;
+
+  // Every group starts at one of the readings, at most FUSION_MAX_SENSORS² comparisons
+  for (int i = 0; i < n; i++) {
+    float low = samples[candidates[i]].temperature;
+    int count = 0;
+    float sum = 0;
+    float deviation = 0;
+    bool trusted = false;
+    for (int j = 0; j < n; j++) {
+      float t = samples[candidates[j]].temperature;
+      if (t >= low && t - low <= FUSION_MAX_SPREAD) {
+        count++;
+        sum += t;
+        deviation += status[candidates[j]].deviation;
+        trusted |= status[candidates[j]].deviation <= FUSION_MAX_SPREAD;
+      }
+    }
+
+    // Before the first result, the group of the sensors that followed it best so far wins
+    float distance = last_valid ? fabsf(sum / count - last_temperature) : deviation / count;
+    if (count > best_count || (count == best_count && distance < best_distance)) {
+      best_count = count;
+      best_low = low;
+      best_distance = distance;
+      best_trusted = trusted;
+    }
+  }
+
+  for (int i = 0; i < n; i++) {
+    float t = samples[candidates[i]].temperature;
+    accepted[i] = (best_trusted || !trusted_missing) && t >= best_low && t - best_low <= FUSION_MAX_SPREAD;
+  }
+}
+
+void fusion_init(int count) {
+  sensor_count = count < FUSION_MAX_SENSORS ? count : FUSION_MAX_SENSORS;
+  memset(status, 0, sizeof(status));
+  memset(skipped, 0, sizeof(skipped));
+  last_valid = false;
+}
+
+bool fusion_due(int index) {
+  return status[index].health != SENSOR_OFFLINE || skipped[index] + 1 >= FUSION_RETRY_PERIOD;
+}
+
+SensorFused fusion_update(const SensorSample *samples) {
+  SensorFused fused = {0};
+  int candidates[FUSION_MAX_SENSORS];
+  int n = 0;
+  bool trusted_missing = false;
+
+  for (int i = 0; i < sensor_count; i++) {
+    SensorStatus *s = &status[i];
+    if (samples[i].read == SENSOR_READ_SKIPPED) {
+      skipped[i]++;
+      continue;
+    }
+
+    skipped[i] = 0;
+    s->reads++;
+    record_latency(s, samples[i].latency_us);
+
+    if (samples[i].read == SENSOR_READ_FAILED) {
+      s->failures++;
+      s->failures_in_row++;
+      s->health = s->failures_in_row >= FUSION_OFFLINE_FAILURES ? SENSOR_OFFLINE : SENSOR_DEGRADED;
+      trusted_missing |= s->health != SENSOR_OFFLINE && s->deviation <= FUSION_MAX_SPREAD;
+      continue;
+    }
+
+    s->failures_in_row = 0;
+    s->temperature = samples[i].temperature;
+    s->humidity = samples[i].humidity;
+    candidates[n++] = i;
+  }
+
+  if (n == 0) {
+    return fused;
+  }
+
+  bool accepted[FUSION_MAX_SENSORS];
+  select_readings(samples, candidates, n, trusted_missing, accepted);
+
+  float weight_sum = 0;
+  for (int i = 0; i < n; i++) {
+    if (!accepted[i]) {
+      fused.rejected++;
+      continue;
+    }
+    const SensorStatus *s = &status[candidates[i]];
+    float weight = 1.0f / (s->deviation * s->deviation + DEVIATION_FLOOR * DEVIATION_FLOOR);
+    fused.temperature += weight * s->temperature;
+    fused.humidity += weight * s->humidity;
+    weight_sum += weight;
+    fused.used++;
+  }
+  if (fused.used == 0) {
+    return fused;
+  }
+  fused.temperature /= weight_sum;
+  fused.humidity /= weight_sum;
+  fused.valid = true;
+
+  for (int i = 0; i < n; i++) {
+    SensorStatus *s = &status[candidates[i]];
+    if (accepted[i]) {
+      s->outliers_in_row = 0;
+    } else {
+      s->outliers++;
+      s->outliers_in_row++;
+    }
+    s->deviation += (fabsf(s->temperature - fused.temperature) - s->deviation) * DEVIATION_SMOOTHING;
+    s->health = s->outliers_in_row >= FUSION_DEGRADED_OUTLIERS ? SENSOR_DEGRADED : SENSOR_OK;
+  }
+
+  last_temperature = fused.temperature;
+  last_valid = true;
+  return fused;
+}
+
+const SensorStatus *fusion_status(int index) {
+  return &status[index];
+}
+
+const char *fusion_health_str(SensorHealth health) {
+  switch (health) {
+    case SENSOR_OK:
+      return "ok";
+    case SENSOR_DEGRADED:
+      return "degraded";
+    case SENSOR_OFFLINE:
+      return "offline";
+  }
+  return "?";
+}
@@ -0,0 +1,70 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef FUSION_H
+#define FUSION_H
+
+// Fuses the readings of several temperature sensors into one room temperature and keeps track of their health.
+// tools/sensor_sim feeds it sensors that spike, drift, warm up or drop off the bus.
+
+#define FUSION_MAX_SENSORS 4
+#define FUSION_MAX_SPREAD 0.6f        // Readings that agree lie within this of each other (in °C)
+#define FUSION_DEGRADED_OUTLIERS 5    // Rejected this many times in a row, the sensor is degraded
+#define FUSION_OFFLINE_FAILURES 3     // Failed this many times in a row, the sensor is offline
+#define FUSION_RETRY_PERIOD 10        // An offline sensor is tried again every this many measurements
+
+typedef enum {
+  SENSOR_OK,
+  SENSOR_DEGRADED,                    // Fails or disagrees with the others now and then
+  SENSOR_OFFLINE,                     // Left out until it answers again
+} SensorHealth;
+
+typedef enum {
+  SENSOR_READ_OK,
+  SENSOR_READ_FAILED,                 // No answer, bus error or bad CRC
+  SENSOR_READ_SKIPPED,                // Not measured, the sensor is offline and not due for a retry
+} SensorRead;
+
+typedef struct {
+  SensorRead read;
+  float temperature;
+  float humidity;
+  uint32_t latency_us;                // Time spent on the bus for the command and the result
+} SensorSample;
+
+typedef struct {
+  SensorHealth health;
+  uint32_t reads;
+  uint32_t failures;
+  uint32_t outliers;
+  uint16_t failures_in_row;
+  uint16_t outliers_in_row;
+  float deviation;                    // Smoothed distance from the fused temperature (in °C)
+  float temperature;                  // Last reading
+  float humidity;
+  uint32_t latency_avg_us;
+  uint32_t latency_max_us;
+} SensorStatus;
+
+typedef struct {
+  float temperature;
+  float humidity;
+  uint8_t used;                       // Readings that went into the result
+  uint8_t rejected;                   // Readings rejected as outliers
+  bool valid;                         // false when no sensor gave a usable reading
+} SensorFused;
+
+// Forgets the state of all `count` sensors
+void fusion_init(int count);
+
+// Whether sensor `index` should be measured this time, offline sensors only every FUSION_RETRY_PERIOD times
+bool fusion_due(int index);
+
+// Fuses one reading of each sensor, `samples` has one entry for every sensor
+SensorFused fusion_update(const SensorSample *samples);
+
+const SensorStatus *fusion_status(int index);
+
+const char *fusion_health_str(SensorHealth health);
+
+#endif
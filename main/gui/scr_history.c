@@ -0,0 +1,298 @@
+#include "scr_history.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <lvgl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "gui.h"
+#include "../history.h"
+
+static const char *TAG = "HISTORY SCREEN";
+
+#define CHART_MAX_POINTS HISTORY_WEEK_POINTS
+#define CHART_LINE_WIDTH 2
+#define CHART_Y_LABELS_WIDTH 35
+#define CHART_X_LABELS_HEIGHT 20
+
+typedef struct {
+  const char *name;
+  int points;
+  uint32_t bucket_s;
+  int ticks;                    // Labelled ticks on the time axis, the last one is "now"
+  int tick_hours;               // Hours between two of them
+} chart_range_t;
+
+static const chart_range_t chart_ranges[HISTORY_RANGES] = {
+  [HISTORY_RANGE_DAY] = {"24 h", HISTORY_DAY_POINTS, HISTORY_DAY_BUCKET_S, 5, 6},
+  [HISTORY_RANGE_WEEK] = {"7 d", HISTORY_WEEK_POINTS, HISTORY_WEEK_BUCKET_S, 8, 24},
+};
+
+// GUI objects
+// ------------------------
+static lv_obj_t *scr_history;
+static lv_obj_t *prev_scr;
+static lv_obj_t *chart;
+static lv_obj_t *btn_ranges[HISTORY_RANGES];
+static lv_chart_series_t *ser_temp;
+static lv_chart_series_t *ser_target;
+static lv_chart_series_t *ser_duty;
+
+// The series draw straight from these arrays, one point per bucket, which is never more than the chart is wide
+static lv_coord_t temp_points[CHART_MAX_POINTS];
+static lv_coord_t target_points[CHART_MAX_POINTS];
+static lv_coord_t duty_points[CHART_MAX_POINTS];
+static HistoryPoint points[CHART_MAX_POINTS];
+
+static HistoryRange range = HISTORY_RANGE_DAY;
+static time_t last_start;       // Start of the bucket of the last point
+static lv_coord_t y_min;        // Temperature axis range in 0.01 °C
+static lv_coord_t y_max;
+
+static void chart_set_point(int i, const HistoryPoint *point) {
+  temp_points[i] = point->valid ? point->temp : LV_CHART_POINT_NONE;
+  target_points[i] = point->valid ? point->target : LV_CHART_POINT_NONE;
+  duty_points[i] = point->valid ? point->relay_duty : LV_CHART_POINT_NONE;
+}
+
+static bool chart_in_y_range(lv_coord_t value) {
+  return value == LV_CHART_POINT_NONE || (value >= y_min && value <= y_max);
+}
+
+// Fits the temperature axis to whole degrees around the points, with at most 6 labels
+static void chart_update_y_range(void) {
+  int count = chart_ranges[range].points;
+  int lo = INT16_MAX;
+  int hi = INT16_MIN;
+  for (int i = 0; i < count; i++) {
+    if (temp_points[i] == LV_CHART_POINT_NONE) {
+      continue;
+    }
+    lo = LV_MIN(lo, LV_MIN(temp_points[i], target_points[i]));
+    hi = LV_MAX(hi, LV_MAX(temp_points[i], target_points[i]));
+  }
+  if (lo > hi) {
+    lo = 1800;
+    hi = 2200;
+  }
+
+  int lo_deg = lo >= 0 ? lo / 100 : (lo - 99) / 100;
+  int hi_deg = hi >= 0 ? (hi + 99) / 100 : hi / 100;
+  if (hi_deg == lo_deg) {
+    hi_deg++;
+  }
+  int step = (hi_deg - lo_deg + 4) / 5;
+  hi_deg = lo_deg + (hi_deg - lo_deg + step - 1) / step * step;
+
+  y_min = lo_deg * 100;
+  y_max = hi_deg * 100;
+  lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, y_min, y_max);
+  lv_chart_set_axis_tick(chart, LV_CHART_AXIS_PRIMARY_Y, 6, 3, (hi_deg - lo_deg) / step + 1, 2, true,
+                         CHART_Y_LABELS_WIDTH);
+}
+
+// Invalidates only the strip between the last two points, which is all a new sample in the last bucket changes
+static void chart_invalidate_last(void) {
+  int count = chart_ranges[range].points;
+  lv_area_t area;
+  lv_obj_get_content_coords(chart, &area);
+  lv_coord_t width = lv_area_get_width(&area) - 1;
+  area.x1 += width * (count - 2) / (count - 1) - CHART_LINE_WIDTH;
+  area.x2 += CHART_LINE_WIDTH;
+  area.y1 -= CHART_LINE_WIDTH;
+  area.y2 += CHART_LINE_WIDTH;
+  lv_obj_invalidate_area(chart, &area);
+}
+
+// Refills the whole chart from the pre-aggregated buckets
+static void chart_load(void) {
+  int64_t started = esp_timer_get_time();
+  const chart_range_t *r = &chart_ranges[range];
+
+  last_start = history_points(range, time(NULL), points, r->points);
+  for (int i = 0; i < r->points; i++) {
+    chart_set_point(i, &points[i]);
+  }
+
+  lv_chart_set_point_count(chart, r->points);
+  lv_chart_set_axis_tick(chart, LV_CHART_AXIS_PRIMARY_X, 6, 3, r->ticks, 2, true, CHART_X_LABELS_HEIGHT);
+  chart_update_y_range();
+  lv_chart_refresh(chart);
+
+  ESP_LOGI(TAG, "Loaded %d points of the last %s in %lld us", r->points, r->name, esp_timer_get_time() - started);
+}
+
+static void chart_select_range(HistoryRange new_range) {
+  range = new_range;
+  for (int i = 0; i < HISTORY_RANGES; i++) {
+    if (i == range) {
+      lv_obj_add_state(btn_ranges[i], LV_STATE_CHECKED);
+    } else {
+      lv_obj_clear_state(btn_ranges[i], LV_STATE_CHECKED);
+    }
+  }
+  chart_load();
+}
+
+static void on_chart_draw_part(lv_event_t *e) {
+  lv_obj_draw_part_dsc_t *dsc = lv_event_get_draw_part_dsc(e);
+  if (!lv_obj_draw_part_check_type(dsc, &lv_chart_class, LV_CHART_DRAW_PART_TICK_LABEL) || dsc->text == NULL) {
+    return;
+  }
+
+  if (dsc->id == LV_CHART_AXIS_PRIMARY_Y) {
+    lv_snprintf(dsc->text, dsc->text_length, "%d°", (int)(dsc->value / 100));
+  } else if (dsc->id == LV_CHART_AXIS_PRIMARY_X) {
+    const chart_range_t *r = &chart_ranges[range];
+    int hours_ago = (r->ticks - 1 - dsc->value) * r->tick_hours;
+    if (hours_ago == 0) {
+      lv_snprintf(dsc->text, dsc->text_length, "now");
+    } else if (hours_ago % 24 == 0 && r->tick_hours >= 24) {
+      lv_snprintf(dsc->text, dsc->text_length, "-%dd", hours_ago / 24);
+    } else {
+      lv_snprintf(dsc->text, dsc->text_length, "-%dh", hours_ago);
+    }
+  }
+}
+
+static void on_range_btn_pressed(lv_event_t *e) {
+  lv_obj_t *btn = lv_event_get_target(e);
+  chart_select_range((HistoryRange)lv_obj_get_user_data(btn));
+}
+
+static void on_back_btn_pressed(lv_event_t *e) {
+  gui_load_scr(prev_scr);
+}
+
+static lv_obj_t *create_btn(lv_obj_t *parent, const char *text, lv_event_cb_t cb, void *user_data) {
+  lv_obj_t *btn = lv_btn_create(parent);
+  lv_obj_add_event_cb(btn, cb, LV_EVENT_CLICKED, NULL);
+  lv_obj_set_user_data(btn, user_data);
+
+  lv_obj_t *lbl = lv_label_create(btn);
+  lv_label_set_text(lbl, text);
+  lv_obj_center(lbl);
+  return btn;
+}
+
+static void create_scr(void) {
+  scr_history = lv_obj_create(NULL);
+  lv_obj_set_size(scr_history, LV_PCT(100), LV_PCT(100));
+  lv_obj_set_flex_flow(scr_history, LV_FLEX_FLOW_COLUMN);
+  lv_obj_set_style_pad_all(scr_history, 10, LV_PART_MAIN);
+
+  // top row: range buttons, legend and back button
+  lv_obj_t *top_cont = lv_obj_create(scr_history);
+  lv_obj_set_size(top_cont, LV_PCT(100), LV_SIZE_CONTENT);
+  lv_obj_set_flex_flow(top_cont, LV_FLEX_FLOW_ROW);
+  lv_obj_set_flex_align(top_cont, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+  lv_obj_set_style_border_width(top_cont, 0, LV_PART_MAIN);
+  lv_obj_set_style_pad_all(top_cont, 0, LV_PART_MAIN);
+
+  for (int i = 0; i < HISTORY_RANGES; i++) {
+    btn_ranges[i] = create_btn(top_cont, chart_ranges[i].name, on_range_btn_pressed, (void *)i);
+  }
+
+  lv_obj_t *legend = lv_label_create(top_cont);
+  lv_label_set_recolor(legend, true);
+  lv_label_set_text(legend, "#e72a86 temp# #0096FF target# #EE4B2B heat#");
+  lv_obj_set_flex_grow(legend, 1);
+  lv_obj_set_style_text_align(legend, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+
+  create_btn(top_cont, LV_SYMBOL_LEFT, on_back_btn_pressed, NULL);
+
+  // the axis labels are drawn outside of the chart, so leave room for them around it
+  lv_obj_t *chart_cont = lv_obj_create(scr_history);
+  lv_obj_set_width(chart_cont, LV_PCT(100));
+  lv_obj_set_flex_grow(chart_cont, 1);
+  lv_obj_set_style_border_width(chart_cont, 0, LV_PART_MAIN);
+  lv_obj_set_style_pad_all(chart_cont, 0, LV_PART_MAIN);
+  lv_obj_set_style_pad_left(chart_cont, CHART_Y_LABELS_WIDTH, LV_PART_MAIN);
+  lv_obj_set_style_pad_bottom(chart_cont, CHART_X_LABELS_HEIGHT, LV_PART_MAIN);
+  lv_obj_clear_flag(chart_cont, LV_OBJ_FLAG_SCROLLABLE);
+
+  chart = lv_chart_create(chart_cont);
+  lv_obj_set_size(chart, LV_PCT(100), LV_PCT(100));
+  lv_chart_set_type(chart, LV_CHART_TYPE_LINE);
+  lv_chart_set_update_mode(chart, LV_CHART_UPDATE_MODE_SHIFT);
+  lv_chart_set_div_line_count(chart, 5, 0);
+  lv_chart_set_range(chart, LV_CHART_AXIS_SECONDARY_Y, 0, 100);
+  lv_obj_set_style_size(chart, 0, LV_PART_INDICATOR);
+  lv_obj_set_style_line_width(chart, CHART_LINE_WIDTH, LV_PART_ITEMS);
+  lv_obj_add_event_cb(chart, on_chart_draw_part, LV_EVENT_DRAW_PART_BEGIN, NULL);
+
+  // the duty cycle goes first, so the temperatures are drawn on top of it
+  ser_duty = lv_chart_add_series(chart, lv_color_hex(0xEE4B2B), LV_CHART_AXIS_SECONDARY_Y);
+  ser_target = lv_chart_add_series(chart, lv_color_hex(0x0096FF), LV_CHART_AXIS_PRIMARY_Y);
+  ser_temp = lv_chart_add_series(chart, lv_color_hex(0xe72a86), LV_CHART_AXIS_PRIMARY_Y);
+  lv_chart_set_ext_y_array(chart, ser_duty, duty_points);
+  lv_chart_set_ext_y_array(chart, ser_target, target_points);
+  lv_chart_set_ext_y_array(chart, ser_temp, temp_points);
+}
+
+void gui_history_scr(void) {
+  ESP_LOGI(TAG, "Rendering");
+
+  if (!lvgl_lock(-1, "gui_history_scr")) {
+    ESP_LOGE(TAG, "Failed to acquire lock");
+    return;
+  }
+
+  if (scr_history == NULL) {
+    create_scr();
+  }
+  if (gui_active_scr != scr_history) {
+    prev_scr = gui_active_scr;
+  }
+  chart_select_range(range);
+
+  // this must be last thing called before showing the screen
+  lvgl_unlock();
+
+  gui_load_scr(scr_history);
+}
+
+void gui_history_update(void) {
+  if (scr_history == NULL || gui_active_scr != scr_history) {
+    return;
+  }
+
+  if (!lvgl_lock(-1, "gui_history_update")) {
+    ESP_LOGE(TAG, "Failed to acquire lock for history update");
+    return;
+  }
+
+  const chart_range_t *r = &chart_ranges[range];
+  HistoryPoint point;
+  time_t start = history_points(range, time(NULL), &point, 1);
+  int shift = (start - last_start) / (time_t)r->bucket_s;
+
+  if (shift < 0 || shift >= r->points) {
+    chart_load();
+  } else if (shift > 0) {
+    // The chart moves left by whole buckets, only the new ones (and the last one, which got its final samples) are
+    // read. Every point moves on the screen, so the whole chart is redrawn, but only once per bucket.
+    memmove(temp_points, temp_points + shift, (r->points - shift) * sizeof(lv_coord_t));
+    memmove(target_points, target_points + shift, (r->points - shift) * sizeof(lv_coord_t));
+    memmove(duty_points, duty_points + shift, (r->points - shift) * sizeof(lv_coord_t));
+    int fetched = LV_MIN(shift + 1, r->points);
+    last_start = history_points(range, start, points, fetched);
+    for (int i = 0; i < fetched; i++) {
+      chart_set_point(r->points - fetched + i, &points[i]);
+    }
+    chart_update_y_range();
+    lv_chart_refresh(chart);
+  } else {
+    chart_set_point(r->points - 1, &point);
+    if (chart_in_y_range(temp_points[r->points - 1]) && chart_in_y_range(target_points[r->points - 1])) {
+      chart_invalidate_last();
+    } else {
+      chart_update_y_range();
+      lv_chart_refresh(chart);
+    }
+  }
+
+  lvgl_unlock();
+}
@@ -0,0 +1,6 @@
+#include <lvgl.h>
+
+void gui_history_scr(void);
+
+// GUI handlers
+void gui_history_update(void);
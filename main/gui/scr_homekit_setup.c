@@ -0,0 +1,116 @@
+#include "scr_homekit_setup.h"
+
+#include <esp_log.h>
+#include <lv_qrcode.h>
+#include <lvgl.h>
+#include <string.h>
+
+#include "../homekit_setup.h"
+#include "fonts.h"
+#include "gui.h"
+
+static const char *TAG = "HOMEKIT SCREEN";
+
+static lv_obj_t *scr_homekit_setup;
+// Screen to go back to once the user is done with pairing
+static lv_obj_t *scr_return;
+
+static void on_btn_done(lv_event_t *e) {
+  if (scr_return != NULL) {
+    gui_load_scr(scr_return);
+  }
+}
+
+void gui_homekit_scr() {
+  // Only the code pair-setup checks is shown: the one in the setup record, or the one compiled in for development
+  // when the device has no record. A record with the verifier alone has nothing to show.
+  const char *code = homekit_setup_code();
+  const char *payload = homekit_setup_payload();
+#ifdef CONFIG_HOMEKIT_SETUP_CODE_FALLBACK
+  bool compiled_in = !homekit_setup_loaded();
+  if (compiled_in) {
+    code = CONFIG_HOMEKIT_SETUP_CODE;
+  }
+#endif
+  if (code == NULL) {
+    ESP_LOGW(TAG, "No setup code to show");
+    return;
+  }
+
+  ESP_LOGI(TAG, "Rendering");
+
+  if (!lvgl_lock(-1, "gui_homekit_scr")) {
+    ESP_LOGE(TAG, "Failed to acquire lock");
+    return;
+  }
+
+  scr_return = gui_active_scr;
+
+  if (scr_homekit_setup == NULL) {
+    // create main flexbox row container
+    scr_homekit_setup = lv_obj_create(NULL);
+    lv_obj_set_size(scr_homekit_setup, LV_PCT(100), LV_PCT(100));
+    lv_obj_set_flex_flow(scr_homekit_setup, LV_FLEX_FLOW_ROW);
+    lv_obj_set_flex_align(scr_homekit_setup, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+    lv_obj_set_style_pad_all(scr_homekit_setup, 10, LV_PART_MAIN);
+    lv_obj_set_style_border_width(scr_homekit_setup, 0, LV_PART_MAIN);
+    lv_obj_set_scrollbar_mode(scr_homekit_setup, LV_SCROLLBAR_MODE_OFF);
+
+    // add QR code, drawn straight from the pre-encoded image in flash for the compiled-in code,
+    // or encoded once from the payload of the setup record
+#ifdef CONFIG_HOMEKIT_SETUP_CODE_FALLBACK
+    if (compiled_in) {
+      lv_obj_t *qr = lv_img_create(scr_homekit_setup);
+      lv_img_set_src(qr, &homekit_qrcode_img);
+    } else
+#endif
+    if (payload != NULL) {
+      lv_obj_t *qr = lv_qrcode_create(scr_homekit_setup, 150, lv_color_black(), lv_color_white());
+      lv_qrcode_update(qr, payload, strlen(payload));
+    }
+
+    // add text column
+    lv_obj_t *text_cont = lv_obj_create(scr_homekit_setup);
+    lv_obj_set_height(text_cont, LV_PCT(100));
+    lv_obj_set_flex_grow(text_cont, 1);
+    lv_obj_set_flex_flow(text_cont, LV_FLEX_FLOW_COLUMN);
+    lv_obj_set_style_border_width(text_cont, 0, LV_PART_MAIN);
+    lv_obj_set_style_pad_all(text_cont, 0, LV_PART_MAIN);
+
+    // add title
+    lv_obj_t *lbl_title = lv_label_create(text_cont);
+    lv_label_set_text(lbl_title, "HomeKit");
+    lv_obj_add_style(lbl_title, &style_font26, LV_PART_MAIN);
+
+    // add description
+    lv_obj_t *lbl_descr = lv_label_create(text_cont);
+    bool has_qr = payload != NULL;
+#ifdef CONFIG_HOMEKIT_SETUP_CODE_FALLBACK
+    has_qr = has_qr || compiled_in;
+#endif
+    lv_label_set_text(lbl_descr, has_qr ? "Scan the code with the Home app or enter the setup code:"
+                                        : "Enter the setup code in the Home app:");
+    lv_label_set_long_mode(lbl_descr, LV_LABEL_LONG_WRAP);
+    lv_obj_set_width(lbl_descr, lv_pct(100));
+    lv_obj_set_flex_grow(lbl_descr, 1);
+
+    // add setup code
+    lv_obj_t *lbl_code = lv_label_create(text_cont);
+    lv_label_set_text(lbl_code, code);
+
+    // add done button
+    lv_obj_t *btn_done = lv_btn_create(text_cont);
+    lv_obj_set_width(btn_done, LV_PCT(100));
+    lv_obj_add_event_cb(btn_done, on_btn_done, LV_EVENT_CLICKED, NULL);
+
+    lv_obj_t *lbl_done = lv_label_create(btn_done);
+    lv_label_set_text(lbl_done, "Done");
+    lv_obj_center(lbl_done);
+  }
+
+  // this must be last thing called before showing the screen
+  lvgl_unlock();
+
+  // show screen on the display
+  gui_load_scr(scr_homekit_setup);
+}
@@ -0,0 +1,9 @@
+#include <lvgl.h>
+
+#ifdef CONFIG_HOMEKIT_SETUP_CODE_FALLBACK
+// HomeKit pairing QR code of the compiled-in setup code, pre-encoded at build time by tools/qrcode_gen
+LV_IMG_DECLARE(homekit_qrcode_img);
+#endif
+
+// Shows the setup code and the QR code pair-setup checks, nothing when the device has none
+void gui_homekit_scr(void);
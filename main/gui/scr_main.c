@@ -6,6 +6,7 @@
 
 #include "fonts.h"
 #include "gui.h"
+#include "scr_history.h"
 
 static const char *TAG = "MAIN SCREEN";
 
@@ -20,6 +21,7 @@ static lv_obj_t *btns_cont;
 static lv_obj_t *label_targ_temp;
 static lv_obj_t *label_curr_temp;
 static lv_obj_t *label_thermostat_status;
+static lv_obj_t *label_schedule;
 static lv_obj_t *time_label;
 static lv_obj_t *label_date;
 static lv_obj_t *label_btn_incr;
@@ -33,6 +35,9 @@ static lv_style_t style_btn_disabled;
 // Button pressed callback function
 temp_button_callback btn_pressed_callback;
 
+// Schedule line long pressed callback function
+static void (*schedule_pressed_callback)(void);
+
 static void on_btn_pressed(lv_event_t *e) {
   lv_obj_t *btn  = lv_event_get_target(e);
   ButtonType btn_type = (ButtonType)lv_obj_get_user_data(btn);
@@ -43,6 +48,16 @@ static void on_btn_pressed(lv_event_t *e) {
   }
 }
 
+static void on_curr_temp_pressed(lv_event_t *e) {
+  gui_history_scr();
+}
+
+static void on_schedule_pressed(lv_event_t *e) {
+  if (schedule_pressed_callback != NULL) {
+    schedule_pressed_callback();
+  }
+}
+
 static void create_btn(lv_obj_t **btn, lv_obj_t *lbl, ButtonType btn_type) {
   *btn = lv_btn_create(btns_cont);
   lv_obj_add_event_cb(*btn, on_btn_pressed, LV_EVENT_CLICKED, NULL);
@@ -89,19 +104,29 @@ void gui_main_scr() {
   lv_label_set_text(label_targ_temp, "");
 
   // underneath, add a current temperature label
+  // tapping it opens the history chart
   label_curr_temp = lv_label_create(data_cont);
   lv_label_set_recolor(label_curr_temp, true);
   lv_obj_add_style(label_curr_temp, &style_font26, LV_PART_MAIN);
   lv_label_set_text(label_curr_temp, "");
+  lv_obj_add_flag(label_curr_temp, LV_OBJ_FLAG_CLICKABLE);
+  lv_obj_add_event_cb(label_curr_temp, on_curr_temp_pressed, LV_EVENT_CLICKED, NULL);
 
   // next, add a thermostat status label
-  // this label will grow to take all the available white space
   label_thermostat_status = lv_label_create(data_cont);
   lv_label_set_recolor(label_thermostat_status, true);
   lv_obj_add_style(label_thermostat_status, &style_font26, LV_PART_MAIN);
-  lv_obj_set_flex_grow(label_thermostat_status, 1);
   lv_label_set_text(label_thermostat_status, "");
 
+  // underneath, add the next scheduled change
+  // this label will grow to take all the available white space
+  label_schedule = lv_label_create(data_cont);
+  lv_obj_set_flex_grow(label_schedule, 1);
+  lv_label_set_text(label_schedule, "");
+  // a long press turns the schedule on or off
+  lv_obj_add_flag(label_schedule, LV_OBJ_FLAG_CLICKABLE);
+  lv_obj_add_event_cb(label_schedule, on_schedule_pressed, LV_EVENT_LONG_PRESSED, NULL);
+
   // at the bottom, add a time label
   time_label = lv_label_create(data_cont);
   lv_label_set_recolor(time_label, true);
@@ -143,6 +168,10 @@ void gui_on_btn_pressed_cb(temp_button_callback cb) {
   btn_pressed_callback = cb;
 }
 
+void gui_on_schedule_pressed_cb(void (*cb)(void)) {
+  schedule_pressed_callback = cb;
+}
+
 static void gui_enable_btns(bool enable) {
   if (enable) {
     lv_obj_clear_state(btn_incr, LV_STATE_DISABLED);
@@ -216,10 +245,27 @@ void gui_set_datetime(const char *date, const char *time) {
   }
 
   if (lvgl_lock(-1, "gui_set_datetime")) {
-    lv_label_set_text(label_date, date);
-    lv_label_set_text(time_label, time);
+    if (date != NULL) {
+      lv_label_set_text(label_date, date);
+    }
+    if (time != NULL) {
+      lv_label_set_text(time_label, time);
+    }
     lvgl_unlock();
   } else {
     ESP_LOGE(TAG, "Failed to acquire lock for datetime");
   }
-}
\ No newline at end of file
+}
+
+void gui_set_schedule(const char *text) {
+  if (label_schedule == NULL) {
+    return;
+  }
+
+  if (lvgl_lock(-1, "gui_set_schedule")) {
+    lv_label_set_text(label_schedule, text);
+    lvgl_unlock();
+  } else {
+    ESP_LOGE(TAG, "Failed to acquire lock for schedule");
+  }
+}
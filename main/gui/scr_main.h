@@ -15,4 +15,7 @@ void gui_on_btn_pressed_cb(temp_button_callback);
 void gui_set_target_temp(float target);
 void gui_set_curr_temp(float current);
 void gui_set_thermostat_status(ThermostatStatus thermostat_status);
-void gui_set_datetime(const char *date, const char *time);
+void gui_set_datetime(const char *date, const char *time);  // NULL leaves the label as it is
+void gui_set_schedule(const char *text);
+// Called when the schedule line is long pressed
+void gui_on_schedule_pressed_cb(void (*cb)(void));
@@ -1,5 +1,6 @@
 #include <lvgl.h>
 #include <stdio.h>
+#include <string.h>
 #include <esp_log.h>
 #include <lv_qrcode.h>
 #include "fonts.h"
@@ -9,6 +10,10 @@ static const char *TAG = "WIFI SCREEN";
 
 static lv_obj_t *scr_wifi_setup;
 
+// Encoded QR code, kept between renders so showing the same payload again skips the encoder
+static lv_qrcode_cache_t qr_cache;
+static bool qr_cache_initialized = false;
+
 void gui_wifi_scr(char *qr_data, size_t qr_data_len) {
   ESP_LOGI(TAG, "Rendering");
 
@@ -46,8 +51,14 @@ void gui_wifi_scr(char *qr_data, size_t qr_data_len) {
   lv_obj_set_style_pad_all(qr_container, 0, LV_PART_MAIN);
 
   // add QR code (lv_canvas)
+  // A fixed mask skips scoring all 8 mask patterns, any mask scans fine from the LCD
+  if (!qr_cache_initialized) {
+    lv_qrcode_cache_init(&qr_cache, qrcodegen_Mask_0);
+    qr_cache_initialized = true;
+  }
   lv_obj_t *qr = lv_qrcode_create(qr_container, 130, lv_color_black(), lv_color_white());
-  lv_qrcode_update(qr, qr_data, qr_data_len);
+  // Encode only the JSON payload, not the zero padding of the buffer, to get a smaller QR version
+  lv_qrcode_update_cached(qr, &qr_cache, qr_data, strnlen(qr_data, qr_data_len));
 
   // this must be last thing called before showing the screen
   lvgl_unlock();
@@ -0,0 +1,535 @@
+#include "history.h"
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "HISTORY";
+
+#define HISTORY_MAGIC 0x31545348          // "HST1"
+#define HISTORY_MIN_TIME 1704067200       // 2024-01-01, anything earlier means the clock is not set yet
+#define HISTORY_MAX_GAP_S 86400           // A longer gap starts a new block
+#define HISTORY_SECTOR_SIZE 4096
+
+// Samples are kept in fixed point, the temperatures in 0.01 °C and the humidity in 0.1 %RH
+// (the SHT40 is not more accurate than that)
+#define TEMP_SCALE 100
+#define HUMIDITY_SCALE 10
+
+// The first sample of a block is kept in its header. Every later one is a bit stream of
+//   time:      delta-of-delta of the timestamp, a single '0' when the sample came at the usual interval
+//   temp:      difference to the previous temperature
+//   humidity:  difference to the previous humidity
+//   target:    difference to the previous target temperature, a single '0' while it is unchanged
+//   relay:     one bit
+// The numbers are zigzag encoded and prefixed by their size, see bits_put_number().
+#define NUMBER_MAX_BITS (4 + 32)
+#define SAMPLE_MAX_BITS (4 * NUMBER_MAX_BITS + 1)
+
+typedef struct {
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t crc;                 // Of the whole block with this field zeroed, set when the block is sealed
+  uint32_t first_time;
+  uint32_t last_time;
+  int16_t first_temp;
+  uint16_t first_humidity;
+  uint16_t count;
+  uint16_t bits;                // Used bits of `data`
+  uint8_t first_relay;
+  uint8_t reserved;
+  int16_t first_target;
+} history_header_t;
+
+typedef struct {
+  history_header_t header;
+  uint8_t data[HISTORY_BLOCK_SIZE - sizeof(history_header_t)];
+} history_block_t;
+
+_Static_assert(sizeof(history_block_t) == HISTORY_BLOCK_SIZE, "History block has padding");
+_Static_assert(HISTORY_SECTOR_SIZE % HISTORY_BLOCK_SIZE == 0, "History blocks must not cross flash sectors");
+
+typedef struct {
+  uint32_t time;
+  int32_t delta;                // Time since the previous sample
+  int32_t temp;
+  int32_t humidity;
+  int32_t target;
+  bool relay;
+} history_sample_t;
+
+typedef struct {
+  const history_block_t *block;
+  uint16_t pos;
+  uint16_t left;
+  history_sample_t sample;
+} history_reader_t;
+
+// Running aggregate of the bucket the query is in, written out when the samples move on to another bucket
+typedef struct {
+  int index;
+  uint32_t samples;
+  uint32_t relay_on;
+  int32_t temp_min;
+  int32_t temp_max;
+  int32_t temp_sum;
+  int32_t humidity_min;
+  int32_t humidity_max;
+  int32_t humidity_sum;
+  int32_t target_sum;
+} bucket_acc_t;
+
+// Chart bucket, summed up as the samples come in
+typedef struct {
+  uint32_t index;               // Start of the bucket divided by its length
+  uint16_t samples;
+  uint16_t relay_on;
+  int32_t temp_sum;
+  int32_t target_sum;
+} history_rollup_t;
+
+typedef struct {
+  uint32_t bucket_s;
+  int count;
+  history_rollup_t *rollups;    // Bucket `index` lives at `index % count`
+} history_range_t;
+
+// Ring of the last HISTORY_BLOCKS blocks, block `seq` lives at `seq % HISTORY_BLOCKS`.
+// The one at `head_seq` is still being appended to, all older ones are sealed.
+static history_block_t blocks[HISTORY_BLOCKS];
+static uint32_t head_seq = 0;
+static history_sample_t last_sample;
+static SemaphoreHandle_t history_mux = NULL;
+static const esp_partition_t *partition = NULL;
+static uint32_t flash_slots = 0;
+
+static history_rollup_t day_rollups[HISTORY_DAY_POINTS];
+static history_rollup_t week_rollups[HISTORY_WEEK_POINTS];
+static const history_range_t ranges[HISTORY_RANGES] = {
+  [HISTORY_RANGE_DAY] = {HISTORY_DAY_BUCKET_S, HISTORY_DAY_POINTS, day_rollups},
+  [HISTORY_RANGE_WEEK] = {HISTORY_WEEK_BUCKET_S, HISTORY_WEEK_POINTS, week_rollups},
+};
+
+static void bits_put(history_block_t *block, uint32_t value, int n) {
+  for (int i = n - 1; i >= 0; i--) {
+    if ((value >> i) & 1) {
+      block->data[block->header.bits >> 3] |= 0x80 >> (block->header.bits & 7);
+    }
+    block->header.bits++;
+  }
+}
+
+static uint32_t bits_get(history_reader_t *reader, int n) {
+  uint32_t value = 0;
+  for (int i = 0; i < n; i++) {
+    uint8_t byte = reader->block->data[reader->pos >> 3];
+    value = (value << 1) | ((byte >> (7 - (reader->pos & 7))) & 1);
+    reader->pos++;
+  }
+  return value;
+}
+
+// '0' for 0, then '10' + 2 bits, '110' + 4 bits, '1110' + 8 bits and '1111' + 32 bits
+static void bits_put_number(history_block_t *block, int32_t number) {
+  uint32_t zigzag = ((uint32_t)number << 1) ^ (uint32_t)(number >> 31);
+  if (zigzag == 0) {
+    bits_put(block, 0, 1);
+  } else if (zigzag < (1 << 2)) {
+    bits_put(block, 0x2, 2);
+    bits_put(block, zigzag, 2);
+  } else if (zigzag < (1 << 4)) {
+    bits_put(block, 0x6, 3);
+    bits_put(block, zigzag, 4);
+  } else if (zigzag < (1 << 8)) {
+    bits_put(block, 0xe, 4);
+    bits_put(block, zigzag, 8);
+  } else {
+    bits_put(block, 0xf, 4);
+    bits_put(block, zigzag, 32);
+  }
+}
+
+static int32_t bits_get_number(history_reader_t *reader) {
+  int prefix = 0;
+  while (prefix < 4 && bits_get(reader, 1)) {
+    prefix++;
+  }
+
+  static const int widths[] = {0, 2, 4, 8, 32};
+  uint32_t zigzag = bits_get(reader, widths[prefix]);
+  return (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+}
+
+static void history_reader_init(history_reader_t *reader, const history_block_t *block) {
+  reader->block = block;
+  reader->pos = 0;
+  reader->left = block->header.count;
+  reader->sample = (history_sample_t){
+    .time = block->header.first_time,
+    .temp = block->header.first_temp,
+    .humidity = block->header.first_humidity,
+    .target = block->header.first_target,
+    .relay = block->header.first_relay,
+  };
+}
+
+static bool history_reader_next(history_reader_t *reader, history_sample_t *sample) {
+  if (reader->left == 0) {
+    return false;
+  }
+
+  // The first sample comes straight from the header
+  if (reader->left < reader->block->header.count) {
+    history_sample_t *s = &reader->sample;
+    s->delta += bits_get_number(reader);
+    s->time += s->delta;
+    s->temp += bits_get_number(reader);
+    s->humidity += bits_get_number(reader);
+    s->target += bits_get_number(reader);
+    s->relay = bits_get(reader, 1);
+  }
+
+  reader->left--;
+  *sample = reader->sample;
+  return true;
+}
+
+static bool history_block_valid(const history_block_t *block) {
+  return block->header.magic == HISTORY_MAGIC && block->header.count > 0;
+}
+
+static void history_block_open(uint32_t seq) {
+  history_block_t *block = &blocks[seq % HISTORY_BLOCKS];
+  memset(block, 0, sizeof(history_block_t));
+  block->header.magic = HISTORY_MAGIC;
+  block->header.seq = seq;
+  head_seq = seq;
+}
+
+static void history_block_seal(history_block_t *block) {
+  block->header.crc = 0;
+  block->header.crc = esp_rom_crc32_le(0, (const uint8_t *)block, sizeof(history_block_t));
+}
+
+// Writes a sealed block into its slot of the partition. The sector is erased when its first slot comes
+// around, which drops the oldest blocks on flash, but they have long left the RAM ring anyway.
+static void history_block_persist(const history_block_t *block) {
+  if (partition == NULL) {
+    return;
+  }
+
+  size_t offset = (block->header.seq % flash_slots) * HISTORY_BLOCK_SIZE;
+  esp_err_t err = ESP_OK;
+  if (offset % HISTORY_SECTOR_SIZE == 0) {
+    err = esp_partition_erase_range(partition, offset, HISTORY_SECTOR_SIZE);
+  }
+  if (err == ESP_OK) {
+    err = esp_partition_write(partition, offset, block, HISTORY_BLOCK_SIZE);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Failed to store block %lu: %s", block->header.seq, esp_err_to_name(err));
+  }
+}
+
+static bool history_block_load(uint32_t seq) {
+  history_block_t *block = &blocks[seq % HISTORY_BLOCKS];
+  size_t offset = (seq % flash_slots) * HISTORY_BLOCK_SIZE;
+  if (esp_partition_read(partition, offset, block, HISTORY_BLOCK_SIZE) != ESP_OK) {
+    memset(block, 0, sizeof(history_block_t));
+    return false;
+  }
+
+  uint32_t crc = block->header.crc;
+  history_block_seal(block);
+  if (!history_block_valid(block) || block->header.seq != seq || block->header.crc != crc) {
+    memset(block, 0, sizeof(history_block_t));
+    return false;
+  }
+  return true;
+}
+
+static void history_rollup_add(const history_sample_t *sample) {
+  for (int i = 0; i < HISTORY_RANGES; i++) {
+    uint32_t index = sample->time / ranges[i].bucket_s;
+    history_rollup_t *rollup = &ranges[i].rollups[index % ranges[i].count];
+    if (rollup->index != index) {
+      *rollup = (history_rollup_t){.index = index};
+    }
+    rollup->samples++;
+    rollup->relay_on += sample->relay;
+    rollup->temp_sum += sample->temp;
+    rollup->target_sum += sample->target;
+  }
+}
+
+// Sums up the chart buckets again from the blocks loaded from flash
+static void history_rollup_rebuild(void) {
+  for (uint32_t i = 0; i < HISTORY_BLOCKS; i++) {
+    const history_block_t *block = &blocks[(head_seq + 1 + i) % HISTORY_BLOCKS];
+    if (!history_block_valid(block)) {
+      continue;
+    }
+
+    history_reader_t reader;
+    history_sample_t sample;
+    history_reader_init(&reader, block);
+    while (history_reader_next(&reader, &sample)) {
+      history_rollup_add(&sample);
+    }
+  }
+}
+
+void history_init(void) {
+  history_mux = xSemaphoreCreateMutex();
+  assert(history_mux);
+
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, HISTORY_PARTITION);
+  if (partition == NULL) {
+    ESP_LOGW(TAG, "No \"%s\" partition, the history is kept in RAM only", HISTORY_PARTITION);
+    history_block_open(0);
+    return;
+  }
+  flash_slots = partition->size / HISTORY_BLOCK_SIZE;
+
+  // Find the newest block from the headers only
+  bool found = false;
+  uint32_t newest = 0;
+  for (uint32_t slot = 0; slot < flash_slots; slot++) {
+    history_header_t header;
+    if (esp_partition_read(partition, slot * HISTORY_BLOCK_SIZE, &header, sizeof(header)) != ESP_OK) {
+      continue;
+    }
+    if (header.magic == HISTORY_MAGIC && header.seq % flash_slots == slot && (!found || header.seq > newest)) {
+      newest = header.seq;
+      found = true;
+    }
+  }
+
+  if (!found) {
+    history_block_open(0);
+    return;
+  }
+
+  // Everything but the slot of the block that is opened next
+  int loaded = 0;
+  uint32_t oldest = newest >= HISTORY_BLOCKS - 1 ? newest - (HISTORY_BLOCKS - 2) : 0;
+  for (uint32_t seq = oldest; seq <= newest; seq++) {
+    loaded += history_block_load(seq);
+  }
+  history_block_open(newest + 1);
+  history_rollup_rebuild();
+  ESP_LOGI(TAG, "Loaded %d blocks of history", loaded);
+}
+
+static int32_t to_fixed(float value, int scale, int32_t min, int32_t max) {
+  float fixed = roundf(value * scale);
+  if (fixed < min) {
+    return min;
+  }
+  if (fixed > max) {
+    return max;
+  }
+  return (int32_t)fixed;
+}
+
+void history_add(time_t time, float temp, float humidity, float target, bool relay_on) {
+  if (time < HISTORY_MIN_TIME || history_mux == NULL) {
+    return;
+  }
+
+  history_sample_t sample = {
+    .time = (uint32_t)time,
+    .temp = to_fixed(temp, TEMP_SCALE, INT16_MIN, INT16_MAX),
+    .humidity = to_fixed(humidity, HUMIDITY_SCALE, 0, UINT16_MAX),
+    .target = to_fixed(target, TEMP_SCALE, INT16_MIN, INT16_MAX),
+    .relay = relay_on,
+  };
+
+  xSemaphoreTake(history_mux, portMAX_DELAY);
+  history_block_t *block = &blocks[head_seq % HISTORY_BLOCKS];
+  history_block_t *sealed = NULL;
+
+  // Time only moves forward within a block, so queries can skip whole blocks by their time range
+  if (block->header.count > 0 &&
+      (sample.time <= last_sample.time || sample.time - last_sample.time > HISTORY_MAX_GAP_S ||
+       block->header.bits + SAMPLE_MAX_BITS > sizeof(block->data) * 8 || block->header.count == UINT16_MAX)) {
+    history_block_seal(block);
+    sealed = block;
+    history_block_open(head_seq + 1);
+    block = &blocks[head_seq % HISTORY_BLOCKS];
+  }
+
+  if (block->header.count == 0) {
+    block->header.first_time = sample.time;
+    block->header.first_temp = sample.temp;
+    block->header.first_humidity = sample.humidity;
+    block->header.first_target = sample.target;
+    block->header.first_relay = sample.relay;
+    sample.delta = 0;
+  } else {
+    sample.delta = sample.time - last_sample.time;
+    bits_put_number(block, sample.delta - last_sample.delta);
+    bits_put_number(block, sample.temp - last_sample.temp);
+    bits_put_number(block, sample.humidity - last_sample.humidity);
+    bits_put_number(block, sample.target - last_sample.target);
+    bits_put(block, sample.relay, 1);
+  }
+  block->header.count++;
+  block->header.last_time = sample.time;
+  last_sample = sample;
+  history_rollup_add(&sample);
+  xSemaphoreGive(history_mux);
+
+  // A sealed block is not touched again until the ring comes around, so it can be written without the lock
+  if (sealed != NULL) {
+    ESP_LOGI(TAG, "Block %lu sealed with %u samples (%.1f bits per sample)", sealed->header.seq,
+             sealed->header.count, (float)(sealed->header.bits + 8 * sizeof(history_header_t)) / sealed->header.count);
+    history_block_persist(sealed);
+  }
+}
+
+static void bucket_acc_flush(bucket_acc_t *acc, HistoryBucket *buckets) {
+  if (acc->index < 0) {
+    return;
+  }
+
+  HistoryBucket *bucket = &buckets[acc->index];
+  float temp_min = (float)acc->temp_min / TEMP_SCALE;
+  float temp_max = (float)acc->temp_max / TEMP_SCALE;
+  float humidity_min = (float)acc->humidity_min / HUMIDITY_SCALE;
+  float humidity_max = (float)acc->humidity_max / HUMIDITY_SCALE;
+  uint32_t samples = bucket->samples + acc->samples;
+
+  // A bucket can span two blocks, so merge with what an earlier block put into it
+  if (bucket->samples == 0 || temp_min < bucket->temp_min) {
+    bucket->temp_min = temp_min;
+  }
+  if (bucket->samples == 0 || temp_max > bucket->temp_max) {
+    bucket->temp_max = temp_max;
+  }
+  if (bucket->samples == 0 || humidity_min < bucket->humidity_min) {
+    bucket->humidity_min = humidity_min;
+  }
+  if (bucket->samples == 0 || humidity_max > bucket->humidity_max) {
+    bucket->humidity_max = humidity_max;
+  }
+  bucket->temp_avg = (bucket->temp_avg * bucket->samples + (float)acc->temp_sum / TEMP_SCALE) / samples;
+  bucket->humidity_avg =
+      (bucket->humidity_avg * bucket->samples + (float)acc->humidity_sum / HUMIDITY_SCALE) / samples;
+  bucket->target_avg = (bucket->target_avg * bucket->samples + (float)acc->target_sum / TEMP_SCALE) / samples;
+  bucket->relay_duty = (bucket->relay_duty * bucket->samples + acc->relay_on) / samples;
+  bucket->samples = samples > UINT16_MAX ? UINT16_MAX : samples;
+
+  acc->index = -1;
+}
+
+static void bucket_acc_add(bucket_acc_t *acc, int index, const history_sample_t *sample, HistoryBucket *buckets) {
+  if (index != acc->index) {
+    bucket_acc_flush(acc, buckets);
+    *acc = (bucket_acc_t){
+      .index = index,
+      .temp_min = sample->temp,
+      .temp_max = sample->temp,
+      .humidity_min = sample->humidity,
+      .humidity_max = sample->humidity,
+    };
+  }
+
+  acc->samples++;
+  acc->relay_on += sample->relay;
+  acc->temp_sum += sample->temp;
+  acc->humidity_sum += sample->humidity;
+  acc->target_sum += sample->target;
+  if (sample->temp < acc->temp_min) {
+    acc->temp_min = sample->temp;
+  }
+  if (sample->temp > acc->temp_max) {
+    acc->temp_max = sample->temp;
+  }
+  if (sample->humidity < acc->humidity_min) {
+    acc->humidity_min = sample->humidity;
+  }
+  if (sample->humidity > acc->humidity_max) {
+    acc->humidity_max = sample->humidity;
+  }
+}
+
+int history_query(time_t from, time_t to, uint32_t bucket_s, HistoryBucket *buckets, int max_buckets) {
+  if (to <= from || bucket_s == 0 || max_buckets <= 0 || history_mux == NULL) {
+    return 0;
+  }
+
+  int count = (to - from + bucket_s - 1) / bucket_s;
+  if (count > max_buckets) {
+    count = max_buckets;
+  }
+  to = from + (time_t)count * bucket_s;
+  for (int i = 0; i < count; i++) {
+    buckets[i] = (HistoryBucket){.start = from + (time_t)i * bucket_s};
+  }
+
+  bucket_acc_t acc = {.index = -1};
+  xSemaphoreTake(history_mux, portMAX_DELAY);
+  for (uint32_t i = 0; i < HISTORY_BLOCKS; i++) {
+    // Oldest first, so the buckets are mostly filled in order
+    const history_block_t *block = &blocks[(head_seq + 1 + i) % HISTORY_BLOCKS];
+    if (!history_block_valid(block) || block->header.last_time < from || block->header.first_time >= to) {
+      continue;
+    }
+
+    history_reader_t reader;
+    history_sample_t sample;
+    history_reader_init(&reader, block);
+    while (history_reader_next(&reader, &sample)) {
+      if (sample.time < from) {
+        continue;
+      }
+      if (sample.time >= to) {
+        break;
+      }
+      bucket_acc_add(&acc, (sample.time - from) / bucket_s, &sample, buckets);
+    }
+  }
+  bucket_acc_flush(&acc, buckets);
+  xSemaphoreGive(history_mux);
+
+  return count;
+}
+
+time_t history_points(HistoryRange range, time_t now, HistoryPoint *points, int count) {
+  const history_range_t *r = &ranges[range];
+  if (count > r->count) {
+    count = r->count;
+  }
+
+  uint32_t last = now / r->bucket_s;
+  if (history_mux == NULL || now < HISTORY_MIN_TIME) {
+    memset(points, 0, count * sizeof(HistoryPoint));
+    return (time_t)last * r->bucket_s;
+  }
+
+  xSemaphoreTake(history_mux, portMAX_DELAY);
+  for (int i = 0; i < count; i++) {
+    uint32_t index = last - (count - 1 - i);
+    const history_rollup_t *rollup = &r->rollups[index % r->count];
+    if (rollup->index != index || rollup->samples == 0) {
+      points[i] = (HistoryPoint){.valid = false};
+      continue;
+    }
+    points[i] = (HistoryPoint){
+      .temp = rollup->temp_sum / rollup->samples,
+      .target = rollup->target_sum / rollup->samples,
+      .relay_duty = rollup->relay_on * 100 / rollup->samples,
+      .valid = true,
+    };
+  }
+  xSemaphoreGive(history_mux);
+
+  return (time_t)last * r->bucket_s;
+}
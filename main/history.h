@@ -0,0 +1,58 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#define HISTORY_PARTITION "history"     // Raw data partition the sealed blocks are kept in across reboots
+#define HISTORY_BLOCK_SIZE 512          // A few hours of samples, compressed
+#define HISTORY_BLOCKS 48               // Blocks kept in RAM (24 KB), about two weeks at one sample a minute
+#define HISTORY_DAY_BUCKET_S 600        // Chart points of the last 24 hours
+#define HISTORY_DAY_POINTS 144
+#define HISTORY_WEEK_BUCKET_S 3600      // Chart points of the last 7 days
+#define HISTORY_WEEK_POINTS 168
+
+typedef enum {
+  HISTORY_RANGE_DAY,
+  HISTORY_RANGE_WEEK,
+  HISTORY_RANGES
+} HistoryRange;
+
+typedef struct {
+  time_t start;             // Start of the bucket
+  uint16_t samples;         // 0 when nothing was recorded in the bucket
+  float temp_min;
+  float temp_max;
+  float temp_avg;
+  float humidity_min;
+  float humidity_max;
+  float humidity_avg;
+  float target_avg;
+  float relay_duty;         // Share of the samples taken with the relay on (0..1)
+} HistoryBucket;
+
+// Chart point, in fixed point so it can go straight into an lv_chart series
+typedef struct {
+  int16_t temp;             // Average in 0.01 °C
+  int16_t target;           // Average in 0.01 °C
+  uint8_t relay_duty;       // In percent
+  bool valid;               // false when nothing was recorded in the bucket
+} HistoryPoint;
+
+// Loads the blocks kept in the history partition
+void history_init(void);
+
+// Records a sample. Samples taken before the clock was synchronized are dropped.
+void history_add(time_t time, float temp, float humidity, float target, bool relay_on);
+
+// Splits [from, to) into buckets of `bucket_s` seconds and aggregates the samples of each.
+// Returns the number of buckets filled, at most `max_buckets`.
+int history_query(time_t from, time_t to, uint32_t bucket_s, HistoryBucket *buckets, int max_buckets);
+
+// Fills `points` with the last `count` buckets of the range up to `now`, oldest first, the last one still being filled.
+// The buckets are aggregated as the samples come in, so this never decodes the blocks.
+// Returns the start of the last bucket.
+time_t history_points(HistoryRange range, time_t now, HistoryPoint *points, int count);
+
+#endif
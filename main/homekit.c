@@ -7,6 +7,7 @@
 #include <homekit/characteristics.h>
 #include <esp_err.h>
 #include "homekit.h"
+#include "homekit_setup.h"
 #include "events.h"
 
 static const char *TAG = "HOMEKIT";
@@ -16,6 +17,11 @@ static void (*on_homekit_update_cb)(HomekitState state);
 
 static void on_homekit_update(homekit_characteristic_t *ch, homekit_value_t value, void *context);
 
+// Callback handler when the Schedule switch is flipped
+static void (*on_schedule_switch_cb)(bool on);
+
+static void on_schedule_switch(homekit_characteristic_t *ch, homekit_value_t value, void *context);
+
 static homekit_characteristic_t name = HOMEKIT_CHARACTERISTIC_(NAME, THERMOSTAT_DEVICE_NAME);
 static homekit_characteristic_t manufacturer = HOMEKIT_CHARACTERISTIC_(MANUFACTURER, THERMOSTAT_DEVICE_MANUFACTURER);
 static homekit_characteristic_t serial = HOMEKIT_CHARACTERISTIC_(SERIAL_NUMBER, THERMOSTAT_DEVICE_SERIAL);
@@ -30,6 +36,7 @@ static homekit_characteristic_t current_state = HOMEKIT_CHARACTERISTIC_(CURRENT_
 static homekit_characteristic_t target_state = HOMEKIT_CHARACTERISTIC_(TARGET_HEATING_COOLING_STATE, THERMOSTAT_HEAT, .callback = HOMEKIT_CHARACTERISTIC_CALLBACK(on_homekit_update));
 static homekit_characteristic_t cooling_threshold = HOMEKIT_CHARACTERISTIC_(COOLING_THRESHOLD_TEMPERATURE, 25, .callback = HOMEKIT_CHARACTERISTIC_CALLBACK(on_homekit_update));
 static homekit_characteristic_t heating_threshold = HOMEKIT_CHARACTERISTIC_(HEATING_THRESHOLD_TEMPERATURE, 15, .callback = HOMEKIT_CHARACTERISTIC_CALLBACK(on_homekit_update));
+static homekit_characteristic_t schedule_switch = HOMEKIT_CHARACTERISTIC_(ON, false, .callback = HOMEKIT_CHARACTERISTIC_CALLBACK(on_schedule_switch));
 
 HomekitState homekit_get_state() {
   HomekitState state = {
@@ -49,6 +56,22 @@ static void on_homekit_update(homekit_characteristic_t *ch, homekit_value_t valu
   }
 }
 
+static void on_schedule_switch(homekit_characteristic_t *ch, homekit_value_t value, void *context) {
+  if (on_schedule_switch_cb != NULL) {
+    on_schedule_switch_cb(value.bool_value);
+  }
+}
+
+// The schedule sets the target from the boot on, before the server runs. The value is kept, and only notified
+// once the server is up.
+static bool server_started = false;
+
+static void notify(homekit_characteristic_t *ch) {
+  if (server_started) {
+    homekit_characteristic_notify(ch, ch->value);
+  }
+}
+
 void accessory_identify(homekit_value_t _value) {
   ESP_LOGI(TAG, "Accessory identified");
 }
@@ -79,43 +102,77 @@ static homekit_accessory_t *accessories[] = {
       &current_humidity,
       NULL
     }),
+    // The Home app has no schedule editor, so the weekly program can only be turned on and off there
+    HOMEKIT_SERVICE(SWITCH, .characteristics=(homekit_characteristic_t*[]) {
+      HOMEKIT_CHARACTERISTIC(NAME, "Schedule"),
+      &schedule_switch,
+      NULL
+    }),
     NULL
   }),
   NULL
 };
 #pragma GCC diagnostic pop
 
+#ifndef CONFIG_HOMEKIT_SETUP_CODE_FALLBACK
+// The library wants a setup code, without one compiled in it makes up a random one for every pair-setup. Pair-setup
+// checks the verifier of the setup record instead (see homekit_setup.c), so that code is not used.
+static void on_setup_code(const char *password) {
+}
+#endif
+
 static homekit_server_config_t config = {
   .accessories = accessories,
+#ifdef CONFIG_HOMEKIT_SETUP_CODE_FALLBACK
   .password = CONFIG_HOMEKIT_SETUP_CODE,
+#else
+  .password_callback = on_setup_code,
+#endif
   .setupId = CONFIG_HOMEKIT_SETUP_ID,
 };
 
-void homekit_init(void (*on_homekit_update)(HomekitState state)) {
-  // register callback
+void homekit_init(void (*on_homekit_update)(HomekitState state), void (*on_schedule_switch)(bool on)) {
+  // register callbacks
   on_homekit_update_cb = on_homekit_update;
+  on_schedule_switch_cb = on_schedule_switch;
 
   char *msg = "Starting HomeKit server...";
-  eventloop_dispatch(HOMEKIT_THERMOSTAT_LOG, msg, strlen(msg) + 1);
-  
+  eventloop_log(msg);
+
+  // Without a precomputed setup record, pair-setup falls back to `config.password`, if it is compiled in
+  homekit_setup_load();
+  if (homekit_setup_id() != NULL) {
+    config.setupId = (char *)homekit_setup_id();
+  }
+
   homekit_server_init(&config);
+  server_started = true;
 }
 
 void homekit_set_curr_temp(TempHumidity temp_humid) {
   current_temperature.value = HOMEKIT_FLOAT(temp_humid.temperature);
   current_humidity.value = HOMEKIT_FLOAT(temp_humid.humidity);
 
-  homekit_characteristic_notify(&current_temperature, current_temperature.value);
-  homekit_characteristic_notify(&current_humidity, current_humidity.value);
+  notify(&current_temperature);
+  notify(&current_humidity);
 }
 
 void homekit_set_target_temp(float temp) {
   ESP_LOGI(TAG, "Setting target temperature to %.1f°C", temp);
   target_temperature.value = HOMEKIT_FLOAT(temp);
-  homekit_characteristic_notify(&target_temperature, target_temperature.value);
+  notify(&target_temperature);
+}
+
+bool homekit_paired(void) {
+  return homekit_is_paired();
 }
 
 void homekit_set_thermostat_status(ThermostatStatus status) {
   current_state.value = HOMEKIT_UINT8(status);
-  homekit_characteristic_notify(&current_state, current_state.value);
+  notify(&current_state);
+}
+
+void homekit_set_schedule_enabled(bool on) {
+  schedule_switch.value = HOMEKIT_BOOL(on);
+  notify(&schedule_switch);
 }
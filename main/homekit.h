@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include "hw/sht40.h"
 
 #ifndef HOMEKIT_H
@@ -30,12 +31,15 @@ typedef struct {
   ThermostatStatus target_state;
 } HomekitState;
 
-void homekit_init(void (*on_homekit_update)(HomekitState state));
+// `on_schedule_switch` is called when the Schedule switch is turned on or off in the Home app
+void homekit_init(void (*on_homekit_update)(HomekitState state), void (*on_schedule_switch)(bool on));
 
 void homekit_set_curr_temp(TempHumidity temp_humid);
 void homekit_set_target_temp(float temp);
 void homekit_set_thermostat_status(ThermostatStatus status);
+void homekit_set_schedule_enabled(bool on);
 
 HomekitState homekit_get_state();
+bool homekit_paired(void);
 
 #endif
\ No newline at end of file
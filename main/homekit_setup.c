@@ -0,0 +1,251 @@
+#include "homekit_setup.h"
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/srp.h>
+
+static const char *TAG = "HOMEKIT_SETUP";
+
+#define HOMEKIT_SETUP_NVS_NAMESPACE "homekit"
+#define HOMEKIT_SETUP_NVS_KEY_SALT "salt"
+#define HOMEKIT_SETUP_NVS_KEY_VERIFIER "verifier"
+#define HOMEKIT_SETUP_NVS_KEY_CODE "code"
+#define HOMEKIT_SETUP_NVS_KEY_ID "setup_id"
+#define HOMEKIT_SETUP_NVS_KEY_PAYLOAD "payload"
+
+// RFC 5054 3072-bit group, the only one the HomeKit Accessory Protocol uses
+static const uint8_t srp_n3072[] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xC9, 0x0F, 0xDA, 0xA2, 0x21, 0x68, 0xC2, 0x34,
+  0xC4, 0xC6, 0x62, 0x8B, 0x80, 0xDC, 0x1C, 0xD1, 0x29, 0x02, 0x4E, 0x08, 0x8A, 0x67, 0xCC, 0x74,
+  0x02, 0x0B, 0xBE, 0xA6, 0x3B, 0x13, 0x9B, 0x22, 0x51, 0x4A, 0x08, 0x79, 0x8E, 0x34, 0x04, 0xDD,
+  0xEF, 0x95, 0x19, 0xB3, 0xCD, 0x3A, 0x43, 0x1B, 0x30, 0x2B, 0x0A, 0x6D, 0xF2, 0x5F, 0x14, 0x37,
+  0x4F, 0xE1, 0x35, 0x6D, 0x6D, 0x51, 0xC2, 0x45, 0xE4, 0x85, 0xB5, 0x76, 0x62, 0x5E, 0x7E, 0xC6,
+  0xF4, 0x4C, 0x42, 0xE9, 0xA6, 0x37, 0xED, 0x6B, 0x0B, 0xFF, 0x5C, 0xB6, 0xF4, 0x06, 0xB7, 0xED,
+  0xEE, 0x38, 0x6B, 0xFB, 0x5A, 0x89, 0x9F, 0xA5, 0xAE, 0x9F, 0x24, 0x11, 0x7C, 0x4B, 0x1F, 0xE6,
+  0x49, 0x28, 0x66, 0x51, 0xEC, 0xE4, 0x5B, 0x3D, 0xC2, 0x00, 0x7C, 0xB8, 0xA1, 0x63, 0xBF, 0x05,
+  0x98, 0xDA, 0x48, 0x36, 0x1C, 0x55, 0xD3, 0x9A, 0x69, 0x16, 0x3F, 0xA8, 0xFD, 0x24, 0xCF, 0x5F,
+  0x83, 0x65, 0x5D, 0x23, 0xDC, 0xA3, 0xAD, 0x96, 0x1C, 0x62, 0xF3, 0x56, 0x20, 0x85, 0x52, 0xBB,
+  0x9E, 0xD5, 0x29, 0x07, 0x70, 0x96, 0x96, 0x6D, 0x67, 0x0C, 0x35, 0x4E, 0x4A, 0xBC, 0x98, 0x04,
+  0xF1, 0x74, 0x6C, 0x08, 0xCA, 0x18, 0x21, 0x7C, 0x32, 0x90, 0x5E, 0x46, 0x2E, 0x36, 0xCE, 0x3B,
+  0xE3, 0x9E, 0x77, 0x2C, 0x18, 0x0E, 0x86, 0x03, 0x9B, 0x27, 0x83, 0xA2, 0xEC, 0x07, 0xA2, 0x8F,
+  0xB5, 0xC5, 0x5D, 0xF0, 0x6F, 0x4C, 0x52, 0xC9, 0xDE, 0x2B, 0xCB, 0xF6, 0x95, 0x58, 0x17, 0x18,
+  0x39, 0x95, 0x49, 0x7C, 0xEA, 0x95, 0x6A, 0xE5, 0x15, 0xD2, 0x26, 0x18, 0x98, 0xFA, 0x05, 0x10,
+  0x15, 0x72, 0x8E, 0x5A, 0x8A, 0xAA, 0xC4, 0x2D, 0xAD, 0x33, 0x17, 0x0D, 0x04, 0x50, 0x7A, 0x33,
+  0xA8, 0x55, 0x21, 0xAB, 0xDF, 0x1C, 0xBA, 0x64, 0xEC, 0xFB, 0x85, 0x04, 0x58, 0xDB, 0xEF, 0x0A,
+  0x8A, 0xEA, 0x71, 0x57, 0x5D, 0x06, 0x0C, 0x7D, 0xB3, 0x97, 0x0F, 0x85, 0xA6, 0xE1, 0xE4, 0xC7,
+  0xAB, 0xF5, 0xAE, 0x8C, 0xDB, 0x09, 0x33, 0xD7, 0x1E, 0x8C, 0x94, 0xE0, 0x4A, 0x25, 0x61, 0x9D,
+  0xCE, 0xE3, 0xD2, 0x26, 0x1A, 0xD2, 0xEE, 0x6B, 0xF1, 0x2F, 0xFA, 0x06, 0xD9, 0x8A, 0x08, 0x64,
+  0xD8, 0x76, 0x02, 0x73, 0x3E, 0xC8, 0x6A, 0x64, 0x52, 0x1F, 0x2B, 0x18, 0x17, 0x7B, 0x20, 0x0C,
+  0xBB, 0xE1, 0x17, 0x57, 0x7A, 0x61, 0x5D, 0x6C, 0x77, 0x09, 0x88, 0xC0, 0xBA, 0xD9, 0x46, 0xE2,
+  0x08, 0xE2, 0x4F, 0xA0, 0x74, 0xE5, 0xAB, 0x31, 0x43, 0xDB, 0x5B, 0xFC, 0xE0, 0xFD, 0x10, 0x8E,
+  0x4B, 0x82, 0xD1, 0x20, 0xA9, 0x3A, 0xD2, 0xCA, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+static const uint8_t srp_generator[] = {5};
+
+static bool setup_loaded = false;
+static uint8_t setup_salt[HOMEKIT_SETUP_SALT_SIZE];
+static uint8_t setup_verifier[HOMEKIT_SETUP_VERIFIER_SIZE];
+static size_t setup_verifier_len = 0;
+static char setup_code[11];               // XXX-XX-XXX
+static char setup_id[5];
+static char setup_payload[HOMEKIT_SETUP_PAYLOAD_SIZE];
+
+#ifdef CONFIG_HOMEKIT_SETUP_CODE_FALLBACK
+#define NO_RECORD "deriving the SRP verifier from the setup code"
+#else
+#define NO_RECORD "the thermostat cannot be paired"
+#endif
+
+// The text is optional, a record from before it was added only has the salt and the verifier
+static void load_str(nvs_handle_t nvs, const char *key, char *buff, size_t buff_size) {
+  size_t len = buff_size;
+  if (nvs_get_str(nvs, key, buff, &len) != ESP_OK) {
+    buff[0] = '\0';
+  }
+}
+
+bool homekit_setup_load(void) {
+  esp_err_t err = nvs_flash_init_partition(HOMEKIT_SETUP_PARTITION);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "No setup partition (%s), " NO_RECORD, esp_err_to_name(err));
+    return false;
+  }
+
+  nvs_handle_t nvs;
+  err = nvs_open_from_partition(HOMEKIT_SETUP_PARTITION, HOMEKIT_SETUP_NVS_NAMESPACE, NVS_READONLY, &nvs);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Setup partition is empty, " NO_RECORD);
+    return false;
+  }
+
+  size_t salt_len = sizeof(setup_salt);
+  setup_verifier_len = sizeof(setup_verifier);
+  err = nvs_get_blob(nvs, HOMEKIT_SETUP_NVS_KEY_SALT, setup_salt, &salt_len);
+  if (err == ESP_OK) {
+    err = nvs_get_blob(nvs, HOMEKIT_SETUP_NVS_KEY_VERIFIER, setup_verifier, &setup_verifier_len);
+  }
+  load_str(nvs, HOMEKIT_SETUP_NVS_KEY_CODE, setup_code, sizeof(setup_code));
+  load_str(nvs, HOMEKIT_SETUP_NVS_KEY_ID, setup_id, sizeof(setup_id));
+  load_str(nvs, HOMEKIT_SETUP_NVS_KEY_PAYLOAD, setup_payload, sizeof(setup_payload));
+  nvs_close(nvs);
+
+  if (err != ESP_OK || salt_len != sizeof(setup_salt) || setup_verifier_len == 0) {
+    ESP_LOGE(TAG, "Invalid setup record (%s)", esp_err_to_name(err));
+    return false;
+  }
+
+  setup_loaded = true;
+  ESP_LOGI(TAG, "Loaded precomputed SRP verifier (%u bytes)%s", (unsigned)setup_verifier_len,
+           setup_code[0] == '\0' ? ", without the setup code to show" : "");
+  return true;
+}
+
+bool homekit_setup_loaded(void) {
+  return setup_loaded;
+}
+
+const char *homekit_setup_code(void) {
+  return setup_loaded && setup_code[0] != '\0' ? setup_code : NULL;
+}
+
+const char *homekit_setup_id(void) {
+  return setup_loaded && setup_id[0] != '\0' ? setup_id : NULL;
+}
+
+const char *homekit_setup_payload(void) {
+  return setup_loaded && setup_payload[0] != '\0' ? setup_payload : NULL;
+}
+
+// The HomeKit library derives the verifier from the setup code in `crypto_srp_init()` at the start of
+// every pair-setup. The call is wrapped at link time (see CMakeLists.txt) so that a precomputed
+// record replaces the derivation, which saves a 3072-bit modular exponentiation per pairing.
+int __real_crypto_srp_init(Srp *srp, const char *username, const char *password);
+
+int __wrap_crypto_srp_init(Srp *srp, const char *username, const char *password) {
+  if (!setup_loaded) {
+#ifdef CONFIG_HOMEKIT_SETUP_CODE_FALLBACK
+    return __real_crypto_srp_init(srp, username, password);
+#else
+    // The password is the library's random one, which nobody gets to see
+    ESP_LOGE(TAG, "No setup record, flash one with `make homekit/setup-record`");
+    return BAD_STATE_E;
+#endif
+  }
+
+  int r = wc_SrpInit(srp, SRP_TYPE_SHA512, SRP_SERVER_SIDE);
+  if (!r) r = wc_SrpSetUsername(srp, (const byte *)username, strlen(username));
+  if (!r) r = wc_SrpSetParams(srp, srp_n3072, sizeof(srp_n3072), srp_generator, sizeof(srp_generator), setup_salt,
+                              sizeof(setup_salt));
+  if (!r) r = wc_SrpSetVerifier(srp, setup_verifier, setup_verifier_len);
+  if (r) {
+    ESP_LOGE(TAG, "Failed to set up SRP from the precomputed verifier (%d)", r);
+  }
+
+  return r;
+}
+
+#ifdef CONFIG_WOLFSSL_HAP_SRP_NONBLOCK
+// The pair-setup exponentiations take the single core for a long time. The library's calls are wrapped
+// at link time (see CMakeLists.txt) and run the non-blocking SRP API instead, one bounded step at a time,
+// giving the other tasks a tick whenever a slice of CONFIG_HOMEKIT_SRP_SLICE_MS has been used up.
+#define SRP_SLICE_US (CONFIG_HOMEKIT_SRP_SLICE_MS * 1000LL)
+
+typedef struct {
+  int64_t started;
+  int64_t slice_started;
+  int64_t longest_slice;
+  int slices;
+} srp_slicer_t;
+
+static void srp_slicer_start(srp_slicer_t *slicer) {
+  slicer->started = slicer->slice_started = esp_timer_get_time();
+  slicer->longest_slice = 0;
+  slicer->slices = 0;
+}
+
+static void srp_slicer_end_slice(srp_slicer_t *slicer, int64_t now) {
+  int64_t slice = now - slicer->slice_started;
+  if (slice > slicer->longest_slice) {
+    slicer->longest_slice = slice;
+  }
+  slicer->slices++;
+}
+
+// Called after every step, yields once the current slice is used up
+static void srp_slicer_step(srp_slicer_t *slicer) {
+  int64_t now = esp_timer_get_time();
+  if (now - slicer->slice_started < SRP_SLICE_US) {
+    return;
+  }
+  srp_slicer_end_slice(slicer, now);
+  vTaskDelay(1);
+  slicer->slice_started = esp_timer_get_time();
+}
+
+static void srp_slicer_report(srp_slicer_t *slicer, const char *what) {
+  int64_t now = esp_timer_get_time();
+  srp_slicer_end_slice(slicer, now);
+  ESP_LOGI(TAG, "%s took %lld ms in %d slices, longest slice %lld us", what, (now - slicer->started) / 1000,
+           slicer->slices, slicer->longest_slice);
+}
+
+int __real_wc_SrpGetPublic(Srp *srp, byte *pub, word32 *size);
+
+int __wrap_wc_SrpGetPublic(Srp *srp, byte *pub, word32 *size) {
+  SrpNb *nb = malloc(sizeof(SrpNb));
+  if (nb == NULL) {
+    ESP_LOGW(TAG, "No memory for time-sliced SRP, blocking");
+    return __real_wc_SrpGetPublic(srp, pub, size);
+  }
+
+  srp_slicer_t slicer;
+  srp_slicer_start(&slicer);
+  int r = wc_SrpSetNonBlock(srp, nb);
+  if (!r) {
+    while ((r = wc_SrpGetPublic_nb(srp, pub, size)) == FP_WOULDBLOCK) {
+      srp_slicer_step(&slicer);
+    }
+  }
+  srp_slicer_report(&slicer, "SRP public key");
+
+  wc_SrpSetNonBlock(srp, NULL);
+  free(nb);
+  return r;
+}
+
+int __real_wc_SrpComputeKey(Srp *srp, byte *client_key, word32 client_key_size, byte *server_key,
+                            word32 server_key_size);
+
+int __wrap_wc_SrpComputeKey(Srp *srp, byte *client_key, word32 client_key_size, byte *server_key,
+                            word32 server_key_size) {
+  SrpNb *nb = malloc(sizeof(SrpNb));
+  if (nb == NULL) {
+    ESP_LOGW(TAG, "No memory for time-sliced SRP, blocking");
+    return __real_wc_SrpComputeKey(srp, client_key, client_key_size, server_key, server_key_size);
+  }
+
+  srp_slicer_t slicer;
+  srp_slicer_start(&slicer);
+  int r = wc_SrpSetNonBlock(srp, nb);
+  if (!r) {
+    while ((r = wc_SrpComputeKey_nb(srp, client_key, client_key_size, server_key, server_key_size)) ==
+           FP_WOULDBLOCK) {
+      srp_slicer_step(&slicer);
+    }
+  }
+  srp_slicer_report(&slicer, "SRP session key");
+
+  wc_SrpSetNonBlock(srp, NULL);
+  free(nb);
+  return r;
+}
+#endif
@@ -0,0 +1,22 @@
+#include <stdbool.h>
+
+#ifndef HOMEKIT_SETUP_H
+#define HOMEKIT_SETUP_H
+
+#define HOMEKIT_SETUP_PARTITION "hk_setup"  // NVS partition written by tools/homekit_setup
+#define HOMEKIT_SETUP_SALT_SIZE 16
+#define HOMEKIT_SETUP_VERIFIER_SIZE 384     // 3072-bit SRP group
+#define HOMEKIT_SETUP_PAYLOAD_SIZE 24       // "X-HM://" and 13 characters
+
+// Loads the precomputed SRP salt and verifier from the setup partition, with the setup code, the setup ID and the
+// pairing QR code payload they were computed for. When it succeeds, pair-setup uses them directly instead of deriving
+// the verifier from a setup code in the firmware.
+bool homekit_setup_load(void);
+bool homekit_setup_loaded(void);
+
+// From the loaded record, NULL without one, or for a record from before they were added to it
+const char *homekit_setup_code(void);
+const char *homekit_setup_id(void);
+const char *homekit_setup_payload(void);
+
+#endif
@@ -30,6 +30,7 @@ static gpio_config_t bk_gpio_config = {
     .mode = GPIO_MODE_OUTPUT,
     .pin_bit_mask = 1ULL << CONFIG_LCD_PIN_LIGHT,
 };
+static float backlight_level = 0;
 // LCD 
 static esp_lcd_panel_io_handle_t io_handle = NULL;
 static esp_lcd_panel_io_spi_config_t io_config = {
@@ -92,4 +93,9 @@ void lcd_init() {
 
   ESP_LOGI(TAG, "Turn on LCD backlight");
   gpio_set_level(CONFIG_LCD_PIN_LIGHT, LCD_BK_LIGHT_ON_LEVEL);
+  backlight_level = 1;
+}
+
+float lcd_backlight_level() {
+  return backlight_level;
 }
\ No newline at end of file
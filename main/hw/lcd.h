@@ -16,4 +16,7 @@
 extern esp_lcd_panel_handle_t lcd_panel_handle;
 extern esp_lcd_touch_handle_t lcd_touch_handle;
 
-void lcd_init();
\ No newline at end of file
+void lcd_init();
+
+// Brightness of the backlight (0..1). It is switched by a GPIO, so this is either 0 or 1.
+float lcd_backlight_level();
\ No newline at end of file
@@ -1,33 +1,102 @@
 #include <sht4x.h>
+#include <stdio.h>
 #include <string.h>
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include "sht40.h"
 
-static sht4x_t sensor;
+typedef struct {
+  i2c_port_t port;
+  gpio_num_t sda;
+  gpio_num_t scl;
+  uint8_t addr;
+} Sht40Config;
 
-void sht40_init() {
+// Sensors on the same port share its pins and need different addresses (SHT40-AD1B 0x44, -BD1B 0x45, -CD1B 0x46)
+// Only the first FUSION_MAX_SENSORS entries are used, further sensors go here with a config block like the second one
+static const Sht40Config configs[] = {
+  {0, CONFIG_SHT40_I2C_SDA, CONFIG_SHT40_I2C_SCL, SHT4X_I2C_ADDRESS},
+#if CONFIG_SHT40_SECOND
+  {CONFIG_SHT40_SECOND_I2C_PORT, CONFIG_SHT40_SECOND_I2C_SDA, CONFIG_SHT40_SECOND_I2C_SCL, CONFIG_SHT40_SECOND_I2C_ADDR},
+#endif
+};
+
+#define SENSOR_COUNT ((int)(sizeof(configs) / sizeof(configs[0])))
+
+static sht4x_t sensors[SENSOR_COUNT];
+static char names[SENSOR_COUNT][16];
+
+// Logs what reading a result costs with a transaction built for the call and with the pre-built one
+static void sht40_report_overhead(sht4x_t *sensor) {
+  sht4x_raw_data_t raw;
+  int64_t took[2] = {0};
+
+  // Twice each, the first pre-built read also checks the port setup
+  for (int i = 0; i < 4; i++) {
+    if (sht4x_start_measurement(sensor) != ESP_OK) {
+      return;
+    }
+    vTaskDelay(sht4x_get_measurement_duration(sensor));
+
+    int64_t started = esp_timer_get_time();
+    esp_err_t err = i % 2 == 0 ? i2c_dev_read(&sensor->i2c_dev, NULL, 0, raw, sizeof(raw))
+                               : i2c_dev_trans_exec(&sensor->read_trans);
+    took[i % 2] = esp_timer_get_time() - started;
+    sensor->meas_started = false;
+    if (err != ESP_OK) {
+      return;
+    }
+  }
+
+  ESP_LOGI("SHT40", "Reading a result: %lld us built for the call, %lld us pre-built", took[0], took[1]);
+}
+
+int sht40_init() {
   ESP_ERROR_CHECK(i2cdev_init());
 
-  memset(&sensor, 0, sizeof(sht4x_t));
+  memset(sensors, 0, sizeof(sensors));
 
-  ESP_ERROR_CHECK(sht4x_init_desc(&sensor, 0, CONFIG_SHT40_I2C_SDA, CONFIG_SHT40_I2C_SCL));
-  ESP_ERROR_CHECK(sht4x_init(&sensor));
+  bool reported = false;
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    const Sht40Config *config = &configs[i];
+    snprintf(names[i], sizeof(names[i]), "%d@0x%02x", config->port, config->addr);
 
-  ESP_LOGI("SHT40", "Temperature sensor initialized.");
+    ESP_ERROR_CHECK(sht4x_init_desc_addr(&sensors[i], config->addr, config->port, config->sda, config->scl));
+    esp_err_t err = sht4x_init(&sensors[i]);
+    if (err != ESP_OK) {
+      ESP_LOGW("SHT40", "Sensor %s is not answering: %s", names[i], esp_err_to_name(err));
+      continue;
+    }
+
+    if (!reported) {
+      sht40_report_overhead(&sensors[i]);
+      reported = true;
+    }
+    ESP_LOGI("SHT40", "Sensor %s initialized, serial %08lx", names[i], sensors[i].serial);
+  }
+
+  return SENSOR_COUNT;
+}
+
+esp_err_t sht40_start(int index) {
+  return sht4x_start_measurement(&sensors[index]);
 }
 
-TempHumidity sht40_measure_temp() {
-  TempHumidity temp_humid = {};
-  ESP_ERROR_CHECK(sht4x_measure(&sensor, &temp_humid.temperature, &temp_humid.humidity));
+TickType_t sht40_duration(int index) {
+  return sht4x_get_measurement_duration(&sensors[index]);
+}
 
+esp_err_t sht40_read(int index, TempHumidity *temp_humid) {
+  return sht4x_get_results(&sensors[index], &temp_humid->temperature, &temp_humid->humidity);
+}
 
-  // Subtract 1°C as it has been noticed that the sensor is measuring increased values
-  // This is a weird hack, I know, maybe this could be fixed with the sensor calibration
-  // https://www.laskakit.cz/en/laskakit-sht40-senzor-teploty-a-vlhkosti-vzduchu/
-  // but I'm too lazy to do that now, so let's see if this is good enough 😅
-  temp_humid.temperature -= 1;
+esp_err_t sht40_recover(int index) {
+  return sht4x_init(&sensors[index]);
+}
 
-  return temp_humid;
-}
\ No newline at end of file
+const char *sht40_name(int index) {
+  return names[index];
+}
@@ -1,3 +1,6 @@
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+
 #ifndef SHT40_H
 #define SHT40_H
 typedef struct {
@@ -5,6 +8,19 @@ typedef struct {
   float humidity;
 } TempHumidity;
 
-void sht40_init();
-TempHumidity sht40_measure_temp();
-#endif
\ No newline at end of file
+// Sets up every sensor configured in menuconfig and returns how many there are.
+// A sensor that does not answer yet is still counted, it gets another chance with sht40_recover().
+int sht40_init();
+
+// Starts a conversion, the result is ready sht40_duration() ticks later
+esp_err_t sht40_start(int index);
+TickType_t sht40_duration(int index);
+// Raw reading, see calibration.h for the corrections
+esp_err_t sht40_read(int index, TempHumidity *temp_humid);
+
+// Reads the serial number and soft-resets the sensor, after it stopped answering
+esp_err_t sht40_recover(int index);
+
+// Port and address, for the logs
+const char *sht40_name(int index);
+#endif
@@ -5,55 +5,109 @@
 #include <freertos/task.h>
 #include <nvs_flash.h>
 #include <stdio.h>
+#include <time.h>
 
+#include "clock.h"
 #include "datetime.h"
 #include "events.h"
+#include "history.h"
 #include "gui/gui.h"
+#include "gui/scr_homekit_setup.h"
 #include "gui/scr_loading.h"
 #include "gui/scr_main.h"
 #include "gui/scr_wifi_setup.h"
 #include "homekit.h"
+#include "ota.h"
+#include "rng.h"
+#include "schedule.h"
+#include "sensors.h"
 #include "hw/lcd.h"
 #include "hw/led.h"
 #include "hw/relay.h"
-#include "hw/sht40.h"
 #include "wifi.h"
 #include "tasks/tasks.h"
 
-static bool thermostat_initialized = false;
+#define WIFI_HINT_ATTEMPTS 5               // Failed attempts after the provisioning before it is offered again
+
+static bool main_scr_shown = false;
+static bool network_started = false;      // The HomeKit server and SNTP run, since the first connection
 static int failed_wifi_attempts = 0;
-static bool should_wifi_retry = true;
 
-void on_homekit_update(HomekitState state) {
+// Shows when the schedule changes the target next, or until when a manual target holds
+static void show_schedule() {
+  ScheduleStatus status = schedule_status();
+  char text[40] = "";
+  if (!status.enabled) {
+    snprintf(text, sizeof(text), "schedule off");
+  } else if (status.active && status.next_change != 0) {
+    struct tm local;
+    localtime_r(&status.next_change, &local);
+    char at[16];
+    strftime(at, sizeof(at), status.next_change - time(NULL) < 24 * 3600 ? "%H:%M" : "%a %H:%M", &local);
+    if (status.hold) {
+      snprintf(text, sizeof(text), "hold until %s", at);
+    } else if (status.preheat) {
+      snprintf(text, sizeof(text), "preheat for %s", at);
+    } else {
+      snprintf(text, sizeof(text), "%.1f°C at %s", status.next_target, at);
+    }
+  }
+  gui_set_schedule(text);
+}
+
+static void thermostat_update(HomekitState state) {
   // If the target state is set to either OFF or to one of unsupported states,
-  // turn the thermostat off
+  // turn the thermostat off, otherwise make sure the current state is set to HEAT
   if (state.target_state == THERMOSTAT_OFF || state.target_state == _THERMOSTAT_AUTO || state.target_state == _THERMOSTAT_COOL) {
     homekit_set_thermostat_status(THERMOSTAT_OFF);
-    relay_off();
-    gui_set_thermostat_status(THERMOSTAT_OFF);
+  } else {
+    homekit_set_thermostat_status(THERMOSTAT_HEAT);
+  }
+
+  // The temperature task switches the relay, it replans right away for the new target instead of waiting for the
+  // next temperature sample
+  task_temperature_replan();
+
+  // Update target temperature in GUI
+  gui_set_target_temp(state.target_temp);
+}
 
-    return;
+void on_homekit_update(HomekitState state) {
+  // A target set in the Home app holds until the next scheduled change. Every other write (e.g. the mode) leaves
+  // the schedule alone, the app also sends them with the target it already shows.
+  if (state.target_temp != schedule_status().target) {
+    schedule_hold(state.target_temp);
+    show_schedule();
   }
 
-  // Otherwise, make sure the current state is set to HEAT
-  homekit_set_thermostat_status(THERMOSTAT_HEAT);
+  thermostat_update(state);
+}
 
-  if (state.current_temp < state.target_temp) {
-    if (!relay_turned_on) {
-      ESP_LOGI("HOMEKIT_UPDATE", "Current temperature (%.1f) is lower than the target (%.1f). Switching relay ON", state.current_temp, state.target_temp);
-      relay_on();
-    }
-    gui_set_thermostat_status(THERMOSTAT_HEAT);
-  } else if (state.current_temp >= state.target_temp) {
-    if (relay_turned_on) {
-      ESP_LOGI("HOMEKIT_UPDATE", "Current temperature (%.1f) is higher or equal than the target (%.1f). Switching relay OFF", state.current_temp, state.target_temp);
-      relay_off();
-    }
-    gui_set_thermostat_status(_THERMOSTAT_IDLE);
+// Turns the weekly program on or off from the screen or the Home app. The edit goes through schedule_update(),
+// which swaps the program in whole.
+static void set_schedule_enabled(bool enabled) {
+  ScheduleConfig config;
+  schedule_get(&config);
+  if (config.enabled != enabled) {
+    config.enabled = enabled;
+    schedule_update(&config);
   }
 
-  // Update target temperature in GUI
-  gui_set_target_temp(state.target_temp);
+  homekit_set_schedule_enabled(enabled);
+  show_schedule();
+}
+
+static void on_schedule_switch(bool on) {
+  set_schedule_enabled(on);
+}
+
+static void on_schedule_pressed(void) {
+  set_schedule_enabled(!schedule_status().enabled);
+}
+
+void on_schedule_change(float target) {
+  homekit_set_target_temp(target);
+  thermostat_update(homekit_get_state());
 }
 
 void restart_wifi_prov() {
@@ -83,16 +137,23 @@ void on_temp_btn(ButtonType type) {
     }
   }
 
-  // Update homekit
+  // A target set on the screen holds until the next scheduled change
+  schedule_hold(new_temp);
+  show_schedule();
+
+  // Update homekit, then the relay and the GUI the same way as for a target from the Home app or the schedule
   homekit_set_target_temp(new_temp);
+  thermostat_update(homekit_get_state());
+}
 
-  // Update GUI
-  gui_set_target_temp(new_temp);
+// Called on the network stack's task, so the event loop does the work
+static void on_time_synced(void) {
+  eventloop_dispatch(HOMEKIT_THERMOSTAT_TIME_SYNCED);
 }
 
-void on_eventloop_evt(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
+void on_eventloop_evt(const Event *event) {
   const char *tag = "EVENT";
-  switch (event_id) {
+  switch (event->id) {
     case HOMEKIT_THERMOSTAT_WIFI_REQUEST_PROVISIONING:
       // Init the provisioning and display the QR code
       ESP_LOGI(tag, "Received WiFi provisioning request.");
@@ -106,40 +167,45 @@ void on_eventloop_evt(void *arg, esp_event_base_t event_base, int32_t event_id,
       break;
     case HOMEKIT_THERMOSTAT_WIFI_CONNECTED:
       ESP_LOGI(tag, "WiFi connected.");
-      // Fetch the current time from the internet
-      datetime_init();
+      failed_wifi_attempts = 0;
+
+      // Everything kept running while the connection was down, the HomeKit server and SNTP just pick it up again
+      if (network_started) {
+        break;
+      }
+      network_started = true;
+
+      // Keep the time synced from now on, the clock was already restored at the boot if it could be
+      datetime_sync(on_time_synced);
+
+      // The radio is up now, so the hardware RNG has entropy to seed the shared DRBG with
+      rng_init();
 
       // Start the Homekit server
-      homekit_init(on_homekit_update);
+      homekit_init(on_homekit_update, on_schedule_switch);
 
-      eventloop_dispatch(HOMEKIT_THERMOSTAT_INIT_DONE, NULL, 0);
+      // Right after the provisioning, the main screen only comes up now
+      if (!main_scr_shown) {
+        eventloop_dispatch(HOMEKIT_THERMOSTAT_INIT_DONE);
+      } else if (!homekit_paired()) {
+        gui_homekit_scr();
+      }
+
+      // Start checking for updates, a new firmware is kept once the local checks pass, see ota_report_health()
+      ota_init();
       break;
     case HOMEKIT_THERMOSTAT_WIFI_DISCONNECTED:
-      ESP_LOGI(tag, "WiFi disconnected.");
-
-      if (!should_wifi_retry) {
-        break;
-      }
+      ESP_LOGI(tag, "WiFi disconnected (%d failed attempts).", failed_wifi_attempts + 1);
 
-      // If WiFi goes down, first show the loading screen so we can communicate with the user 
-      gui_loading_scr();
+      // Keep trying, the backoff grows up to WIFI_BACKOFF_MAX_MS, so a router that takes a while to come back after
+      // a power cut is picked up on its own
+      wifi_reconnect();
 
-      // If thermostat hasn't been initialized yet, it means it wasn't able to connect to the WiFi after starting
-      // In that case, show the Reconnect WiFi button after 5 failed attempts
-      if (!thermostat_initialized) {
-        if (++failed_wifi_attempts >= 5) {
-          gui_loading_show_reconnect_btn(restart_wifi_prov);
-          should_wifi_retry = false;
-        } {
-          // Try to reconnect
-          printf("reconnecting because not initialized and attempts >= 5 (%d)\n", failed_wifi_attempts);
-          wifi_reconnect();
-        }
-      } else {
-        // Otherwise if the thermostat has been already initialized,
-        // keep reconnecting forever (until the connection comes back up)
-        printf("reconnecting forever because initialized \n");
-        wifi_reconnect();
+      // Right after the provisioning, the loading screen is still up. Wrong credentials never connect, so after a few
+      // attempts it also offers to provision again, which the retries do not wait for.
+      if (!main_scr_shown && ++failed_wifi_attempts == WIFI_HINT_ATTEMPTS) {
+        gui_loading_scr();
+        gui_loading_show_reconnect_btn(restart_wifi_prov);
       }
       break;
     case HOMEKIT_THERMOSTAT_INIT_STARTED:
@@ -147,35 +213,55 @@ void on_eventloop_evt(void *arg, esp_event_base_t event_base, int32_t event_id,
       gui_loading_scr();
       break;
     case HOMEKIT_THERMOSTAT_LOG:
-      if (event_data != NULL) {
-        gui_loading_add_log((char *)event_data);
-      }
+      gui_loading_add_log(event->data.log);
       break;
     case HOMEKIT_THERMOSTAT_INIT_DONE:
       ESP_LOGI(tag, "Homekit thermostat is ready.");
+      main_scr_shown = true;
       gui_main_scr();
 
-      // Start the temperature check task
-      xTaskCreate(task_temperature, "TempTask", configMINIMAL_STACK_SIZE * 3, NULL, 5, NULL);
+      // The clock has been running since the boot, now it has a screen to show on
+      clock_show();
 
-      // Start the time update task
-      xTaskCreate(task_time, "TimeTask", configMINIMAL_STACK_SIZE * 3, NULL, 5, NULL);
-
-      // Set initial data in Homekit
-      TempHumidity temp_humid = sht40_measure_temp();
-      homekit_set_curr_temp(temp_humid);
+      // Set initial data in Homekit, the temperature task measures the temperature right away
       homekit_set_thermostat_status(THERMOSTAT_HEAT);
 
       // Show initial data in GUI
       HomekitState state = homekit_get_state();
-      gui_set_curr_temp(temp_humid.temperature);
       gui_set_target_temp(state.target_temp);
       gui_set_thermostat_status(state.current_temp >= state.target_temp ? _THERMOSTAT_IDLE : THERMOSTAT_HEAT);
 
       // Register temperature buttons handler
       gui_on_btn_pressed_cb(on_temp_btn);
 
-      thermostat_initialized = true;
+      // The schedule is turned on and off with a long press on its line or with the switch in the Home app
+      gui_on_schedule_pressed_cb(on_schedule_pressed);
+      homekit_set_schedule_enabled(schedule_status().enabled);
+
+      // The schedule has been running since the boot, show where it is
+      show_schedule();
+
+      // Until a controller has paired, show the HomeKit setup code on top of the main screen
+      if (network_started && !homekit_paired()) {
+        gui_homekit_scr();
+      }
+
+      ota_report_health(OTA_HEALTH_GUI);
+      break;
+    case HOMEKIT_THERMOSTAT_SCHEDULE_DUE:
+      schedule_due();
+      show_schedule();
+      break;
+    case HOMEKIT_THERMOSTAT_TIME_SYNCED:
+      // The clock may have jumped, so the schedule looks up its next change again and the minute is timed anew
+      schedule_due();
+      show_schedule();
+      clock_update();
+      break;
+    case HOMEKIT_THERMOSTAT_CLOCK_TICK:
+      clock_update();
+      break;
+    case HOMEKIT_THERMOSTAT_EVENT_COUNT:
       break;
   }
 }
@@ -189,11 +275,15 @@ void app_main() {
     ret = nvs_flash_init();
   }
   ESP_ERROR_CHECK(ret);
+  datetime_init();
+  history_init();
+  schedule_init();
 
   // Init peripherals
   led_disable();
-  sht40_init();
+  sensors_init();
   relay_init();
+  controller_init(CONFIG_TEMPERATURE_POLL_PERIOD / 1000.0f);
 
   // Init display
   lcd_init();
@@ -205,13 +295,22 @@ void app_main() {
   // Init Homekit Thermostat event loop
   eventloop_init(on_eventloop_evt);
 
+  // With the time restored from the RTC, the schedule and the clock run from here on, without waiting for the
+  // network, otherwise they wait for the first NTP sync
+  schedule_start(on_schedule_change);
+  clock_start();
+
+  // The heating does not wait for the network, it may take a while to come back after a power cut
+  xTaskCreate(task_temperature, "TempTask", configMINIMAL_STACK_SIZE * 3, NULL, 5, NULL);
+
   // Init WiFi
   wifi_init();
 
   if (!wifi_is_provisioned()) {
-    eventloop_dispatch(HOMEKIT_THERMOSTAT_WIFI_REQUEST_PROVISIONING, NULL, 0);
+    eventloop_dispatch(HOMEKIT_THERMOSTAT_WIFI_REQUEST_PROVISIONING);
   } else {
-    eventloop_dispatch(HOMEKIT_THERMOSTAT_INIT_STARTED, NULL, 0);
+    // Neither does the main screen. It is shown on the event loop, which handles it before any WiFi event.
+    eventloop_dispatch(HOMEKIT_THERMOSTAT_INIT_DONE);
     wifi_connect();
   }
 }
@@ -0,0 +1,335 @@
+#include "ota.h"
+
+#include <esp_err.h>
+#include <esp_http_client.h>
+#include <esp_log.h>
+#include <esp_ota_ops.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <inttypes.h>
+#include <nvs.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/ed25519.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+
+static const char *TAG = "OTA";
+
+#define OTA_NVS_NAMESPACE "ota"
+#define OTA_NVS_KEY_SIG "sig"
+
+// <CONFIG_OTA_URL>.sig: the security version of the image, then the Ed25519 signature of the SHA-256 digest of the
+// image followed by that version (little endian, see `make ota/sign`)
+typedef struct {
+  uint8_t security_version[4];
+  uint8_t signature[ED25519_SIG_SIZE];
+} OtaSignature;
+
+static bool ota_started = false;
+static atomic_uint health = 0;
+
+// Flash sector staging buffer, the image is never buffered as a whole
+static uint8_t ota_chunk[OTA_CHUNK_SIZE];
+
+static int parse_hex(const char *hex, uint8_t *out, size_t out_len) {
+  if (strlen(hex) != out_len * 2) {
+    return -1;
+  }
+
+  for (size_t i = 0; i < out_len; i++) {
+    unsigned int byte;
+    if (sscanf(hex + 2 * i, "%2x", &byte) != 1) {
+      return -1;
+    }
+    out[i] = (uint8_t)byte;
+  }
+
+  return 0;
+}
+
+static esp_http_client_handle_t http_open(const char *url, int64_t *content_length) {
+  esp_http_client_config_t config = {
+      .url = url,
+      .timeout_ms = OTA_HTTP_TIMEOUT_MS,
+      .keep_alive_enable = true,
+  };
+
+  esp_http_client_handle_t client = esp_http_client_init(&config);
+  if (client == NULL) {
+    return NULL;
+  }
+
+  if (esp_http_client_open(client, 0) != ESP_OK) {
+    ESP_LOGW(TAG, "Failed to connect to %s", url);
+    esp_http_client_cleanup(client);
+    return NULL;
+  }
+
+  *content_length = esp_http_client_fetch_headers(client);
+  int status = esp_http_client_get_status_code(client);
+  if (status != 200) {
+    ESP_LOGW(TAG, "Request to %s failed with HTTP %d", url, status);
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+    return NULL;
+  }
+
+  return client;
+}
+
+static void http_close(esp_http_client_handle_t client) {
+  esp_http_client_close(client);
+  esp_http_client_cleanup(client);
+}
+
+// Reads until `buff` is full or the body ends, so flash is written in whole sectors
+static int http_read_full(esp_http_client_handle_t client, uint8_t *buff, size_t buff_size) {
+  size_t total = 0;
+  while (total < buff_size) {
+    int len = esp_http_client_read(client, (char *)buff + total, buff_size - total);
+    if (len < 0) {
+      return -1;
+    }
+    if (len == 0) {
+      break;
+    }
+    total += len;
+  }
+  return total;
+}
+
+static uint32_t security_version(const OtaSignature *sig) {
+  const uint8_t *v = sig->security_version;
+  return v[0] | v[1] << 8 | v[2] << 16 | (uint32_t)v[3] << 24;
+}
+
+// The signature file sits next to the image: <CONFIG_OTA_URL>.sig
+static esp_err_t fetch_signature(OtaSignature *sig) {
+  char url[sizeof(CONFIG_OTA_URL) + 4];
+  snprintf(url, sizeof(url), "%s.sig", CONFIG_OTA_URL);
+
+  int64_t content_length = 0;
+  esp_http_client_handle_t client = http_open(url, &content_length);
+  if (client == NULL) {
+    return ESP_FAIL;
+  }
+
+  int len = http_read_full(client, (uint8_t *)sig, sizeof(*sig));
+  http_close(client);
+
+  return len == (int)sizeof(*sig) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+// Ed25519 is deterministic, so an unchanged image comes with an unchanged signature
+static bool is_installed(const OtaSignature *sig) {
+  nvs_handle_t nvs;
+  if (nvs_open(OTA_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+    return false;
+  }
+
+  OtaSignature installed;
+  size_t len = sizeof(installed);
+  esp_err_t err = nvs_get_blob(nvs, OTA_NVS_KEY_SIG, &installed, &len);
+  nvs_close(nvs);
+
+  return err == ESP_OK && len == sizeof(installed) && memcmp(&installed, sig, sizeof(installed)) == 0;
+}
+
+static void save_installed(const OtaSignature *sig) {
+  nvs_handle_t nvs;
+  if (nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+    return;
+  }
+
+  nvs_set_blob(nvs, OTA_NVS_KEY_SIG, sig, sizeof(*sig));
+  nvs_commit(nvs);
+  nvs_close(nvs);
+}
+
+// The version is signed along with the digest, so an older release cannot be passed off with a newer version
+static bool verify_signature(const uint8_t digest[WC_SHA256_DIGEST_SIZE], const OtaSignature *sig) {
+  uint8_t public_key[ED25519_PUB_KEY_SIZE];
+  if (parse_hex(CONFIG_OTA_SIGNING_PUBLIC_KEY, public_key, sizeof(public_key)) != 0) {
+    ESP_LOGE(TAG, "Invalid signing public key in the configuration");
+    return false;
+  }
+
+  uint8_t msg[WC_SHA256_DIGEST_SIZE + sizeof(sig->security_version)];
+  memcpy(msg, digest, WC_SHA256_DIGEST_SIZE);
+  memcpy(msg + WC_SHA256_DIGEST_SIZE, sig->security_version, sizeof(sig->security_version));
+
+  ed25519_key key;
+  int verified = 0;
+  if (wc_ed25519_init(&key) != 0) {
+    return false;
+  }
+  if (wc_ed25519_import_public(public_key, sizeof(public_key), &key) == 0) {
+    wc_ed25519_verify_msg(sig->signature, ED25519_SIG_SIZE, msg, sizeof(msg), &verified, &key);
+  }
+  wc_ed25519_free(&key);
+
+  return verified == 1;
+}
+
+// Streams the image into the next OTA slot sector by sector while hashing it.
+// The signature covers the SHA-256 digest of the image, so it is checked once the last sector is written
+// and the slot is only made bootable if it matches.
+static esp_err_t download_and_install(const OtaSignature *sig) {
+  const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+  if (partition == NULL) {
+    ESP_LOGE(TAG, "No OTA partition to update");
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  int64_t content_length = 0;
+  esp_http_client_handle_t client = http_open(CONFIG_OTA_URL, &content_length);
+  if (client == NULL) {
+    return ESP_FAIL;
+  }
+
+  if (content_length > (int64_t)partition->size) {
+    ESP_LOGE(TAG, "Image (%lld bytes) does not fit into %s", content_length, partition->label);
+    http_close(client);
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  ESP_LOGI(TAG, "Writing update into %s at 0x%" PRIx32, partition->label, partition->address);
+
+  // Sequential writes erase each sector right before it is written instead of the whole slot upfront
+  esp_ota_handle_t ota_handle;
+  esp_err_t err = esp_ota_begin(partition, OTA_WITH_SEQUENTIAL_WRITES, &ota_handle);
+  if (err != ESP_OK) {
+    http_close(client);
+    return err;
+  }
+
+  wc_Sha256 sha;
+  wc_InitSha256(&sha);
+
+  int64_t total = 0;
+  int64_t started = esp_timer_get_time();
+  while (1) {
+    int len = http_read_full(client, ota_chunk, sizeof(ota_chunk));
+    if (len < 0) {
+      ESP_LOGE(TAG, "Download failed after %lld bytes", total);
+      err = ESP_FAIL;
+      break;
+    }
+    if (len == 0) {
+      break;
+    }
+
+    total += len;
+    if (total > (int64_t)partition->size) {
+      ESP_LOGE(TAG, "Image is larger than %s", partition->label);
+      err = ESP_ERR_INVALID_SIZE;
+      break;
+    }
+
+    wc_Sha256Update(&sha, ota_chunk, len);
+    err = esp_ota_write(ota_handle, ota_chunk, len);
+    if (err != ESP_OK) {
+      break;
+    }
+
+    // Let the other tasks run between sectors, flash writes stall the single core
+    vTaskDelay(1);
+  }
+  http_close(client);
+
+  uint8_t digest[WC_SHA256_DIGEST_SIZE];
+  wc_Sha256Final(&sha, digest);
+  wc_Sha256Free(&sha);
+
+  if (err == ESP_OK && !verify_signature(digest, sig)) {
+    ESP_LOGE(TAG, "Signature verification failed, discarding the update");
+    err = ESP_ERR_INVALID_CRC;
+  }
+
+  // Only now is the version known to be the one that was signed with the image
+  if (err == ESP_OK && security_version(sig) < CONFIG_OTA_SECURITY_VERSION) {
+    ESP_LOGE(TAG, "Security version %" PRIu32 " is older than %d, discarding the update", security_version(sig),
+             CONFIG_OTA_SECURITY_VERSION);
+    err = ESP_ERR_INVALID_VERSION;
+  }
+
+  if (err != ESP_OK) {
+    esp_ota_abort(ota_handle);
+    return err;
+  }
+
+  // esp_ota_end() additionally validates the app image structure
+  err = esp_ota_end(ota_handle);
+  if (err == ESP_OK) {
+    err = esp_ota_set_boot_partition(partition);
+  }
+  if (err == ESP_OK) {
+    ESP_LOGI(TAG, "Installed %lld bytes in %lld ms", total, (esp_timer_get_time() - started) / 1000);
+  }
+
+  return err;
+}
+
+// A correctly signed image of an older release, with known flaws, is not installed again. The version is only
+// trusted once the signature has been checked, this just saves the download of an image that would be refused.
+static bool is_downgrade(const OtaSignature *sig) {
+  if (security_version(sig) >= CONFIG_OTA_SECURITY_VERSION) {
+    return false;
+  }
+
+  ESP_LOGW(TAG, "Firmware at %s has security version %" PRIu32 ", older than %d, ignoring it", CONFIG_OTA_URL,
+           security_version(sig), CONFIG_OTA_SECURITY_VERSION);
+  return true;
+}
+
+static void task_ota(void *pvParameters) {
+  OtaSignature sig;
+
+  while (1) {
+    if (fetch_signature(&sig) == ESP_OK && !is_installed(&sig) && !is_downgrade(&sig)) {
+      ESP_LOGI(TAG, "New firmware available at %s (security version %" PRIu32 ")", CONFIG_OTA_URL,
+               security_version(&sig));
+
+      if (download_and_install(&sig) == ESP_OK) {
+        save_installed(&sig);
+        ESP_LOGI(TAG, "Restarting into the new firmware");
+        esp_restart();
+      }
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_OTA_CHECK_INTERVAL * 1000));
+  }
+}
+
+void ota_init(void) {
+  if (ota_started || strlen(CONFIG_OTA_URL) == 0) {
+    return;
+  }
+
+  ESP_LOGI(TAG, "Checking for updates at %s every %d s", CONFIG_OTA_URL, CONFIG_OTA_CHECK_INTERVAL);
+  xTaskCreate(task_ota, "OtaTask", OTA_TASK_STACK_SIZE, NULL, OTA_TASK_PRIORITY, NULL);
+  ota_started = true;
+}
+
+// A freshly installed image boots in the pending state, if it doesn't pass the checks
+// (crash, watchdog, reset before) the bootloader rolls back to the previous slot
+static void mark_valid(void) {
+  esp_ota_img_states_t state;
+  const esp_partition_t *running = esp_ota_get_running_partition();
+
+  if (esp_ota_get_state_partition(running, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY) {
+    ESP_LOGI(TAG, "New firmware is working, cancelling rollback");
+    esp_ota_mark_app_valid_cancel_rollback();
+  }
+}
+
+void ota_report_health(OtaHealth passed) {
+  unsigned before = atomic_fetch_or(&health, passed);
+  if (before != OTA_HEALTH_ALL && (before | passed) == OTA_HEALTH_ALL) {
+    mark_valid();
+  }
+}
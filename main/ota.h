@@ -0,0 +1,21 @@
+#include <stdbool.h>
+
+#define OTA_CHUNK_SIZE 4096                // One flash sector, the most the update keeps in RAM
+#define OTA_TASK_PRIORITY 1                // Below the LVGL and temperature tasks
+#define OTA_TASK_STACK_SIZE (6 * 1024)
+#define OTA_HTTP_TIMEOUT_MS 10000
+
+// The local checks a freshly installed firmware has to pass before it is kept
+typedef enum {
+  OTA_HEALTH_SENSORS = 1 << 0,             // A temperature was read
+  OTA_HEALTH_CONTROL = 1 << 1,             // The temperature task decided on the relay
+  OTA_HEALTH_GUI = 1 << 2,                 // The main screen is up
+} OtaHealth;
+
+#define OTA_HEALTH_ALL (OTA_HEALTH_SENSORS | OTA_HEALTH_CONTROL | OTA_HEALTH_GUI)
+
+void ota_init(void);
+
+// Reports a passed check, from any task. Once all have passed, the firmware is kept (rollback cancelled), whether
+// the WiFi is up or not.
+void ota_report_health(OtaHealth passed);
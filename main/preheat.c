@@ -0,0 +1,258 @@
+#include "preheat.h"
+
+#include <math.h>
+#include <string.h>
+
+// duration = d + rise * (s0 + s1 * (indoor - 20) + s2 * (outdoor - 5)), where d is the dead time and s is
+// the inverse of the warm-up rate (in s/°C). It is linear in the parameters, so each cycle only adds to the
+// sums of the normal equations. The fit is pulled towards a 10 minute dead time and 1 °C/h with the weight of
+// a single cycle, so a few similar cycles, or no outdoor temperature at all, do not leave it undetermined.
+#define PARAMS 4
+#define INDOOR_REF 20.0f
+#define OUTDOOR_REF 5.0f
+#define PRIOR_DEAD_TIME_S 600.0f
+#define PRIOR_SLOWNESS 3600.0f        // 1 °C/h
+#define PRIOR_WEIGHT 1.0f
+#define MIN_SLOWNESS 360.0f           // 10 °C/h, faster than any room heats up
+#define ERROR_SMOOTHING 0.2f
+#define MAX_SAMPLE_GAP_S 600          // A cycle with a longer gap between samples is dropped
+#define ARRIVAL_TIMEOUT_S (3 * 3600)  // A preheat not reached by then is not scored
+
+typedef enum {
+  CYCLE_IDLE,
+  CYCLE_HEATING,
+  CYCLE_COASTING,                     // The relay is off, the radiators still heat
+} CycleState;
+
+static PreheatStats stats;
+static float params[PARAMS];
+
+static CycleState cycle = CYCLE_IDLE;
+static time_t cycle_start;
+static float cycle_start_temp;
+static time_t cycle_peak_time;
+static float cycle_peak_temp;
+static float cycle_outdoor_sum;
+static int cycle_outdoor_count;
+
+static bool have_last = false;
+static time_t last_time;
+static float last_temp;
+
+static bool tracking = false;
+static time_t tracking_due;
+static float tracking_target;
+static float arrival_error_s;
+
+static void features(float rise, float indoor, float outdoor, float *x) {
+  x[0] = 1;
+  x[1] = rise;
+  x[2] = rise * (indoor - INDOOR_REF);
+  x[3] = isnan(outdoor) ? 0 : rise * (outdoor - OUTDOOR_REF);
+}
+
+// Solves the regularised normal equations by Gaussian elimination, 4 unknowns
+static void solve(void) {
+  const float prior[PARAMS] = {PRIOR_DEAD_TIME_S, PRIOR_SLOWNESS, 0, 0};
+  double a[PARAMS][PARAMS + 1];
+  for (int i = 0; i < PARAMS; i++) {
+    for (int j = 0; j < PARAMS; j++) {
+      a[i][j] = stats.xx[i][j] + (i == j ? PRIOR_WEIGHT : 0);
+    }
+    a[i][PARAMS] = stats.xy[i] + PRIOR_WEIGHT * prior[i];
+  }
+
+  for (int col = 0; col < PARAMS; col++) {
+    int pivot = col;
+    for (int row = col + 1; row < PARAMS; row++) {
+      if (fabs(a[row][col]) > fabs(a[pivot][col])) {
+        pivot = row;
+      }
+    }
+    for (int j = 0; j <= PARAMS; j++) {
+      double t = a[col][j];
+      a[col][j] = a[pivot][j];
+      a[pivot][j] = t;
+    }
+    for (int row = col + 1; row < PARAMS; row++) {
+      double f = a[row][col] / a[col][col];
+      for (int j = col; j <= PARAMS; j++) {
+        a[row][j] -= f * a[col][j];
+      }
+    }
+  }
+  for (int i = PARAMS - 1; i >= 0; i--) {
+    double v = a[i][PARAMS];
+    for (int j = i + 1; j < PARAMS; j++) {
+      v -= a[i][j] * params[j];
+    }
+    params[i] = v / a[i][i];
+  }
+}
+
+static float predict(const float *x) {
+  float duration = 0;
+  for (int i = 0; i < PARAMS; i++) {
+    duration += params[i] * x[i];
+  }
+  return duration;
+}
+
+static bool learn_cycle(void) {
+  float rise = cycle_peak_temp - cycle_start_temp;
+  if (rise < PREHEAT_MIN_RISE) {
+    return false;
+  }
+
+  float outdoor = cycle_outdoor_count > 0 ? cycle_outdoor_sum / cycle_outdoor_count : NAN;
+  float x[PARAMS];
+  features(rise, (cycle_start_temp + cycle_peak_temp) / 2, outdoor, x);
+  float duration = cycle_peak_time - cycle_start;
+
+  // Score the model on the cycle before it learns from it
+  if (stats.cycles >= PREHEAT_MIN_CYCLES) {
+    float error = duration - predict(x);
+    if (stats.cycles == PREHEAT_MIN_CYCLES) {
+      stats.error2 = error * error;
+    } else {
+      stats.error2 += (error * error - stats.error2) * ERROR_SMOOTHING;
+    }
+  }
+
+  for (int i = 0; i < PARAMS; i++) {
+    for (int j = 0; j < PARAMS; j++) {
+      stats.xx[i][j] = stats.xx[i][j] * PREHEAT_FORGETTING + x[i] * x[j];
+    }
+    stats.xy[i] = stats.xy[i] * PREHEAT_FORGETTING + x[i] * duration;
+  }
+  stats.cycles++;
+  solve();
+  return true;
+}
+
+static void start_cycle(void) {
+  cycle = CYCLE_HEATING;
+  cycle_start = last_time;
+  cycle_start_temp = last_temp;
+  cycle_peak_time = last_time;
+  cycle_peak_temp = last_temp;
+  cycle_outdoor_sum = 0;
+  cycle_outdoor_count = 0;
+}
+
+void preheat_init(const PreheatStats *saved) {
+  if (saved != NULL) {
+    stats = *saved;
+  } else {
+    memset(&stats, 0, sizeof(stats));
+  }
+  solve();
+  cycle = CYCLE_IDLE;
+  have_last = false;
+  tracking = false;
+}
+
+PreheatEvent preheat_sample(time_t now, float temp, float target, bool heating, float outdoor) {
+  PreheatEvent event = PREHEAT_NONE;
+
+  if (tracking) {
+    if (temp >= tracking_target - PREHEAT_ARRIVAL_BAND) {
+      tracking = false;
+      arrival_error_s = now - tracking_due;
+      float error2 = arrival_error_s * arrival_error_s;
+      stats.arrival2 = stats.arrivals == 0 ? error2 : stats.arrival2 + (error2 - stats.arrival2) * ERROR_SMOOTHING;
+      stats.arrivals++;
+      event = PREHEAT_ARRIVAL;
+    } else if (now > tracking_due + ARRIVAL_TIMEOUT_S) {
+      tracking = false;
+    }
+  }
+
+  // A clock that was set in between makes a gap too
+  if (!have_last || now < last_time || now - last_time > MAX_SAMPLE_GAP_S) {
+    cycle = CYCLE_IDLE;
+  } else {
+    if (cycle != CYCLE_IDLE) {
+      if (temp > cycle_peak_temp) {
+        cycle_peak_temp = temp;
+        cycle_peak_time = now;
+      }
+      if (!isnan(outdoor)) {
+        cycle_outdoor_sum += outdoor;
+        cycle_outdoor_count++;
+      }
+    }
+
+    // A cycle ends when the room got to the target, or else at the peak once the heating is off
+    bool arrived = temp >= target - PREHEAT_ARRIVAL_BAND;
+    if (cycle != CYCLE_IDLE && arrived) {
+      cycle_peak_temp = temp;
+      cycle_peak_time = now;
+    }
+    if (cycle == CYCLE_HEATING && !heating && !arrived) {
+      cycle = CYCLE_COASTING;
+    } else if (cycle != CYCLE_IDLE &&
+               (arrived || (cycle == CYCLE_COASTING && (heating || now - cycle_peak_time >= PREHEAT_PEAK_WAIT_S)))) {
+      if (learn_cycle() && event == PREHEAT_NONE) {
+        event = PREHEAT_CYCLE;
+      }
+      cycle = CYCLE_IDLE;
+    }
+
+    // The relay state is the one held since the last sample, so the cycle started at the last sample
+    if (cycle == CYCLE_IDLE && heating && !arrived) {
+      start_cycle();
+      if (temp > cycle_peak_temp) {
+        cycle_peak_temp = temp;
+        cycle_peak_time = now;
+      }
+    }
+  }
+
+  have_last = true;
+  last_time = now;
+  last_temp = temp;
+  return event;
+}
+
+float preheat_lead(float temp, float target, float outdoor, float max_lead_s) {
+  if (stats.cycles < PREHEAT_MIN_CYCLES || target <= temp) {
+    return 0;
+  }
+
+  // Cycles are learned up to where they count as arrived
+  target -= PREHEAT_ARRIVAL_BAND;
+  if (target <= temp) {
+    return 0;
+  }
+  float x[PARAMS];
+  features(target - temp, (temp + target) / 2, outdoor, x);
+
+  // A fit that went astray must not keep the heating off, nor on for hours
+  float slowness = fmaxf(predict(x) - params[0], MIN_SLOWNESS * x[1]);
+  float lead = fmaxf(params[0], 0) + slowness;
+  return fminf(lead, max_lead_s);
+}
+
+void preheat_started(time_t due, float target) {
+  tracking = true;
+  tracking_due = due;
+  tracking_target = target;
+}
+
+PreheatStatus preheat_status(void) {
+  PreheatStatus status = {
+    .cycles = stats.cycles,
+    .dead_time_s = params[0],
+    .rate = params[1] > 0 ? 3600 / params[1] : 0,
+    .error_s = sqrtf(stats.error2),
+    .arrivals = stats.arrivals,
+    .arrival_error_s = arrival_error_s,
+    .arrival_rms_s = sqrtf(stats.arrival2),
+  };
+  return status;
+}
+
+const PreheatStats *preheat_stats(void) {
+  return &stats;
+}
@@ -0,0 +1,64 @@
+#include <stdbool.h>
+#include <time.h>
+
+#ifndef PREHEAT_H
+#define PREHEAT_H
+
+// Optimum start. Learns how long the heating takes to warm the room up, so a scheduled target can be reached
+// on time instead of only starting to heat at the change.
+// Every heating cycle, from the relay turning on until the room gets to the target (or the temperature peaks short
+// of it), is one observation of
+//   duration = dead time + rise / rate(indoor, outdoor)
+// and goes into the sums of a least squares fit right away, so nothing is kept or scanned again.
+// Time only comes in with the samples, so tools/preheat_sim can run weeks of mornings in a second.
+
+#define PREHEAT_MIN_CYCLES 3          // Cycles to learn from before a lead is given
+#define PREHEAT_MIN_RISE 0.3f         // Smaller rises are mostly noise and dead time (in °C)
+#define PREHEAT_PEAK_WAIT_S 900       // The peak is taken once the temperature has not risen for this long
+#define PREHEAT_FORGETTING 0.9f       // Weight left to a cycle after each newer one, the warm-up follows the weather
+#define PREHEAT_ARRIVAL_BAND 0.1f     // The target counts as reached this close (in °C)
+
+typedef enum {
+  PREHEAT_NONE,
+  PREHEAT_CYCLE,                      // A heating cycle was learned
+  PREHEAT_ARRIVAL,                    // A preheat reached its target, see `arrival_error_s`
+} PreheatEvent;
+
+typedef struct {
+  int cycles;                         // Heating cycles learned from
+  float dead_time_s;
+  float rate;                         // Warm-up rate at 20 °C indoors and 5 °C outdoors (in °C/h)
+  float error_s;                      // RMS error of the predicted duration of the cycles so far, before each was learned
+  int arrivals;
+  float arrival_error_s;              // Last preheat, positive when the target was reached late
+  float arrival_rms_s;
+} PreheatStatus;
+
+// The sums of the fit, small enough to be saved as they are
+typedef struct {
+  float xx[4][4];
+  float xy[4];
+  float error2;                       // Smoothed squared prediction error
+  float arrival2;
+  int cycles;
+  int arrivals;
+} PreheatStats;
+
+// Starts from `stats` saved earlier, or from nothing when NULL
+void preheat_init(const PreheatStats *stats);
+
+// Follows the heating with every temperature sample and the target in effect. `outdoor` is NAN when unknown.
+PreheatEvent preheat_sample(time_t now, float temp, float target, bool heating, float outdoor);
+
+// How long before a change the heating has to start to warm the room from `temp` to `target` (in seconds),
+// 0 until PREHEAT_MIN_CYCLES cycles have been learned
+float preheat_lead(float temp, float target, float outdoor, float max_lead_s);
+
+// A preheat for `target` started now, to be reached at `due`. The arrival is then checked against it.
+void preheat_started(time_t due, float target);
+
+PreheatStatus preheat_status(void);
+
+const PreheatStats *preheat_stats(void);
+
+#endif
@@ -0,0 +1,266 @@
+#include "rng.h"
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_random.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/random.h>
+
+static const char *TAG = "RNG";
+
+#ifdef CONFIG_HOMEKIT_RNG_SHARED
+// Every SRP private key, Ed25519 and X25519 key and HAP nonce used to come from a WC_RNG created just for it,
+// and wc_InitRng() seeds, instantiates and health tests a Hash_DRBG each time. The library's RNG calls are
+// wrapped at link time (see CMakeLists.txt): wc_InitRng() only marks the caller's WC_RNG as borrowed, and its
+// output comes from one long-lived DRBG, refilled into a small buffer per task so a handful of requests
+// cost one DRBG generate call. The DRBG is reseeded from the hardware TRNG in the background.
+#define RNG_RESEED_INTERVAL_US (CONFIG_HOMEKIT_RNG_RESEED_INTERVAL * 1000000LL)
+
+typedef struct {
+  TaskHandle_t owner;
+  TickType_t last_used;
+  size_t avail;  // Unused bytes at the end of `buf`
+  uint8_t buf[RNG_POOL_BUFFER_SIZE];
+} rng_pool_t;
+
+static WC_RNG rng_shared;
+static bool rng_ready = false;
+static SemaphoreHandle_t rng_mux = NULL;
+static rng_pool_t rng_pools[RNG_POOL_SLOTS];
+static atomic_bool rng_reseed_pending = false;  // The timer found the DRBG busy, the next request reseeds it
+
+// Borrowed WC_RNGs point their heap here. Their DRBG stays uninitialized, so a library function that
+// is not wrapped fails on them instead of producing output.
+static const char rng_borrowed = 0;
+
+int __real_wc_InitRng(WC_RNG *rng);
+int __real_wc_InitRng_ex(WC_RNG *rng, void *heap, int devId);
+int __real_wc_RNG_GenerateBlock(WC_RNG *rng, byte *output, word32 sz);
+int __real_wc_RNG_GenerateByte(WC_RNG *rng, byte *b);
+int __real_wc_FreeRng(WC_RNG *rng);
+
+// Unlike memset(), the compiler may not drop this for memory that is not read afterwards
+static void rng_zero(void *mem, size_t len) {
+  volatile uint8_t *p = mem;
+  while (len--) {
+    *p++ = 0;
+  }
+}
+
+static bool rng_is_borrowed(const WC_RNG *rng) {
+  return rng != NULL && rng->heap == &rng_borrowed;
+}
+
+// Returns the calling task's pool, taking over the least recently used one if the task has none.
+// Must be called with `rng_mux` held.
+static rng_pool_t *rng_pool_get(void) {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  rng_pool_t *lru = &rng_pools[0];
+  for (int i = 0; i < RNG_POOL_SLOTS; i++) {
+    if (rng_pools[i].owner == task) {
+      return &rng_pools[i];
+    }
+    if (rng_pools[i].owner == NULL || rng_pools[i].last_used < lru->last_used) {
+      lru = &rng_pools[i];
+    }
+  }
+
+  // Another task's bytes must never be handed out, even though they were never used
+  rng_zero(lru, sizeof(rng_pool_t));
+  lru->owner = task;
+  return lru;
+}
+
+static int rng_pool_read(rng_pool_t *pool, uint8_t *out, size_t len) {
+  while (len > 0) {
+    if (pool->avail == 0) {
+      int r = __real_wc_RNG_GenerateBlock(&rng_shared, pool->buf, sizeof(pool->buf));
+      if (r) {
+        return r;
+      }
+      pool->avail = sizeof(pool->buf);
+    }
+
+    size_t n = len < pool->avail ? len : pool->avail;
+    uint8_t *src = pool->buf + sizeof(pool->buf) - pool->avail;
+    memcpy(out, src, n);
+    rng_zero(src, n);
+    pool->avail -= n;
+    out += n;
+    len -= n;
+  }
+  return 0;
+}
+
+// Must be called with `rng_mux` held
+static void rng_reseed_locked(void) {
+  uint8_t entropy[RNG_RESEED_ENTROPY_SIZE];
+  esp_fill_random(entropy, sizeof(entropy));
+
+  int r = wc_RNG_DRBG_Reseed(&rng_shared, entropy, sizeof(entropy));
+  // Drop the output buffered before the reseed, so it only lives for one interval
+  rng_zero(rng_pools, sizeof(rng_pools));
+
+  rng_zero(entropy, sizeof(entropy));
+  if (r) {
+    ESP_LOGW(TAG, "Failed to reseed the DRBG (%d)", r);
+  }
+}
+
+// Runs on the esp_timer task, which must not block behind a pairing that holds the DRBG. If it is
+// busy, the next request reseeds it instead.
+static void rng_reseed(void *arg) {
+  (void)arg;
+
+  if (xSemaphoreTake(rng_mux, 0) != pdTRUE) {
+    atomic_store(&rng_reseed_pending, true);
+    return;
+  }
+  rng_reseed_locked();
+  xSemaphoreGive(rng_mux);
+}
+
+static int rng_generate(uint8_t *out, size_t len) {
+  if (xSemaphoreTake(rng_mux, portMAX_DELAY) != pdTRUE) {
+    return RNG_FAILURE_E;
+  }
+
+  if (atomic_exchange(&rng_reseed_pending, false)) {
+    rng_reseed_locked();
+  }
+
+  int r;
+  if (len > RNG_POOL_BUFFER_SIZE) {
+    // Large requests (e.g. the SRP salt when no setup record exists) would just flush the buffer
+    r = __real_wc_RNG_GenerateBlock(&rng_shared, out, len);
+  } else {
+    rng_pool_t *pool = rng_pool_get();
+    pool->last_used = xTaskGetTickCount();
+    r = rng_pool_read(pool, out, len);
+  }
+
+  xSemaphoreGive(rng_mux);
+  return r;
+}
+
+static void rng_borrow(WC_RNG *rng) {
+  memset(rng, 0, sizeof(WC_RNG));
+  rng->heap = (void *)&rng_borrowed;
+}
+
+int __wrap_wc_InitRng(WC_RNG *rng) {
+  if (rng == NULL || !rng_ready) {
+    return __real_wc_InitRng(rng);
+  }
+  rng_borrow(rng);
+  return 0;
+}
+
+int __wrap_wc_InitRng_ex(WC_RNG *rng, void *heap, int devId) {
+  if (rng == NULL || !rng_ready) {
+    return __real_wc_InitRng_ex(rng, heap, devId);
+  }
+  rng_borrow(rng);
+  return 0;
+}
+
+int __wrap_wc_RNG_GenerateBlock(WC_RNG *rng, byte *output, word32 sz) {
+  if (!rng_is_borrowed(rng)) {
+    return __real_wc_RNG_GenerateBlock(rng, output, sz);
+  }
+  if (output == NULL) {
+    return BAD_FUNC_ARG;
+  }
+  return rng_generate(output, sz);
+}
+
+int __wrap_wc_RNG_GenerateByte(WC_RNG *rng, byte *b) {
+  if (!rng_is_borrowed(rng)) {
+    return __real_wc_RNG_GenerateByte(rng, b);
+  }
+  if (b == NULL) {
+    return BAD_FUNC_ARG;
+  }
+  return rng_generate(b, 1);
+}
+
+int __wrap_wc_FreeRng(WC_RNG *rng) {
+  if (!rng_is_borrowed(rng)) {
+    return __real_wc_FreeRng(rng);
+  }
+  memset(rng, 0, sizeof(WC_RNG));
+  return 0;
+}
+
+// Logs what a 32-byte key costs with a DRBG of its own and with the shared one
+static void rng_report_latency(void) {
+  WC_RNG rng;
+  uint8_t key[32];
+
+  int64_t started = esp_timer_get_time();
+  int r = __real_wc_InitRng(&rng);
+  if (!r) {
+    r = __real_wc_RNG_GenerateBlock(&rng, key, sizeof(key));
+    __real_wc_FreeRng(&rng);
+  }
+  int64_t fresh = esp_timer_get_time() - started;
+
+  started = esp_timer_get_time();
+  if (!r) {
+    __wrap_wc_InitRng(&rng);
+    r = __wrap_wc_RNG_GenerateBlock(&rng, key, sizeof(key));
+    __wrap_wc_FreeRng(&rng);
+  }
+  int64_t borrowed = esp_timer_get_time() - started;
+
+  rng_zero(key, sizeof(key));
+  if (!r) {
+    ESP_LOGI(TAG, "32-byte key: %lld us with a fresh DRBG, %lld us with the shared one", fresh, borrowed);
+  }
+}
+
+static const esp_timer_create_args_t rng_reseed_timer_args = {
+  .callback = &rng_reseed,
+  .name = "rng_reseed"
+};
+static esp_timer_handle_t rng_reseed_timer = NULL;
+
+bool rng_init(void) {
+  if (rng_ready) {
+    return true;
+  }
+
+  rng_mux = xSemaphoreCreateMutex();
+  if (rng_mux == NULL) {
+    ESP_LOGE(TAG, "Failed to create the RNG mutex");
+    return false;
+  }
+
+  int r = __real_wc_InitRng(&rng_shared);
+  if (r) {
+    ESP_LOGE(TAG, "Failed to instantiate the shared DRBG (%d), every caller seeds its own", r);
+    vSemaphoreDelete(rng_mux);
+    rng_mux = NULL;
+    return false;
+  }
+  rng_ready = true;
+
+  ESP_ERROR_CHECK(esp_timer_create(&rng_reseed_timer_args, &rng_reseed_timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(rng_reseed_timer, RNG_RESEED_INTERVAL_US));
+
+  rng_report_latency();
+  return true;
+}
+#else
+bool rng_init(void) {
+  ESP_LOGI(TAG, "Shared DRBG disabled, every caller seeds its own");
+  return true;
+}
+#endif
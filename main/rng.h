@@ -0,0 +1,15 @@
+#include <stdbool.h>
+
+#ifndef RNG_H
+#define RNG_H
+
+#define RNG_POOL_SLOTS 4              // Tasks that keep their own buffered DRBG output at the same time
+#define RNG_POOL_BUFFER_SIZE 128      // Four 32-byte keys or nonces per refill
+#define RNG_RESEED_ENTROPY_SIZE 48    // Fresh hardware TRNG bytes mixed in on every reseed
+
+// Creates the long-lived DRBG and starts reseeding it from the hardware TRNG.
+// From then on, wolfSSL's wc_InitRng() callers borrow it (see CMakeLists.txt) instead of seeding
+// and health testing a DRBG of their own.
+bool rng_init(void);
+
+#endif
@@ -0,0 +1,432 @@
+#include "schedule.h"
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <math.h>
+#include <nvs.h>
+#include <string.h>
+
+#include "datetime.h"
+#include "events.h"
+#include "preheat.h"
+
+static const char *TAG = "SCHEDULE";
+
+#define SCHEDULE_NVS_NAMESPACE "schedule"
+#define SCHEDULE_NVS_KEY "config"
+#define SCHEDULE_NVS_KEY_PREHEAT "preheat"
+
+#define DAY_S 86400
+#define WEEK_S (SCHEDULE_DAYS * DAY_S)
+#define STEP_S (SCHEDULE_STEP_MIN * 60)
+#define STEPS (WEEK_S / STEP_S)           // Quarters of an hour in a week
+#define MAX_CHANGES (SCHEDULE_DAYS * SCHEDULE_MAX_SLOTS)
+
+// The changes of the week in time order, and for every quarter of an hour the change in effect then.
+// Before the first change of the week, the last one of the week before is in effect.
+typedef struct {
+  uint8_t count;
+  uint32_t at[MAX_CHANGES];               // Seconds into the week, from Sunday midnight
+  float target[MAX_CHANGES];
+  uint8_t current[STEPS];
+} ScheduleTable;
+
+// A new program is compiled into the table that is not in use and swapped in, so an invalid one never
+// replaces the old one and a lookup never sees half of an edit
+static ScheduleTable tables[2];
+static ScheduleTable *table = &tables[0];
+static ScheduleConfig config;
+
+static bool hold = false;
+static float hold_target;
+static time_t hold_until;
+
+static time_t preheat_change = 0;       // The change the heating started early for
+
+static bool started = false;
+static bool applied = false;
+static float applied_target;
+static schedule_callback on_change = NULL;
+
+static SemaphoreHandle_t schedule_mux = NULL;
+static esp_timer_handle_t schedule_timer = NULL;
+
+static bool valid_target(float target) {
+  return target >= CONFIG_THERMOSTAT_MIN_TEMP && target <= CONFIG_THERMOSTAT_MAX_TEMP;
+}
+
+static bool compile(const ScheduleConfig *c, ScheduleTable *t) {
+  if (c->holidays > SCHEDULE_MAX_HOLIDAYS) {
+    return false;
+  }
+  for (int i = 0; i < c->holidays; i++) {
+    if (c->holiday[i].from >= c->holiday[i].to || !valid_target(c->holiday[i].target)) {
+      return false;
+    }
+  }
+
+  t->count = 0;
+  for (int d = 0; d < SCHEDULE_DAYS; d++) {
+    const ScheduleDay *day = &c->days[d];
+    if (day->slots > SCHEDULE_MAX_SLOTS) {
+      return false;
+    }
+    for (int i = 0; i < day->slots; i++) {
+      const ScheduleSlot *slot = &day->slot[i];
+      if (slot->minute >= 24 * 60 || slot->minute % SCHEDULE_STEP_MIN != 0 || !valid_target(slot->target) ||
+          (i > 0 && slot->minute <= day->slot[i - 1].minute)) {
+        return false;
+      }
+      // Days and their slots are in order, so the table comes out sorted
+      t->at[t->count] = d * DAY_S + slot->minute * 60;
+      t->target[t->count] = slot->target;
+      t->count++;
+    }
+  }
+
+  if (t->count == 0) {
+    return true;
+  }
+  int current = t->count - 1;
+  int next = 0;
+  for (int s = 0; s < STEPS; s++) {
+    while (next < t->count && t->at[next] <= (uint32_t)s * STEP_S) {
+      current = next++;
+    }
+    t->current[s] = current;
+  }
+  return true;
+}
+
+// The weekly program at `now`: the setpoint in effect, the time of the next change and its setpoint
+static void weekly(time_t now, float *target, time_t *next_change, float *next_target) {
+  struct tm local;
+  localtime_r(&now, &local);
+  uint32_t week_s = local.tm_wday * DAY_S + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+
+  int current = table->current[week_s / STEP_S];
+  int next = (current + 1) % table->count;
+  *target = table->target[current];
+  *next_target = table->target[next];
+
+  // The next change as local time, so it stays on the right hour across a daylight saving change
+  uint32_t at = table->at[next];
+  int days = (int)(at / DAY_S) - local.tm_wday;
+  if (at <= week_s) {
+    days += SCHEDULE_DAYS;
+  }
+  local.tm_mday += days;
+  local.tm_hour = (at % DAY_S) / 3600;
+  local.tm_min = (at % 3600) / 60;
+  local.tm_sec = 0;
+  local.tm_isdst = -1;
+  *next_change = mktime(&local);
+}
+
+static const ScheduleHoliday *holiday_at(time_t t) {
+  for (int i = 0; i < config.holidays; i++) {
+    if (config.holiday[i].from <= t && t < config.holiday[i].to) {
+      return &config.holiday[i];
+    }
+  }
+  return NULL;
+}
+
+// The program and the holidays at `now`, without the hold
+static ScheduleStatus lookup(time_t now) {
+  ScheduleStatus status = {0};
+  if (!config.enabled || !datetime_valid()) {
+    return status;
+  }
+
+  const ScheduleHoliday *holiday = holiday_at(now);
+  bool has_week = table->count > 0;
+  if (has_week) {
+    weekly(now, &status.target, &status.next_change, &status.next_target);
+  }
+
+  if (holiday != NULL) {
+    status.active = true;
+    status.target = holiday->target;
+    status.next_change = holiday->to;
+    const ScheduleHoliday *after = holiday_at(holiday->to);
+    if (after != NULL) {
+      status.next_target = after->target;
+    } else if (has_week) {
+      time_t unused_change;
+      float unused_target;
+      weekly(holiday->to, &status.next_target, &unused_change, &unused_target);
+    } else {
+      // Without a program, the setpoint stays as the holiday left it
+      status.next_change = 0;
+    }
+    return status;
+  }
+
+  if (!has_week) {
+    return status;
+  }
+  status.active = true;
+
+  // A holiday that starts before the next change of the program comes first
+  for (int i = 0; i < config.holidays; i++) {
+    const ScheduleHoliday *h = &config.holiday[i];
+    if (h->from > now && h->from < status.next_change) {
+      status.next_change = h->from;
+      status.next_target = h->target;
+    }
+  }
+  return status;
+}
+
+// With the preheat for the next change, without the hold
+static ScheduleStatus effective(time_t now) {
+  ScheduleStatus status = lookup(now);
+  if (status.active && preheat_change != 0 && preheat_change == status.next_change) {
+    status.preheat = true;
+    status.target = status.next_target;
+  }
+  return status;
+}
+
+static void arm(time_t now, time_t next_change) {
+  esp_timer_stop(schedule_timer);
+  if (next_change == 0) {
+    return;
+  }
+
+  // The timer and the clock drift apart a little, the lookup then finds the old slot and the timer is armed
+  // again for the rest. If the clock was set meanwhile, the change is looked up again a second later.
+  int64_t delay = next_change > now ? next_change - now : 1;
+  ESP_ERROR_CHECK(esp_timer_start_once(schedule_timer, delay * 1000000));
+}
+
+static void on_timer(void *arg) {
+  eventloop_dispatch(HOMEKIT_THERMOSTAT_SCHEDULE_DUE);
+}
+
+static const esp_timer_create_args_t schedule_timer_args = {
+  .callback = &on_timer,
+  .name = "schedule"
+};
+
+static void load_defaults(ScheduleConfig *c) {
+  memset(c, 0, sizeof(*c));
+  c->enabled = CONFIG_SCHEDULE_ENABLED;
+
+  float comfort = CONFIG_SCHEDULE_COMFORT_TEMP / 10.0f;
+  float eco = CONFIG_SCHEDULE_ECO_TEMP / 10.0f;
+  for (int d = 0; d < SCHEDULE_DAYS; d++) {
+    bool weekend = d == 0 || d == 6;
+    ScheduleSlot from = {(weekend ? CONFIG_SCHEDULE_WEEKEND_FROM : CONFIG_SCHEDULE_WEEKDAY_FROM) * 60, comfort};
+    ScheduleSlot to = {(weekend ? CONFIG_SCHEDULE_WEEKEND_TO : CONFIG_SCHEDULE_WEEKDAY_TO) * 60, eco};
+
+    // Slots are kept in time order, a night that starts after midnight comes first
+    ScheduleDay *day = &c->days[d];
+    if (from.minute == to.minute) {
+      day->slots = 1;
+      day->slot[0] = from;
+    } else {
+      day->slots = 2;
+      day->slot[0] = from.minute < to.minute ? from : to;
+      day->slot[1] = from.minute < to.minute ? to : from;
+    }
+  }
+}
+
+static void save(const char *key, const void *value, size_t size) {
+  nvs_handle_t nvs;
+  if (nvs_open(SCHEDULE_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to open NVS, the %s is not saved", key);
+    return;
+  }
+
+  nvs_set_blob(nvs, key, value, size);
+  nvs_commit(nvs);
+  nvs_close(nvs);
+}
+
+static bool load(const char *key, void *value, size_t size) {
+  nvs_handle_t nvs;
+  if (nvs_open(SCHEDULE_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+    return false;
+  }
+
+  size_t len = size;
+  esp_err_t err = nvs_get_blob(nvs, key, value, &len);
+  nvs_close(nvs);
+  return err == ESP_OK && len == size;
+}
+
+void schedule_init(void) {
+  schedule_mux = xSemaphoreCreateMutex();
+  ESP_ERROR_CHECK(esp_timer_create(&schedule_timer_args, &schedule_timer));
+
+  if (!load(SCHEDULE_NVS_KEY, &config, sizeof(config)) || !compile(&config, table)) {
+    load_defaults(&config);
+    compile(&config, table);
+  }
+  ESP_LOGI(TAG, "Schedule %s, %d changes a week, %d holidays", config.enabled ? "on" : "off", table->count,
+           config.holidays);
+
+  // The warm-up is learned over weeks, so it is kept across restarts
+  PreheatStats stats;
+  bool learned = load(SCHEDULE_NVS_KEY_PREHEAT, &stats, sizeof(stats));
+  preheat_init(learned ? &stats : NULL);
+  PreheatStatus preheat = preheat_status();
+  ESP_LOGI(TAG, "Warm-up learned from %d cycles, %.2f°C/h after %.0f min, duration error %.1f min", preheat.cycles,
+           preheat.rate, preheat.dead_time_s / 60, preheat.error_s / 60);
+}
+
+void schedule_start(schedule_callback callback) {
+  xSemaphoreTake(schedule_mux, portMAX_DELAY);
+  on_change = callback;
+  started = true;
+  xSemaphoreGive(schedule_mux);
+
+  eventloop_dispatch(HOMEKIT_THERMOSTAT_SCHEDULE_DUE);
+}
+
+void schedule_due(void) {
+  if (schedule_mux == NULL) {
+    return;
+  }
+
+  xSemaphoreTake(schedule_mux, portMAX_DELAY);
+  if (!started) {
+    xSemaphoreGive(schedule_mux);
+    return;
+  }
+
+  time_t now = time(NULL);
+  if (hold && now >= hold_until) {
+    // The next change takes over from the manual setpoint, even when it sets what was scheduled before
+    hold = false;
+    applied = false;
+  }
+  ScheduleStatus status = effective(now);
+  arm(now, status.next_change);
+
+  // Only an actual change goes out, so a timer that fires early does not undo a manual setpoint
+  bool changed = status.active && !hold && (!applied || applied_target != status.target);
+  if (changed) {
+    applied = true;
+    applied_target = status.target;
+  }
+  schedule_callback callback = on_change;
+  xSemaphoreGive(schedule_mux);
+
+  if (changed && callback != NULL) {
+    ESP_LOGI(TAG, "Setpoint %.1f°C until %lld", status.target, (long long)status.next_change);
+    callback(status.target);
+  }
+}
+
+void schedule_hold(float target) {
+  if (schedule_mux == NULL) {
+    return;
+  }
+
+  xSemaphoreTake(schedule_mux, portMAX_DELAY);
+  ScheduleStatus status = effective(time(NULL));
+  if (!status.active || status.next_change == 0 || fabsf(target - status.target) < 0.05f) {
+    hold = false;
+  } else {
+    hold = true;
+    hold_target = target;
+    hold_until = status.next_change;
+  }
+  xSemaphoreGive(schedule_mux);
+}
+
+ScheduleStatus schedule_status(void) {
+  ScheduleStatus status = {0};
+  if (schedule_mux == NULL) {
+    return status;
+  }
+
+  xSemaphoreTake(schedule_mux, portMAX_DELAY);
+  time_t now = time(NULL);
+  status = effective(now);
+  status.enabled = config.enabled;
+  if (status.active && hold && now < hold_until) {
+    status.hold = true;
+    status.target = hold_target;
+  }
+  xSemaphoreGive(schedule_mux);
+  return status;
+}
+
+void schedule_sample(float temp, float target, bool heating) {
+  // The warm-up is timed by the clock, which a restore from the checkpoint leaves behind
+  if (schedule_mux == NULL || !datetime_valid()) {
+    return;
+  }
+
+  time_t now = time(NULL);
+  PreheatEvent event = preheat_sample(now, temp, target, heating, NAN);
+  if (event != PREHEAT_NONE) {
+    PreheatStatus preheat = preheat_status();
+    if (event == PREHEAT_ARRIVAL) {
+      ESP_LOGI(TAG, "Preheat reached the target %.0f min %s, %.1f min rms over %d preheats",
+               fabsf(preheat.arrival_error_s) / 60, preheat.arrival_error_s > 0 ? "late" : "early",
+               preheat.arrival_rms_s / 60, preheat.arrivals);
+    } else {
+      ESP_LOGI(TAG, "Warm-up learned from %d cycles, %.2f°C/h after %.0f min, duration error %.1f min",
+               preheat.cycles, preheat.rate, preheat.dead_time_s / 60, preheat.error_s / 60);
+    }
+    save(SCHEDULE_NVS_KEY_PREHEAT, preheat_stats(), sizeof(PreheatStats));
+  }
+
+#if CONFIG_SCHEDULE_PREHEAT
+  // Once the heating needs all the time left until a warmer setpoint, the setpoint starts now
+  bool preheat = false;
+  float lead = 0;
+  xSemaphoreTake(schedule_mux, portMAX_DELAY);
+  ScheduleStatus status = effective(now);
+  if (started && status.active && !status.preheat && !hold && status.next_change != 0 &&
+      status.next_target > status.target) {
+    lead = preheat_lead(temp, status.next_target, NAN, CONFIG_SCHEDULE_PREHEAT_MAX_LEAD * 60);
+    if (lead > 0 && now + lead >= status.next_change) {
+      preheat = true;
+      preheat_change = status.next_change;
+      preheat_started(status.next_change, status.next_target);
+    }
+  }
+  xSemaphoreGive(schedule_mux);
+
+  if (preheat) {
+    ESP_LOGI(TAG, "Preheating for %.1f°C, %.0f min ahead", status.next_target, lead / 60);
+    eventloop_dispatch(HOMEKIT_THERMOSTAT_SCHEDULE_DUE);
+  }
+#endif
+}
+
+bool schedule_update(const ScheduleConfig *c) {
+  xSemaphoreTake(schedule_mux, portMAX_DELAY);
+  ScheduleTable *spare = table == &tables[0] ? &tables[1] : &tables[0];
+  if (!compile(c, spare)) {
+    xSemaphoreGive(schedule_mux);
+    ESP_LOGW(TAG, "Invalid schedule, keeping the old one");
+    return false;
+  }
+  table = spare;
+  config = *c;
+  hold = false;
+  preheat_change = 0;
+  applied = false;
+  xSemaphoreGive(schedule_mux);
+
+  save(SCHEDULE_NVS_KEY, c, sizeof(*c));
+  eventloop_dispatch(HOMEKIT_THERMOSTAT_SCHEDULE_DUE);
+  return true;
+}
+
+void schedule_get(ScheduleConfig *c) {
+  xSemaphoreTake(schedule_mux, portMAX_DELAY);
+  *c = config;
+  xSemaphoreGive(schedule_mux);
+}
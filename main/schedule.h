@@ -0,0 +1,81 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+// Weekly setpoint schedule. Every day has its own program of setpoint changes, holidays override the week
+// with a fixed setpoint, and a manual change holds until the next scheduled one.
+// The program is compiled into a sorted table of the changes in a week together with the change in effect
+// in every quarter of an hour, so the setpoint and the next change are looked up without a search. A single
+// one-shot timer fires at the next change.
+// Before a change to a warmer setpoint, the heating starts as early as the learned warm-up needs (see preheat.h).
+
+#define SCHEDULE_MAX_SLOTS 6            // Setpoint changes per day
+#define SCHEDULE_MAX_HOLIDAYS 4
+#define SCHEDULE_STEP_MIN 15            // Changes happen on the quarter hour
+#define SCHEDULE_DAYS 7
+
+typedef struct {
+  uint16_t minute;                      // Minutes after midnight, a multiple of SCHEDULE_STEP_MIN
+  float target;
+} ScheduleSlot;
+
+typedef struct {
+  uint8_t slots;                        // 0 keeps the setpoint of the day before
+  ScheduleSlot slot[SCHEDULE_MAX_SLOTS];  // Ordered by time
+} ScheduleDay;
+
+typedef struct {
+  time_t from;
+  time_t to;
+  float target;
+} ScheduleHoliday;
+
+typedef struct {
+  bool enabled;
+  ScheduleDay days[SCHEDULE_DAYS];      // Sunday first, like `tm_wday`
+  uint8_t holidays;
+  ScheduleHoliday holiday[SCHEDULE_MAX_HOLIDAYS];
+} ScheduleConfig;
+
+typedef struct {
+  bool enabled;                         // The schedule is on, whether or not it applies yet
+  bool active;                          // false while the schedule is off, empty or the clock is not set
+  bool hold;                            // A manual setpoint is held until `next_change`
+  bool preheat;                         // Heating up early, `target` is already the one of the next change
+  float target;                         // Setpoint in effect
+  time_t next_change;
+  float next_target;
+} ScheduleStatus;
+
+typedef void (*schedule_callback)(float target);
+
+// Loads the program from NVS, or the default one from menuconfig
+void schedule_init(void);
+
+// Applies the setpoint in effect through `on_change` and arms the timer, once the clock is set.
+// `on_change` is called from the event loop, for this first setpoint too and at every change.
+void schedule_start(schedule_callback on_change);
+
+// Called by the event loop when the timer fired
+void schedule_due(void);
+
+// Called with every temperature sample, the target in effect and the relay state. It learns the warm-up and
+// starts the next change early once the heating needs the time that is left.
+void schedule_sample(float temp, float target, bool heating);
+
+// A manual setpoint from the GUI or HomeKit, held until the next change.
+// Setting the scheduled setpoint again ends the hold.
+void schedule_hold(float target);
+
+ScheduleStatus schedule_status(void);
+
+// Replaces the program and saves it, from any task. Returns false when it is invalid, the old one stays then.
+// The setpoint of the new program is applied from the event loop, like every change.
+bool schedule_update(const ScheduleConfig *config);
+
+void schedule_get(ScheduleConfig *config);
+
+#endif
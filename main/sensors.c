@@ -0,0 +1,120 @@
+#include "sensors.h"
+
+#include "calibration.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const char *TAG = "SENSORS";
+
+static int sensor_count = 0;
+
+void sensors_init(void) {
+  sensor_count = sht40_init();
+  if (sensor_count > FUSION_MAX_SENSORS) {
+    ESP_LOGW(TAG, "Only the first %d of %d sensors are used", FUSION_MAX_SENSORS, sensor_count);
+    sensor_count = FUSION_MAX_SENSORS;
+  }
+  fusion_init(sensor_count);
+  calibration_init(sensor_count);
+}
+
+bool sensors_measure(TempHumidity *temp_humid) {
+  SensorSample samples[FUSION_MAX_SENSORS] = {0};
+  SensorHealth health[FUSION_MAX_SENSORS];
+  TickType_t wait = 0;
+
+  // Start every conversion before reading any result, so they run at the same time and the bus is only busy
+  // for the commands and the reads
+  for (int i = 0; i < sensor_count; i++) {
+    health[i] = fusion_status(i)->health;
+    if (!fusion_due(i)) {
+      samples[i].read = SENSOR_READ_SKIPPED;
+      continue;
+    }
+
+    int64_t started = esp_timer_get_time();
+    esp_err_t err = ESP_OK;
+    if (health[i] == SENSOR_OFFLINE) {
+      err = sht40_recover(i);
+    }
+    if (err == ESP_OK) {
+      err = sht40_start(i);
+    }
+    samples[i].latency_us = esp_timer_get_time() - started;
+
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "Sensor %s failed to start: %s", sht40_name(i), esp_err_to_name(err));
+      samples[i].read = SENSOR_READ_FAILED;
+      continue;
+    }
+
+    TickType_t duration = sht40_duration(i);
+    if (duration > wait) {
+      wait = duration;
+    }
+  }
+
+  // One tick more, the conversion time is rounded to ticks
+  if (wait > 0) {
+    vTaskDelay(wait + 1);
+  }
+
+  calibration_update();
+
+  for (int i = 0; i < sensor_count; i++) {
+    if (samples[i].read != SENSOR_READ_OK) {
+      continue;
+    }
+
+    TempHumidity reading;
+    int64_t started = esp_timer_get_time();
+    esp_err_t err = sht40_read(i, &reading);
+    samples[i].latency_us += esp_timer_get_time() - started;
+
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "Sensor %s failed to read: %s", sht40_name(i), esp_err_to_name(err));
+      samples[i].read = SENSOR_READ_FAILED;
+      continue;
+    }
+
+    // Calibrated before the fusion, so the sensors agree with each other
+    calibration_apply(i, &reading);
+    samples[i].temperature = reading.temperature;
+    samples[i].humidity = reading.humidity;
+  }
+
+  SensorFused fused = fusion_update(samples);
+
+  for (int i = 0; i < sensor_count; i++) {
+    const SensorStatus *s = fusion_status(i);
+    if (s->health != health[i]) {
+      ESP_LOGW(TAG, "Sensor %s is %s (%lu failures, %lu outliers in %lu reads, deviation %.2f C)", sht40_name(i),
+               fusion_health_str(s->health), s->failures, s->outliers, s->reads, s->deviation);
+    }
+    ESP_LOGD(TAG, "Sensor %s: %.2f C %.1f%%, %s, latency %lu us (max %lu us)", sht40_name(i), s->temperature,
+             s->humidity, fusion_health_str(s->health), s->latency_avg_us, s->latency_max_us);
+  }
+
+  if (!fused.valid) {
+    ESP_LOGE(TAG, "No sensor gave a reading");
+    return false;
+  }
+  if (fused.rejected > 0) {
+    ESP_LOGI(TAG, "Rejected %d of %d readings as outliers", fused.rejected, fused.used + fused.rejected);
+  }
+
+  temp_humid->temperature = fused.temperature;
+  temp_humid->humidity = fused.humidity;
+  return true;
+}
+
+int sensors_count(void) {
+  return sensor_count;
+}
+
+const SensorStatus *sensors_status(int index) {
+  return fusion_status(index);
+}
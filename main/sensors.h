@@ -0,0 +1,20 @@
+#include <stdbool.h>
+
+#include "fusion.h"
+#include "hw/sht40.h"
+
+#ifndef SENSORS_H
+#define SENSORS_H
+
+// Sets up the temperature sensors
+void sensors_init(void);
+
+// Measures all sensors at once and fuses their readings into `temp_humid`.
+// Returns false when none of them gave a usable reading, the previous value should be kept then.
+// Only the temperature task measures, the sensors are not locked.
+bool sensors_measure(TempHumidity *temp_humid);
+
+int sensors_count(void);
+const SensorStatus *sensors_status(int index);
+
+#endif
@@ -1,18 +1,108 @@
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <time.h>
 
+#include "../controller.h"
+#include "../datetime.h"
+#include "../filter.h"
+#include "../gui/scr_history.h"
 #include "../gui/scr_main.h"
+#include "../history.h"
 #include "../homekit.h"
 #include "../hw/relay.h"
-#include "../hw/sht40.h"
+#include "../ota.h"
+#include "../schedule.h"
+#include "../sensors.h"
+
+static Filter temp_filter;
+static TaskHandle_t temp_task = NULL;
+static int64_t decide_max_us = 0;
+
+// Switches the relay as the controller plans it for the thermostat state. The controller is only ever used on this
+// task, a target changed elsewhere asks for a new plan with task_temperature_replan().
+static void thermostat_decide(HomekitState state, bool replan) {
+  if (state.current_state != THERMOSTAT_HEAT) {
+    if (relay_turned_on || replan) {
+      relay_off();
+      gui_set_thermostat_status(THERMOSTAT_OFF);
+    }
+    return;
+  }
+
+  int64_t started = esp_timer_get_time();
+  ControllerDecision decision = controller_decide(state.current_temp, state.target_temp, relay_turned_on);
+  int64_t took = esp_timer_get_time() - started;
+
+  // The planner runs in soft float and 64-bit integer math here, the host sim only tells how it compares
+  if (decision.planned) {
+    if (took > decide_max_us) {
+      decide_max_us = took;
+    }
+    ESP_LOGI("TEMP_TASK", "Planned relay %s, next switch in %d samples, peak %.1f (target %.1f), took %lld us (max %lld us)",
+             decision.heat ? "ON" : "OFF", decision.next_switch, decision.peak, state.target_temp, took, decide_max_us);
+  }
+
+  // Turn off the relay and show the IDLE state on the display when the plan says the room
+  // will reach the target on the heat that is already on its way
+  if (!decision.heat && relay_turned_on) {
+    ESP_LOGI("TEMP_TASK", "Current temperature (%.1f), target (%.1f). Switching relay OFF", state.current_temp, state.target_temp);
+    relay_off();
+    gui_set_thermostat_status(_THERMOSTAT_IDLE);
+  } else if (decision.heat && !relay_turned_on) {
+    ESP_LOGI("TEMP_TASK", "Current temperature (%.1f), target (%.1f). Switching relay ON", state.current_temp, state.target_temp);
+    relay_on();
+    gui_set_thermostat_status(THERMOSTAT_HEAT);
+  } else if (replan) {
+    // The thermostat may just have been turned on, so the status is shown even when the relay stays as it is
+    gui_set_thermostat_status(relay_turned_on ? THERMOSTAT_HEAT : _THERMOSTAT_IDLE);
+  }
+}
+
+void task_temperature_replan(void) {
+  if (temp_task != NULL) {
+    xTaskNotifyGive(temp_task);
+  }
+}
 
 void task_temperature(void *pvParameters) {
   TempHumidity temp_humid;
+  int64_t last_sample = 0;
+  TickType_t next_poll = xTaskGetTickCount();
+  temp_task = xTaskGetCurrentTaskHandle();
+
+  // A single noisy sample should not switch the relay
+  filter_init(&temp_filter, CONFIG_FILTER_MEDIAN_SAMPLES, CONFIG_FILTER_EMA_TIME_CONSTANT,
+              CONFIG_FILTER_MAX_RATE / 100.0f / 60);
 
   while (1) {
-    temp_humid = sht40_measure_temp();
-    ESP_LOGI("SHT40", "Humidity: %.1f%% Temperature: %.1fC", temp_humid.humidity, temp_humid.temperature);
+    // A new plan for a changed target comes in between the polls, which keep their pace
+    TickType_t now_ticks = xTaskGetTickCount();
+    TickType_t wait = (int32_t)(next_poll - now_ticks) > 0 ? next_poll - now_ticks : 0;
+    if (ulTaskNotifyTake(pdTRUE, wait) > 0) {
+      thermostat_decide(homekit_get_state(), true);
+      continue;
+    }
+    next_poll = xTaskGetTickCount() + pdMS_TO_TICKS(CONFIG_TEMPERATURE_POLL_PERIOD);
+
+    // Without a reading, keep the last temperature and the relay as they are until the next poll
+    if (!sensors_measure(&temp_humid)) {
+      continue;
+    }
+    ota_report_health(OTA_HEALTH_SENSORS);
+
+    // The filter weighs the samples by the time between them, which is not quite the poll period
+    int64_t now = esp_timer_get_time();
+    float dt = last_sample == 0 ? CONFIG_TEMPERATURE_POLL_PERIOD / 1000.0f : (now - last_sample) / 1e6f;
+    last_sample = now;
+
+    float raw = temp_humid.temperature;
+    temp_humid.temperature = filter_add(&temp_filter, raw, dt);
+    // On this task like every decision, which reads the dwell the delay sets
+    controller_set_sensor_delay(filter_delay_s(&temp_filter));
+    ESP_LOGI("SHT40", "Humidity: %.1f%% Temperature: %.1fC (raw %.2fC%s, filter delay %.0f s)", temp_humid.humidity,
+             temp_humid.temperature, raw, filter_held(&temp_filter) ? " held back" : "", filter_delay_s(&temp_filter));
 
     // Update temperature in homekit
     homekit_set_curr_temp(temp_humid);
@@ -20,22 +110,21 @@ void task_temperature(void *pvParameters) {
     // Update temperature in GUI
     gui_set_curr_temp(temp_humid.temperature);
 
+    // The room cools down with the heating off too, so the controller learns from every sample
+    controller_sample(temp_humid.temperature, relay_turned_on);
+
     HomekitState state = homekit_get_state();
 
-    if (state.current_state == THERMOSTAT_HEAT) {
-      // If the current temperature is higher that the target,
-      // Turn off the relay and show the IDLE state on the display
-      if (state.current_temp > state.target_temp && relay_turned_on) {
-        ESP_LOGI("TEMP_TASK", "Current temperature (%.1f) is higher that the target (%.1f). Switching relay OFF", state.current_temp, state.target_temp);
-        relay_off();
-        gui_set_thermostat_status(_THERMOSTAT_IDLE);
-      } else if (state.current_temp < state.target_temp && !relay_turned_on) {
-        ESP_LOGI("TEMP_TASK", "Current temperature (%.1f) is lower that the target (%.1f). Switching relay ON", state.current_temp, state.target_temp);
-        relay_on();
-        gui_set_thermostat_status(THERMOSTAT_HEAT);
-      }
+    // Learn how fast the room warms up, and start the next scheduled change early if it takes longer than is left
+    schedule_sample(temp_humid.temperature, state.target_temp, relay_turned_on);
+
+    // Record the sample and move the history chart along, if it is shown. Not with a clock that is behind.
+    if (datetime_valid()) {
+      history_add(time(NULL), temp_humid.temperature, temp_humid.humidity, state.target_temp, relay_turned_on);
     }
+    gui_history_update();
 
-    vTaskDelay(pdMS_TO_TICKS(CONFIG_TEMPERATURE_POLL_PERIOD));
+    thermostat_decide(state, false);
+    ota_report_health(OTA_HEALTH_CONTROL);
   }
-}
\ No newline at end of file
+}
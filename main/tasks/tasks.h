@@ -1,3 +1,4 @@
-void task_time(void *pvParameters);
 void task_temperature(void *pvParameters);
+// Asks the temperature task to plan the relay again right away, e.g. after the target changed
+void task_temperature_replan(void);
 void task_lvgl(void *pvParameters);
\ No newline at end of file
@@ -3,13 +3,16 @@
 #include <esp_err.h>
 #include <esp_event.h>
 #include <esp_log.h>
+#include <esp_random.h>
 #include <esp_system.h>
+#include <esp_timer.h>
 #include <esp_wifi.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 #include <freertos/task.h>
 #include <network_provisioning/manager.h>
 #include <network_provisioning/scheme_ble.h>
+#include <nvs.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -20,6 +23,34 @@ static const char *TAG = "WIFI";
 
 static bool prov_initialized = false;
 
+#define WIFI_NVS_NAMESPACE "wifi_cache"
+#define WIFI_NVS_KEY_AP "ap"
+
+// The access point and lease of the last connection. Connecting to a known BSSID on a known channel skips the
+// scan of all channels, and reusing the lease skips DHCP.
+typedef struct {
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint32_t ip;
+  uint32_t netmask;
+  uint32_t gw;
+  uint32_t dns;
+} WifiCache;
+
+static esp_netif_t *sta_netif = NULL;
+static WifiCache cache;
+static bool cache_valid = false;
+static bool use_cache = false;          // Whether the next attempt goes straight to the cached access point
+static bool attempt_cached = false;     // Whether the current attempt did
+
+static bool managed = false;            // wifi_connect() was called, rather than the provisioning connecting
+static bool connected = false;
+static int attempts = 0;                // Failed attempts since the last connection
+static int64_t attempt_started = 0;
+static int64_t disconnected_at = 0;     // 0 at boot
+static esp_timer_handle_t reconnect_timer = NULL;
+static WifiStats stats;
+
 // This salt,verifier has been generated for username = "wifiprov" and password = "abcd1234"
 // IMPORTANT NOTE: For production cases, this must be unique to every device
 // and should come from device manufacturing partition.
@@ -93,10 +124,10 @@ static void on_network_prov_event(void *arg, esp_event_base_t event_base, int32_
                (const char *)wifi_sta_cfg->ssid,
                (const char *)wifi_sta_cfg->password);
 
-      eventloop_dispatch(HOMEKIT_THERMOSTAT_INIT_STARTED, NULL, 0);
+      eventloop_dispatch(HOMEKIT_THERMOSTAT_INIT_STARTED);
       char msg[100];
       snprintf(msg, 100, "Received Wi-Fi credentials for %s...", (const char *)wifi_sta_cfg->ssid);
-      eventloop_dispatch(HOMEKIT_THERMOSTAT_LOG, msg, strlen(msg) + 1);
+      eventloop_log(msg);
       break;
     }
     case NETWORK_PROV_WIFI_CRED_FAIL: {
@@ -112,7 +143,7 @@ static void on_network_prov_event(void *arg, esp_event_base_t event_base, int32_
       ESP_LOGI(TAG, "Provisioning successful");
 
       const char *msg = "Provisioning successful";
-      eventloop_dispatch(HOMEKIT_THERMOSTAT_LOG, msg, strlen(msg) + 1);
+      eventloop_log(msg);
       break;
     case NETWORK_PROV_END:
       network_prov_mgr_deinit();
@@ -122,15 +153,109 @@ static void on_network_prov_event(void *arg, esp_event_base_t event_base, int32_
   }
 }
 
+static void load_cache(void) {
+  nvs_handle_t nvs;
+  if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+    return;
+  }
+
+  size_t len = sizeof(cache);
+  cache_valid = nvs_get_blob(nvs, WIFI_NVS_KEY_AP, &cache, &len) == ESP_OK && len == sizeof(cache);
+  nvs_close(nvs);
+}
+
+static void save_cache(const WifiCache *latest) {
+  // Only a different access point or lease is written, so reconnects do not wear out the flash
+  if (cache_valid && memcmp(&cache, latest, sizeof(cache)) == 0) {
+    return;
+  }
+  cache = *latest;
+  cache_valid = true;
+
+  nvs_handle_t nvs;
+  if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+    return;
+  }
+  nvs_set_blob(nvs, WIFI_NVS_KEY_AP, &cache, sizeof(cache));
+  nvs_commit(nvs);
+  nvs_close(nvs);
+}
+
+// Only once associated: a static address set before posts IP_EVENT_STA_GOT_IP, and with it a connection, without
+// a link. on_wifi_event is registered for any WiFi event, so it runs before the station netif's own handler of the
+// association, which then posts the address set here, or starts DHCP.
+static void set_lease(bool cached) {
+#if CONFIG_WIFI_REUSE_IP
+  if (cached && cache.ip != 0) {
+    esp_netif_dhcpc_stop(sta_netif);
+    esp_netif_ip_info_t info = {.ip.addr = cache.ip, .netmask.addr = cache.netmask, .gw.addr = cache.gw};
+    esp_netif_set_ip_info(sta_netif, &info);
+    esp_netif_dns_info_t dns = {.ip.type = ESP_IPADDR_TYPE_V4, .ip.u_addr.ip4.addr = cache.dns};
+    esp_netif_set_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns);
+  } else {
+    esp_netif_dhcpc_start(sta_netif);
+  }
+#endif
+}
+
+static void connect_attempt(void) {
+  if (!managed) {
+    esp_wifi_connect();
+    return;
+  }
+
+  wifi_config_t config;
+  ESP_ERROR_CHECK(esp_wifi_get_config(WIFI_IF_STA, &config));
+  attempt_cached = use_cache && cache_valid;
+  config.sta.bssid_set = attempt_cached;
+  config.sta.channel = attempt_cached ? cache.channel : 0;
+  if (attempt_cached) {
+    memcpy(config.sta.bssid, cache.bssid, sizeof(cache.bssid));
+  }
+  ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &config));
+
+  attempt_started = esp_timer_get_time();
+  esp_wifi_connect();
+}
+
+static void on_reconnect_timer(void *arg) {
+  connect_attempt();
+}
+
+static const esp_timer_create_args_t reconnect_timer_args = {
+  .callback = &on_reconnect_timer,
+  .name = "wifi_reconnect"
+};
+
 static void on_wifi_event(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
   switch (event_id) {
     case WIFI_EVENT_STA_START:
-      esp_wifi_connect();
+      connect_attempt();
+      break;
+    case WIFI_EVENT_STA_CONNECTED: {
+      wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *)event_data;
+      ESP_LOGI(TAG, "Associated with %02x:%02x:%02x:%02x:%02x:%02x on channel %d%s", event->bssid[0],
+               event->bssid[1], event->bssid[2], event->bssid[3], event->bssid[4], event->bssid[5],
+               event->channel, attempt_cached ? " (cached)" : "");
+      if (managed) {
+        set_lease(attempt_cached);
+      }
       break;
+    }
     // This event is called when wifi is disconnected while running
     // but also when booting up and cannot connect to the provisioned network
     case WIFI_EVENT_STA_DISCONNECTED:
-      eventloop_dispatch(HOMEKIT_THERMOSTAT_WIFI_DISCONNECTED, NULL, 0);
+      if (connected) {
+        // The same access point is tried first, it most likely just restarted
+        connected = false;
+        disconnected_at = esp_timer_get_time();
+        use_cache = true;
+      } else if (attempt_cached) {
+        // Moved, or the access point is gone: scan all channels from now on
+        use_cache = false;
+      }
+      attempts++;
+      eventloop_dispatch(HOMEKIT_THERMOSTAT_WIFI_DISCONNECTED);
       break;
     default:
       break;
@@ -139,8 +264,19 @@ static void on_wifi_event(void *arg, esp_event_base_t event_base, int32_t event_
 
 void wifi_reconnect() {
   char *msg = "#ff0000 WiFi connection failed. Retrying... #";
-  eventloop_dispatch(HOMEKIT_THERMOSTAT_LOG, msg, strlen(msg) + 1);
-  esp_wifi_connect();
+  eventloop_log(msg);
+
+  // Exponential backoff with ±25 % jitter, so a house full of devices does not retry in lockstep
+  int shift = attempts - 1 < 8 ? attempts - 1 : 8;
+  int64_t delay_ms = (int64_t)WIFI_BACKOFF_MIN_MS << (shift > 0 ? shift : 0);
+  if (delay_ms > WIFI_BACKOFF_MAX_MS) {
+    delay_ms = WIFI_BACKOFF_MAX_MS;
+  }
+  delay_ms += (int64_t)(esp_random() % (delay_ms / 2 + 1)) - delay_ms / 4;
+  ESP_LOGI(TAG, "Reconnecting in %lld ms (attempt %d%s)", delay_ms, attempts + 1, use_cache && cache_valid ? ", cached" : "");
+
+  esp_timer_stop(reconnect_timer);
+  ESP_ERROR_CHECK(esp_timer_start_once(reconnect_timer, delay_ms * 1000));
 }
 
 static void on_ip_event(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
@@ -148,12 +284,51 @@ static void on_ip_event(void *arg, esp_event_base_t event_base, int32_t event_id
     ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
     ESP_LOGI(TAG, "Obtained IP Address: " IPSTR, IP2STR(&event->ip_info.ip));
 
+    int64_t now = esp_timer_get_time();
+    uint32_t attempt_ms = (now - attempt_started) / 1000;
+    stats.connects++;
+    stats.connect_last_ms = attempt_ms;
+    if (attempt_ms > stats.connect_max_ms) {
+      stats.connect_max_ms = attempt_ms;
+    }
+    if (disconnected_at != 0) {
+      uint32_t offline_ms = (now - disconnected_at) / 1000;
+      stats.reconnects++;
+      stats.offline_last_ms = offline_ms;
+      if (offline_ms > stats.offline_max_ms) {
+        stats.offline_max_ms = offline_ms;
+      }
+    }
+    ESP_LOGI(TAG, "Connected in %lu ms (%s) after %d failed attempts, offline for %lu ms", stats.connect_last_ms,
+             attempt_cached ? "cached access point" : "scan", attempts,
+             disconnected_at != 0 ? stats.offline_last_ms : 0);
+
+    wifi_ap_record_t ap;
+    if (managed && esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+      WifiCache latest = {
+        .channel = ap.primary,
+        .ip = event->ip_info.ip.addr,
+        .netmask = event->ip_info.netmask.addr,
+        .gw = event->ip_info.gw.addr,
+      };
+      memcpy(latest.bssid, ap.bssid, sizeof(latest.bssid));
+      esp_netif_dns_info_t dns;
+      if (esp_netif_get_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns) == ESP_OK) {
+        latest.dns = dns.ip.u_addr.ip4.addr;
+      }
+      save_cache(&latest);
+    }
+
+    connected = true;
+    attempts = 0;
+    use_cache = true;
+
     char msg[60];
     sprintf(msg, "Obtained IP Address: " IPSTR, IP2STR(&event->ip_info.ip));
-    eventloop_dispatch(HOMEKIT_THERMOSTAT_LOG, msg, strlen(msg) + 1);
+    eventloop_log(msg);
 
     // Signal main application to continue execution
-    eventloop_dispatch(HOMEKIT_THERMOSTAT_WIFI_CONNECTED, NULL, 0);
+    eventloop_dispatch(HOMEKIT_THERMOSTAT_WIFI_CONNECTED);
   }
 }
 
@@ -205,11 +380,13 @@ void wifi_init(void) {
   ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, on_wifi_event, NULL));
   ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_ip_event, NULL));
 
-  esp_netif_t *sta_netif = esp_netif_create_default_wifi_sta();
+  sta_netif = esp_netif_create_default_wifi_sta();
   esp_netif_set_hostname(sta_netif, "ESP32-Homekit-Thermostat");
 
   wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
   ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+  ESP_ERROR_CHECK(esp_timer_create(&reconnect_timer_args, &reconnect_timer));
 }
 
 bool wifi_is_provisioned(void) {
@@ -271,7 +448,13 @@ void wifi_connect() {
   ESP_ERROR_CHECK(esp_wifi_get_config(WIFI_IF_STA, &wifi_sta_cfg));
   char msg[70];
   snprintf(msg, 70, "Connecting to WiFi %s...", (const char *) wifi_sta_cfg.ssid);
-  eventloop_dispatch(HOMEKIT_THERMOSTAT_LOG, msg, strlen(msg) + 1);
+  eventloop_log(msg);
+
+  // The cached access point is set for each attempt, it must not overwrite the provisioned config in flash
+  load_cache();
+  use_cache = true;
+  managed = true;
+  ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
 
   ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
   ESP_ERROR_CHECK(esp_wifi_start());
@@ -280,6 +463,21 @@ void wifi_connect() {
 void wifi_reset() {
   ESP_LOGI(TAG, "Resetting Wi-Fi credentials");
   wifi_config_t wifi_cfg_empty = {0};
-  ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg_empty));
   ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_FLASH));
+  ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg_empty));
+
+  nvs_handle_t nvs;
+  if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+    nvs_erase_all(nvs);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+  }
+}
+
+bool wifi_connected(void) {
+  return connected;
+}
+
+WifiStats wifi_stats(void) {
+  return stats;
 }
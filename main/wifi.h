@@ -1,15 +1,30 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #define WIFI_PROV_SEC2_USERNAME "wifiprov"
 #define WIFI_PROV_SEC2_PWD "abcd1234"
 #define PROV_MGR_MAX_RETRY_CNT 3
 #define PROV_QR_VERSION "v1"
 #define PROV_TRANSPORT_BLE "ble"
+#define WIFI_BACKOFF_MIN_MS 250       // Delay before the first retry, doubled for every failed one
+#define WIFI_BACKOFF_MAX_MS 60000
+
+typedef struct {
+  uint32_t connects;
+  uint32_t connect_last_ms;           // From the start of the successful attempt until the IP address
+  uint32_t connect_max_ms;
+  uint32_t reconnects;
+  uint32_t offline_last_ms;           // From the loss of the connection until the IP address again
+  uint32_t offline_max_ms;
+} WifiStats;
 
 void wifi_init(void);
 bool wifi_is_provisioned(void);
 int wifi_init_provisioning(char *payload, size_t payload_len);
 void wifi_connect(void);
 void wifi_reset(void);
-void wifi_reconnect();
\ No newline at end of file
+// Tries again after a backoff that grows with every failed attempt
+void wifi_reconnect();
+bool wifi_connected(void);
+WifiStats wifi_stats(void);
\ No newline at end of file
@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+"""Fits the sensor calibration of the thermostat to a reference thermometer.
+
+Build with CONFIG_CALIBRATION_LOG, place a reference thermometer next to the
+thermostat and log both for a day or two, ideally while the room, the heating,
+the backlight and the CPU load change. The device log (`idf.py monitor` output)
+has a line per sensor and poll:
+
+    I (123456) CALIB: <unix time>,<sensor>,<raw temperature>,<raw humidity>,<CPU duty>,<backlight>,<relay>
+
+The reference is a CSV with a header and `time,temperature` columns, the time in
+unix seconds or ISO 8601. For every sensor the model of `main/calibration.h`
+
+    T = T_raw + offset(T_raw) - (cpu * CPU + light * backlight + relay * relay)
+
+is fitted by least squares, with the heat sources lagged by each candidate time
+constant in turn, and the best one is kept. A source that hardly changed in the
+log cannot be told apart from the offset and is left out.
+
+Writes an NVS CSV and, when ESP-IDF is available, the partition image:
+
+    fit_calibration.py <device.log> <reference.csv> <output.bin> [--size 0x3000]
+"""
+
+import argparse
+import bisect
+import csv
+import datetime
+import math
+import os
+import re
+import struct
+import subprocess
+import sys
+
+# Must match `main/calibration.c`
+NVS_NAMESPACE = "calib"
+MAX_POINTS = 8
+DEFAULT_OFFSET = -1.0
+SOURCES = ("cpu", "light", "relay")
+
+KNOT_SPACING = 3.0        # Between the points of the table (in °C)
+TAU_CANDIDATES = (120, 300, 600, 900, 1200, 1800, 2700, 3600)
+MAX_REFERENCE_GAP = 600   # Samples further from a reference reading are left out (in seconds)
+MAX_LOG_GAP = 600         # A longer gap in the log is taken as a reboot, the heat sources start over
+MIN_SOURCE_STDDEV = 0.05  # A source must change this much to be fitted
+SMOOTHING = 1.0           # Weight of the curvature of the table against the squared residuals
+
+LOG_LINE = re.compile(r"CALIB: (-?\d+),(\d+),(-?[\d.]+),(-?[\d.]+),([\d.]+),([\d.]+),([\d.]+)")
+
+
+def parse_time(value):
+    try:
+        return float(value)
+    except ValueError:
+        return datetime.datetime.fromisoformat(value).timestamp()
+
+
+def read_log(path):
+    sensors = {}
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = LOG_LINE.search(line)
+            if m:
+                t, index, temp, humidity, cpu, light, relay = m.groups()
+                sensors.setdefault(int(index), []).append(
+                    (float(t), float(temp), float(humidity), (float(cpu), float(light), float(relay))))
+    for samples in sensors.values():
+        samples.sort()
+    return sensors
+
+
+def read_reference(path):
+    rows = []
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            rows.append((parse_time(row["time"]), float(row["temperature"])))
+    rows.sort()
+    return rows
+
+
+def reference_at(reference, times, t):
+    # Linear interpolation between the two reference readings around `t`
+    i = bisect.bisect_left(times, t)
+    if i == 0 or i == len(times):
+        return None
+    (t0, v0), (t1, v1) = reference[i - 1], reference[i]
+    if t - t0 > MAX_REFERENCE_GAP or t1 - t > MAX_REFERENCE_GAP:
+        return None
+    return v0 + (v1 - v0) * (t - t0) / (t1 - t0) if t1 > t0 else v0
+
+
+def lagged_sources(samples, tau):
+    # Same recurrence as calibration_update(), the enclosure starts cold after every reboot
+    heat = [0.0] * len(SOURCES)
+    lagged = []
+    last = None
+    for t, _, _, levels in samples:
+        if last is None or t - last > MAX_LOG_GAP:
+            heat = [0.0] * len(SOURCES)
+        else:
+            alpha = 1 - math.exp(-(t - last) / tau)
+            heat = [h + alpha * (level - h) for h, level in zip(heat, levels)]
+        lagged.append(heat)
+        last = t
+    return lagged
+
+
+def choose_knots(temps):
+    temps = sorted(temps)
+    lo = temps[len(temps) // 100]
+    hi = temps[-1 - len(temps) // 100]
+    if hi - lo < 1.0:
+        return [temps[len(temps) // 2]]
+    points = min(MAX_POINTS, max(2, int((hi - lo) / KNOT_SPACING) + 1))
+    return [lo + (hi - lo) * i / (points - 1) for i in range(points)]
+
+
+def hat_weights(knots, temp):
+    # Weights of the table points in the linear interpolation at `temp`, as calibration_offset() does it
+    w = [0.0] * len(knots)
+    if temp <= knots[0]:
+        w[0] = 1
+    elif temp >= knots[-1]:
+        w[-1] = 1
+    else:
+        i = bisect.bisect_right(knots, temp)
+        f = (temp - knots[i - 1]) / (knots[i] - knots[i - 1])
+        w[i - 1], w[i] = 1 - f, f
+    return w
+
+
+def solve(a, b):
+    # Gaussian elimination with partial pivoting, the systems have at most MAX_POINTS + 3 unknowns
+    n = len(b)
+    m = [row[:] + [b[i]] for i, row in enumerate(a)]
+    for c in range(n):
+        p = max(range(c, n), key=lambda r: abs(m[r][c]))
+        if abs(m[p][c]) < 1e-12:
+            raise ValueError("singular system")
+        m[c], m[p] = m[p], m[c]
+        for r in range(c + 1, n):
+            f = m[r][c] / m[c][c]
+            for k in range(c, n + 1):
+                m[r][k] -= f * m[c][k]
+    x = [0.0] * n
+    for r in range(n - 1, -1, -1):
+        x[r] = (m[r][n] - sum(m[r][k] * x[k] for k in range(r + 1, n))) / m[r][r]
+    return x
+
+
+def fit(rows, knots, sources, lagged):
+    # Unknowns: the offsets at the knots, then the heat of each fitted source
+    n = len(knots) + len(sources)
+    ata = [[0.0] * n for _ in range(n)]
+    atb = [0.0] * n
+    for (raw, target), heat in zip(rows, lagged):
+        x = hat_weights(knots, raw) + [-heat[s] for s in sources]
+        y = target - raw
+        for i in range(n):
+            atb[i] += x[i] * y
+            for j in range(n):
+                ata[i][j] += x[i] * x[j]
+
+    # Keep the table smooth where the log has few samples
+    for i in range(1, len(knots) - 1):
+        d = {i - 1: 1.0, i: -2.0, i + 1: 1.0}
+        for a, va in d.items():
+            for b, vb in d.items():
+                ata[a][b] += SMOOTHING * va * vb
+
+    x = solve(ata, atb)
+    offsets, coefficients = x[:len(knots)], dict(zip(sources, x[len(knots):]))
+
+    error = 0.0
+    for (raw, target), heat in zip(rows, lagged):
+        corrected = raw + sum(w * o for w, o in zip(hat_weights(knots, raw), offsets))
+        corrected -= sum(coefficients[s] * heat[s] for s in sources)
+        error += (corrected - target) ** 2
+    return offsets, coefficients, math.sqrt(error / len(rows))
+
+
+def stddev(values):
+    mean = sum(values) / len(values)
+    return math.sqrt(sum((v - mean) ** 2 for v in values) / len(values))
+
+
+def fit_sensor(index, samples, reference):
+    times = [t for t, _ in reference]
+    matched = [i for i, s in enumerate(samples) if reference_at(reference, times, s[0]) is not None]
+    if len(matched) < 30:
+        print("Sensor %d: only %d samples next to a reference reading, skipped" % (index, len(matched)))
+        return None
+
+    rows = [(samples[i][1], reference_at(reference, times, samples[i][0])) for i in matched]
+    knots = choose_knots([raw for raw, _ in rows])
+    sources = [s for s in range(len(SOURCES)) if stddev([samples[i][3][s] for i in matched]) >= MIN_SOURCE_STDDEV]
+    for s in range(len(SOURCES)):
+        if s not in sources:
+            print("Sensor %d: %s hardly changed in the log, left out" % (index, SOURCES[s]))
+
+    best = None
+    for tau in TAU_CANDIDATES if sources else TAU_CANDIDATES[:1]:
+        lagged = lagged_sources(samples, tau)
+        offsets, coefficients, error = fit(rows, knots, sources, [lagged[i] for i in matched])
+        if best is None or error < best[3]:
+            best = (tau, offsets, coefficients, error)
+
+    tau, offsets, coefficients, error = best
+    before = math.sqrt(sum((raw + DEFAULT_OFFSET - target) ** 2 for raw, target in rows) / len(rows))
+    print("Sensor %d: %d samples, rms error %.3f C -> %.3f C, tau %d s" % (index, len(rows), before, error, tau))
+    for k, o in zip(knots, offsets):
+        print("  %6.2f C: %+.2f C" % (k, o))
+    for s, c in coefficients.items():
+        print("  %s: %.2f C" % (SOURCES[s], c))
+    return knots, offsets, coefficients, tau
+
+
+def int16_array(values):
+    return struct.pack("<%dh" % len(values), *(int(round(v * 100)) for v in values)).hex()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", help="device log with the CALIB lines")
+    parser.add_argument("reference", help="reference thermometer CSV with time and temperature columns")
+    parser.add_argument("output", help="partition image to write, the CSV is written next to it")
+    parser.add_argument("--size", default="0x3000", help="partition size (default: %(default)s)")
+    args = parser.parse_args()
+
+    sensors = read_log(args.log)
+    if not sensors:
+        parser.error("no CALIB lines in %s, is CONFIG_CALIBRATION_LOG enabled?" % args.log)
+    reference = read_reference(args.reference)
+
+    csv_path = os.path.splitext(args.output)[0] + ".csv"
+    with open(csv_path, "w") as f:
+        f.write("key,type,encoding,value\n")
+        f.write("%s,namespace,,\n" % NVS_NAMESPACE)
+        for index, samples in sorted(sensors.items()):
+            result = fit_sensor(index, samples, reference)
+            if result is None:
+                continue
+            knots, offsets, coefficients, tau = result
+            f.write("knots%d,data,hex2bin,%s\n" % (index, int16_array(knots)))
+            f.write("offsets%d,data,hex2bin,%s\n" % (index, int16_array(offsets)))
+            for s, name in enumerate(SOURCES):
+                f.write("%s%d,data,i32,%d\n" % (name, index, round(coefficients.get(s, 0.0) * 1000)))
+            f.write("tau%d,data,u32,%d\n" % (index, tau))
+    print("Calibration written to %s" % csv_path)
+
+    idf_path = os.environ.get("IDF_PATH")
+    if not idf_path:
+        print("IDF_PATH is not set, skipping the partition image", file=sys.stderr)
+        return 1
+
+    nvs_gen = os.path.join(idf_path, "components", "nvs_flash", "nvs_partition_generator", "nvs_partition_gen.py")
+    return subprocess.call([sys.executable, nvs_gen, "generate", csv_path, args.output, args.size])
+
+
+if __name__ == "__main__":
+    sys.exit(main())
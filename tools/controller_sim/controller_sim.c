@@ -0,0 +1,229 @@
+// Runs the heating controller (main/controller.c) against simulated rooms and compares it with the plain
+// on/off control the thermostat used before, sampling the temperature once a minute in both cases.
+//
+// Usage:
+//   controller_sim [days] [trace.csv]
+//
+// The rooms are the ones of tools/sim_common/sim.h.
+// The target is 21 °C from 6:00 to 22:00 and 18 °C at night, the outside temperature follows a daily cycle.
+// The exit code is non-zero when the controller does not beat on/off control on overshoot and relay cycles, or when
+// the model it learned does not fit the room (see room_reference()).
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "controller.h"
+#include "sim.h"
+
+#define SAMPLE_PERIOD_S 60
+#define LEARNING_DAYS 1          // Left out of the statistics, the model is still being learned
+#define COMFORT_TARGET 21.0f
+#define NIGHT_TARGET 18.0f
+#define SENSOR_NOISE 0.02        // Standard deviation of the SHT40 readings (in °C)
+#define MAX_OVERSHOOT 0.5        // Most the controller may exceed the comfort target by (in °C)
+
+typedef struct {
+  double max_overshoot;          // While the comfort target is set
+  double rms_error;              // While the comfort target is set
+  double rms_steady;             // The same, from when the room first reaches it each morning
+  double cycles_per_day;
+  double on_fraction;
+  double decide_avg_us;
+  double decide_max_us;
+  bool model_ready;
+} Result;
+
+// The time constants of the room and the most the radiator can warm it, from the parameters of the simulation.
+// The room has two modes, a fast one of the radiator and a slow one of the air, both faster with the relay on.
+// A first-order model of it may sit anywhere between them, but cannot be slower than the slowest one or promise
+// more heat than the radiator gives.
+typedef struct {
+  double tau_fast_s;             // With the relay on
+  double tau_slow_s;             // With the relay off
+  double gain;                   // Steady-state rise over the outside with the relay on
+} RoomReference;
+
+// Time constant of the slow (`slow`) or the fast mode of d[radiator, air]/dt = m * [radiator, air]
+static double mode_tau(double m00, double m01, double m10, double m11, bool slow) {
+  double trace = m00 + m11;
+  double det = m00 * m11 - m01 * m10;
+  double root = sqrt(trace * trace / 4 - det);
+  return -1 / (trace / 2 + (slow ? root : -root));
+}
+
+static RoomReference room_reference(const SimRoom *room) {
+  double s = room->supply_rate, r = room->radiator_rate, a = room->room_rate, l = room->loss_rate;
+  RoomReference ref = {
+    .tau_fast_s = mode_tau(-r - s, r, a, -a - l, false),
+    .tau_slow_s = mode_tau(-r, r, a, -a - l, true),
+    .gain = s * a * (room->supply_temp - room->outside_mean) / ((s + r) * (a + l) - r * a),
+  };
+  return ref;
+}
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static float target_at(int t) {
+  int hour = (t % SIM_DAY_S) / 3600;
+  return hour >= 6 && hour < 22 ? COMFORT_TARGET : NIGHT_TARGET;
+}
+
+static Result simulate(const SimRoom *room, int days, bool use_controller, FILE *trace) {
+  Result result = {0};
+  srand(1);
+  controller_init(SAMPLE_PERIOD_S);
+
+  SimRoomState state;
+  sim_room_init(&state, room, NIGHT_TARGET);
+  bool relay = false;
+  int cycles = 0;
+  int comfort_samples = 0;
+  int steady_samples = 0;
+  bool reached = false;
+  int on_samples = 0;
+  int decisions = 0;
+  double error_sum = 0;
+  double steady_sum = 0;
+  double decide_sum = 0;
+  result.max_overshoot = -INFINITY;
+
+  for (int t = 0; t < days * SIM_DAY_S; t++) {
+    sim_room_step(&state, t, relay, sim_room_outside(room, t));
+
+    if (t % SAMPLE_PERIOD_S != SAMPLE_PERIOD_S - 1) {
+      continue;
+    }
+
+    float measured = roundf((float)(state.air + SENSOR_NOISE * sim_gaussian()) * 100) / 100;
+    float target = target_at(t + 1);
+    bool counted = t >= LEARNING_DAYS * SIM_DAY_S;
+
+    bool heat;
+    if (use_controller) {
+      controller_sample(measured, relay);
+      double started = now_us();
+      heat = controller_decide(measured, target, relay).heat;
+      double took = now_us() - started;
+      decide_sum += took;
+      decisions++;
+      if (took > result.decide_max_us) {
+        result.decide_max_us = took;
+      }
+    } else {
+      // The control law of task_temperature before the controller
+      heat = relay;
+      if (measured > target) {
+        heat = false;
+      } else if (measured < target) {
+        heat = true;
+      }
+    }
+
+    if (counted) {
+      if (heat && !relay) {
+        cycles++;
+      }
+      on_samples += heat;
+      if (target == COMFORT_TARGET) {
+        double e = state.air - target;
+        error_sum += e * e;
+        comfort_samples++;
+        if (e > result.max_overshoot) {
+          result.max_overshoot = e;
+        }
+
+        // Until then the relay is on with either control, the warm-up only depends on the radiator
+        reached = reached || e >= 0;
+        if (reached) {
+          steady_sum += e * e;
+          steady_samples++;
+        }
+      } else {
+        reached = false;
+      }
+    }
+    relay = heat;
+
+    if (trace != NULL) {
+      fprintf(trace, "\"%s\",%s,%d,%.3f,%.3f,%.2f,%.1f,%d\n", room->name, use_controller ? "mpc" : "onoff", t + 1,
+              state.air, state.radiator, measured, target, relay);
+    }
+  }
+
+  int counted_days = days - LEARNING_DAYS;
+  result.rms_error = sqrt(error_sum / comfort_samples);
+  result.rms_steady = sqrt(steady_sum / steady_samples);
+  result.cycles_per_day = (double)cycles / counted_days;
+  result.on_fraction = (double)on_samples / (counted_days * SIM_DAY_S / SAMPLE_PERIOD_S);
+  if (decisions > 0) {
+    result.decide_avg_us = decide_sum / decisions;
+  }
+  result.model_ready = controller_model().ready;
+
+  sim_room_free(&state);
+  return result;
+}
+
+static void print_result(const char *what, Result r) {
+  printf("  %-6s overshoot %5.2f C  rms %5.2f C (reached %5.2f C)  cycles/day %5.1f  on %4.1f%%", what,
+         r.max_overshoot, r.rms_error, r.rms_steady, r.cycles_per_day, r.on_fraction * 100);
+  if (r.decide_avg_us > 0) {
+    printf("  decide avg %.0f us, max %.0f us", r.decide_avg_us, r.decide_max_us);
+  }
+  printf("\n");
+}
+
+int main(int argc, char **argv) {
+  int days = argc > 1 ? atoi(argv[1]) : 8;
+  if (days <= LEARNING_DAYS) {
+    fprintf(stderr, "Simulate more than %d day(s)\n", LEARNING_DAYS);
+    return EXIT_FAILURE;
+  }
+
+  FILE *trace = NULL;
+  if (argc > 2) {
+    trace = fopen(argv[2], "w");
+    if (trace == NULL) {
+      perror(argv[2]);
+      return EXIT_FAILURE;
+    }
+    fprintf(trace, "room,control,time_s,air,radiator,measured,target,relay\n");
+  }
+
+  bool passed = true;
+  for (size_t i = 0; i < SIM_ROOMS; i++) {
+    Result onoff = simulate(&sim_rooms[i], days, false, trace);
+    Result mpc = simulate(&sim_rooms[i], days, true, trace);
+
+    ControllerModel model = controller_model();
+    RoomReference ref = room_reference(&sim_rooms[i]);
+    printf("%s: learned dead time %d min, time constant %.0f min, gain %.1f C, error %.3f C\n", sim_rooms[i].name,
+           model.dead_time * SAMPLE_PERIOD_S / 60, model.tau_s / 60, model.gain, model.error);
+    printf("  room   time constants %.0f to %.0f min, gain up to %.1f C\n", ref.tau_fast_s / 60, ref.tau_slow_s / 60,
+           ref.gain);
+    print_result("on/off", onoff);
+    print_result("mpc", mpc);
+
+    bool fits_room = model.tau_s >= ref.tau_fast_s && model.tau_s <= ref.tau_slow_s && model.gain <= ref.gain &&
+                     model.tau_s >= CONTROLLER_TAU_MIN_S && model.tau_s <= CONTROLLER_TAU_MAX_S &&
+                     model.gain >= CONTROLLER_GAIN_MIN && model.gain <= CONTROLLER_GAIN_MAX;
+    bool ok = mpc.model_ready && fits_room && mpc.max_overshoot < MAX_OVERSHOOT &&
+              mpc.max_overshoot < onoff.max_overshoot && mpc.cycles_per_day <= onoff.cycles_per_day;
+    if (!ok) {
+      printf("  FAILED\n");
+      passed = false;
+    }
+  }
+
+  if (trace != NULL) {
+    fclose(trace);
+  }
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""Precomputes the HomeKit SRP salt and verifier for one device.
+
+The accessory normally derives v = g^x mod N from the setup code at the start of
+every pair-setup. Computing it here once lets the firmware load (salt, verifier)
+from the `hk_setup` partition instead, so pair-setup skips that exponentiation and
+the setup code itself does not have to be in the firmware. The record also holds
+the setup code, the setup ID and the pairing QR code payload, which the device
+shows until it is paired.
+
+Writes an NVS CSV and, when ESP-IDF is available, the partition image:
+
+    gen_setup_record.py <setup_code> <setup_id> <output.bin> [--category 9] [--size 0x3000] [--salt HEX]
+"""
+
+import argparse
+import hashlib
+import os
+import re
+import subprocess
+import sys
+
+# RFC 5054 3072-bit group, as required by the HomeKit Accessory Protocol
+N = int(
+    "FFFFFFFFFFFFFFFFC90FDAA22168C234C4C6628B80DC1CD129024E088A67CC74"
+    "020BBEA63B139B22514A08798E3404DDEF9519B3CD3A431B302B0A6DF25F1437"
+    "4FE1356D6D51C245E485B576625E7EC6F44C42E9A637ED6B0BFF5CB6F406B7ED"
+    "EE386BFB5A899FA5AE9F24117C4B1FE649286651ECE45B3DC2007CB8A163BF05"
+    "98DA48361C55D39A69163FA8FD24CF5F83655D23DCA3AD961C62F356208552BB"
+    "9ED529077096966D670C354E4ABC9804F1746C08CA18217C32905E462E36CE3B"
+    "E39E772C180E86039B2783A2EC07A28FB5C55DF06F4C52C9DE2BCBF695581718"
+    "3995497CEA956AE515D2261898FA051015728E5A8AAAC42DAD33170D04507A33"
+    "A85521ABDF1CBA64ECFB850458DBEF0A8AEA71575D060C7DB3970F85A6E1E4C7"
+    "ABF5AE8CDB0933D71E8C94E04A25619DCEE3D2261AD2EE6BF12FFA06D98A0864"
+    "D87602733EC86A64521F2B18177B200CBBE117577A615D6C770988C0BAD946E2"
+    "08E24FA074E5AB3143DB5BFCE0FD108E4B82D120A93AD2CAFFFFFFFFFFFFFFFF",
+    16,
+)
+G = 5
+USERNAME = b"Pair-Setup"
+SALT_LEN = 16
+FLAG_IP = 2
+
+# Must match `main/homekit_setup.c`
+NVS_NAMESPACE = "homekit"
+
+
+def srp_verifier(salt, setup_code):
+    # x = H(salt | H(username | ":" | password)), same as wc_SrpSetPassword
+    inner = hashlib.sha512(USERNAME + b":" + setup_code.encode()).digest()
+    x = int.from_bytes(hashlib.sha512(salt + inner).digest(), "big")
+    v = pow(G, x, N)
+    return v.to_bytes((v.bit_length() + 7) // 8, "big")
+
+
+def setup_uri(category, setup_code, setup_id):
+    # Same as `tools/qrcode_gen`: version 0 | reserved 0 | category (8 bits) | flags (4 bits) | setup code (27 bits)
+    payload = (category << 31) | (FLAG_IP << 27) | int(setup_code.replace("-", ""))
+    encoded = ""
+    for _ in range(9):
+        encoded = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"[payload % 36] + encoded
+        payload //= 36
+    return "X-HM://" + encoded + setup_id
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("setup_code", help="setup code in the XXX-XX-XXX format")
+    parser.add_argument("setup_id", help="setup ID, 4 alphanumeric characters")
+    parser.add_argument("output", help="partition image to write, the CSV is written next to it")
+    parser.add_argument("--category", type=int, default=9, help="accessory category (default: %(default)s, thermostat)")
+    parser.add_argument("--size", default="0x3000", help="partition size (default: %(default)s)")
+    parser.add_argument("--salt", help="fixed salt as hex, random by default")
+    args = parser.parse_args()
+
+    if not re.fullmatch(r"\d{3}-\d{2}-\d{3}", args.setup_code):
+        parser.error("setup code has to be in the XXX-XX-XXX format")
+    if not re.fullmatch(r"[0-9A-Z]{4}", args.setup_id):
+        parser.error("setup ID has to be 4 characters of 0-9 and A-Z")
+
+    salt = bytes.fromhex(args.salt) if args.salt else os.urandom(SALT_LEN)
+    verifier = srp_verifier(salt, args.setup_code)
+
+    csv_path = os.path.splitext(args.output)[0] + ".csv"
+    with open(csv_path, "w") as f:
+        f.write("key,type,encoding,value\n")
+        f.write("%s,namespace,,\n" % NVS_NAMESPACE)
+        f.write("salt,data,hex2bin,%s\n" % salt.hex())
+        f.write("verifier,data,hex2bin,%s\n" % verifier.hex())
+        f.write("code,data,string,%s\n" % args.setup_code)
+        f.write("setup_id,data,string,%s\n" % args.setup_id)
+        f.write("payload,data,string,%s\n" % setup_uri(args.category, args.setup_code, args.setup_id))
+    print("SRP salt %s, %d byte verifier written to %s" % (salt.hex(), len(verifier), csv_path))
+
+    idf_path = os.environ.get("IDF_PATH")
+    if not idf_path:
+        print("IDF_PATH is not set, skipping the partition image", file=sys.stderr)
+        return 1
+
+    nvs_gen = os.path.join(idf_path, "components", "nvs_flash", "nvs_partition_generator", "nvs_partition_gen.py")
+    return subprocess.call([sys.executable, nvs_gen, "generate", csv_path, args.output, args.size])
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,153 @@
+// Runs the optimum start (main/preheat.c) together with the heating controller (main/controller.c) against
+// simulated rooms and measures how late the room reaches the comfort target, with and without preheating.
+//
+// Usage:
+//   preheat_sim [days]
+//
+// The rooms are the ones of tools/sim_common/sim.h, which tools/controller_sim runs the controller in. The target is 21 °C from 6:00 to 22:00 and
+// 18 °C at night, the outside temperature follows a daily cycle and gets colder day by day, so the warm-up
+// takes longer as the simulation goes on. Like the thermostat, the preheat does not know the outside temperature.
+// The exit code is non-zero when preheating does not bring the room to the target within MAX_LATENESS_S of
+// the change on average, or does worse than just heating from the change.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "controller.h"
+#include "preheat.h"
+#include "sim.h"
+
+#define SAMPLE_PERIOD_S 60
+#define LEARNING_DAYS 3          // Left out of the statistics, the warm-up is still being learned
+#define COMFORT_TARGET 21.0f
+#define NIGHT_TARGET 18.0f
+#define COMFORT_FROM_S (6 * 3600)
+#define COMFORT_TO_S (22 * 3600)
+#define MAX_LEAD_S (3 * 3600)
+#define SENSOR_NOISE 0.02        // Standard deviation of the SHT40 readings (in °C)
+#define COOLING_PER_DAY 0.5      // The outside mean drops by this much every day (in °C)
+#define MAX_LATENESS_S 900       // Most the room may reach the comfort target late on average with preheating
+
+typedef struct {
+  double mean_lateness_s;        // Positive when the comfort target was reached late
+  double max_lateness_s;
+  double mean_lead_s;
+  double on_fraction;
+  PreheatStatus status;
+} Result;
+
+static Result simulate(const SimRoom *room, int days, bool use_preheat) {
+  Result result = {0};
+  srand(1);
+  controller_init(SAMPLE_PERIOD_S);
+  preheat_init(NULL);
+
+  SimRoomState state;
+  sim_room_init(&state, room, NIGHT_TARGET);
+  bool relay = false;
+  int mornings = 0;
+  int on_samples = 0;
+  double lateness_sum = 0;
+  double lead_sum = 0;
+  int preheat_started_at = -1;   // Time of day the preheat started today, -1 before
+  bool reached = false;
+  result.max_lateness_s = -INFINITY;
+
+  for (int t = 0; t < days * SIM_DAY_S; t++) {
+    int day = t / SIM_DAY_S;
+    int time_of_day = t % SIM_DAY_S;
+    sim_room_step(&state, t, relay, sim_room_outside(room, t) - COOLING_PER_DAY * day);
+
+    bool counted = day >= LEARNING_DAYS;
+    if (time_of_day == 0) {
+      preheat_started_at = -1;
+      reached = false;
+    }
+
+    // The first time the room gets to the comfort target in the morning
+    if (!reached && preheat_started_at >= 0 && state.air >= COMFORT_TARGET - PREHEAT_ARRIVAL_BAND) {
+      reached = true;
+      double lateness = time_of_day - COMFORT_FROM_S;
+      if (counted) {
+        lateness_sum += lateness;
+        lead_sum += COMFORT_FROM_S - preheat_started_at;
+        mornings++;
+        if (lateness > result.max_lateness_s) {
+          result.max_lateness_s = lateness;
+        }
+      }
+    }
+
+    if (t % SAMPLE_PERIOD_S != SAMPLE_PERIOD_S - 1) {
+      continue;
+    }
+
+    float measured = roundf((float)(state.air + SENSOR_NOISE * sim_gaussian()) * 100) / 100;
+    int next = time_of_day + 1;
+
+    // What the schedule does: start the comfort target early by the lead, once a sample says it is time
+    float target = next >= COMFORT_FROM_S && next < COMFORT_TO_S ? COMFORT_TARGET : NIGHT_TARGET;
+    if (preheat_started_at < 0 && next < COMFORT_FROM_S) {
+      float lead = use_preheat ? preheat_lead(measured, COMFORT_TARGET, NAN, MAX_LEAD_S) : 0;
+      if (lead > 0 && next + lead >= COMFORT_FROM_S) {
+        preheat_started_at = next;
+        preheat_started(day * SIM_DAY_S + COMFORT_FROM_S, COMFORT_TARGET);
+      }
+    }
+    if (preheat_started_at < 0 && next >= COMFORT_FROM_S && next < COMFORT_TO_S) {
+      preheat_started_at = COMFORT_FROM_S;
+    }
+    if (preheat_started_at >= 0 && next < COMFORT_TO_S) {
+      target = COMFORT_TARGET;
+    }
+
+    controller_sample(measured, relay);
+    preheat_sample(t + 1, measured, target, relay, NAN);
+    relay = controller_decide(measured, target, relay).heat;
+    on_samples += counted && relay;
+  }
+
+  int counted_days = days - LEARNING_DAYS;
+  result.mean_lateness_s = lateness_sum / mornings;
+  result.mean_lead_s = lead_sum / mornings;
+  result.on_fraction = (double)on_samples / (counted_days * SIM_DAY_S / SAMPLE_PERIOD_S);
+  result.status = preheat_status();
+
+  sim_room_free(&state);
+  return result;
+}
+
+static void print_result(const char *what, Result r) {
+  printf("  %-10s late by %5.1f min on average, %5.1f min at most, lead %5.1f min, on %4.1f%%\n", what,
+         r.mean_lateness_s / 60, r.max_lateness_s / 60, r.mean_lead_s / 60, r.on_fraction * 100);
+}
+
+int main(int argc, char **argv) {
+  int days = argc > 1 ? atoi(argv[1]) : 14;
+  if (days <= LEARNING_DAYS) {
+    fprintf(stderr, "Simulate more than %d days\n", LEARNING_DAYS);
+    return EXIT_FAILURE;
+  }
+
+  bool passed = true;
+  for (size_t i = 0; i < SIM_ROOMS; i++) {
+    Result plain = simulate(&sim_rooms[i], days, false);
+    Result preheat = simulate(&sim_rooms[i], days, true);
+
+    PreheatStatus s = preheat.status;
+    printf("%s: %d cycles, dead time %.0f min, %.2f C/h at 20 C, duration error %.1f min, arrival error %.1f min rms\n",
+           sim_rooms[i].name, s.cycles, s.dead_time_s / 60, s.rate, s.error_s / 60, s.arrival_rms_s / 60);
+    print_result("at change", plain);
+    print_result("preheat", preheat);
+
+    bool ok = fabs(preheat.mean_lateness_s) < MAX_LATENESS_S && fabs(preheat.mean_lateness_s) < plain.mean_lateness_s;
+    if (!ok) {
+      printf("  FAILED\n");
+      passed = false;
+    }
+  }
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,154 @@
+// Pre-encodes a fixed payload into a QR code and writes it out as a C source file
+// with a packed 1-bpp `lv_img_dsc_t` (LV_IMG_CF_INDEXED_1BIT), so the firmware can show
+// the code straight from rodata without a canvas or running the encoder.
+//
+// Usage:
+//   qrcode_gen text <symbol> <size_px> <payload> <output.c>
+//   qrcode_gen homekit <symbol> <size_px> <category> <setup_code> <setup_id> <output.c>
+//
+// The image is scaled by the largest integer factor that fits into <size_px>
+// including a quiet zone of QR_BORDER modules on each side.
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qrcodegen.h"
+
+#define QR_BORDER 2
+
+// HomeKit setup payload flags (see the HomeKit Accessory Protocol, "Setup Payload")
+#define HOMEKIT_FLAG_IP 2
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage:\n"
+          "  %s text <symbol> <size_px> <payload> <output.c>\n"
+          "  %s homekit <symbol> <size_px> <category> <setup_code> <setup_id> <output.c>\n",
+          prog, prog);
+}
+
+// Builds the "X-HM://" setup URI which the Home app expects in the pairing QR code
+static int homekit_setup_uri(char *buff, size_t buff_size, int category, const char *setup_code, const char *setup_id) {
+  uint64_t code = 0;
+  int digits = 0;
+  for (const char *c = setup_code; *c; c++) {
+    if (isdigit((unsigned char)*c)) {
+      code = code * 10 + (uint64_t)(*c - '0');
+      digits++;
+    } else if (*c != '-') {
+      return -1;
+    }
+  }
+  if (digits != 8 || strlen(setup_id) != 4 || category < 0 || category > 0xFF) {
+    return -1;
+  }
+
+  // version (3 bits) = 0 | reserved (4 bits) = 0 | category (8 bits) | flags (4 bits) | setup code (27 bits)
+  uint64_t payload = ((uint64_t)category << 31) | ((uint64_t)HOMEKIT_FLAG_IP << 27) | code;
+
+  char encoded[10];
+  for (int i = 8; i >= 0; i--) {
+    encoded[i] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"[payload % 36];
+    payload /= 36;
+  }
+  encoded[9] = '\0';
+
+  int len = snprintf(buff, buff_size, "X-HM://%s%s", encoded, setup_id);
+  return (len < 0 || (size_t)len >= buff_size) ? -1 : 0;
+}
+
+static int write_image(const char *path, const char *symbol, int size_px, const char *payload) {
+  uint8_t qr[qrcodegen_BUFFER_LEN_MAX];
+  uint8_t temp[qrcodegen_BUFFER_LEN_MAX];
+
+  // Encoding happens on the build machine, so let it pick the best mask
+  if (!qrcodegen_encodeText(payload, temp, qr, qrcodegen_Ecc_MEDIUM, qrcodegen_VERSION_MIN, qrcodegen_VERSION_MAX,
+                            qrcodegen_Mask_AUTO, true)) {
+    fprintf(stderr, "Payload does not fit into a QR code: %s\n", payload);
+    return -1;
+  }
+
+  int qr_size = qrcodegen_getSize(qr);
+  int modules = qr_size + 2 * QR_BORDER;
+  int scale = size_px / modules;
+  if (scale < 1) {
+    fprintf(stderr, "%d px is too small for a QR code with %d modules\n", size_px, modules);
+    return -1;
+  }
+  int img_size = modules * scale;
+  int row_bytes = (img_size + 7) / 8;
+
+  FILE *out = fopen(path, "w");
+  if (out == NULL) {
+    perror(path);
+    return -1;
+  }
+
+  fprintf(out, "// Generated by tools/qrcode_gen, do not edit.\n");
+  fprintf(out, "// Payload: %s\n\n", payload);
+  fprintf(out, "#include <lvgl.h>\n\n");
+  fprintf(out, "static const uint8_t %s_map[] = {\n", symbol);
+  fprintf(out, "  0x00, 0x00, 0x00, 0xff, /* Color of index 0 (dark) */\n");
+  fprintf(out, "  0xff, 0xff, 0xff, 0xff, /* Color of index 1 (light) */\n");
+
+  for (int y = 0; y < img_size; y++) {
+    int my = y / scale - QR_BORDER;
+    fprintf(out, " ");
+    for (int b = 0; b < row_bytes; b++) {
+      uint8_t byte = 0;
+      for (int bit = 0; bit < 8; bit++) {
+        int x = b * 8 + bit;
+        int mx = x / scale - QR_BORDER;
+        // Bit set = light. Padding bits past the image width and the quiet zone stay light.
+        bool dark = x < img_size && qrcodegen_getModule(qr, mx, my);
+        if (!dark) {
+          byte |= (uint8_t)(0x80 >> bit);
+        }
+      }
+      fprintf(out, " 0x%02x,", byte);
+    }
+    fprintf(out, "\n");
+  }
+
+  fprintf(out, "};\n\n");
+  fprintf(out, "const lv_img_dsc_t %s = {\n", symbol);
+  fprintf(out, "  .header.cf = LV_IMG_CF_INDEXED_1BIT,\n");
+  fprintf(out, "  .header.always_zero = 0,\n");
+  fprintf(out, "  .header.reserved = 0,\n");
+  fprintf(out, "  .header.w = %d,\n", img_size);
+  fprintf(out, "  .header.h = %d,\n", img_size);
+  fprintf(out, "  .data_size = sizeof(%s_map),\n", symbol);
+  fprintf(out, "  .data = %s_map,\n", symbol);
+  fprintf(out, "};\n");
+
+  if (fclose(out) != 0) {
+    perror(path);
+    return -1;
+  }
+
+  printf("QR code %s: version %d, %dx%d px (%d px per module), %d bytes\n", symbol, (qr_size - 17) / 4, img_size,
+         img_size, scale, 8 + row_bytes * img_size);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc == 6 && strcmp(argv[1], "text") == 0) {
+    return write_image(argv[5], argv[2], atoi(argv[3]), argv[4]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (argc == 8 && strcmp(argv[1], "homekit") == 0) {
+    char uri[32];
+    if (homekit_setup_uri(uri, sizeof(uri), atoi(argv[4]), argv[5], argv[6]) != 0) {
+      fprintf(stderr, "Invalid HomeKit setup data (expected setup code XXX-XX-XXX and a 4 character setup ID)\n");
+      return EXIT_FAILURE;
+    }
+    return write_image(argv[7], argv[2], atoi(argv[3]), uri) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  usage(argv[0]);
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,77 @@
+// Measures what a 32-byte key costs wolfCrypt's callers with a DRBG of their own and with the shared one of
+// main/rng.c, on the host.
+//
+// Usage:
+//   rng_bench [rounds]
+//
+// main/rng.c is built as it is, with the library's RNG calls wrapped at link time like on the device, against
+// stand-ins for the few ESP-IDF and FreeRTOS calls it makes (stubs/). rng_init() logs a single measurement, like
+// it does on the device, then the average over all rounds is printed. The host is much faster than the ESP32-C6,
+// so only the ratio carries over. The exit code is non-zero when borrowing is not faster.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/random.h>
+
+#include "esp_timer.h"
+#include "rng.h"
+
+#define KEY_SIZE 32
+
+int __real_wc_InitRng(WC_RNG *rng);
+int __real_wc_RNG_GenerateBlock(WC_RNG *rng, byte *output, word32 sz);
+int __real_wc_FreeRng(WC_RNG *rng);
+
+// What every SRP, Ed25519 and X25519 key and HAP nonce did before main/rng.c
+static int key_fresh(byte *key) {
+  WC_RNG rng;
+  int r = __real_wc_InitRng(&rng);
+  if (!r) {
+    r = __real_wc_RNG_GenerateBlock(&rng, key, KEY_SIZE);
+    __real_wc_FreeRng(&rng);
+  }
+  return r;
+}
+
+// The same calls as the library makes them, which the wrappers turn into a borrow of the shared DRBG
+static int key_borrowed(byte *key) {
+  WC_RNG rng;
+  int r = wc_InitRng(&rng);
+  if (!r) {
+    r = wc_RNG_GenerateBlock(&rng, key, KEY_SIZE);
+    wc_FreeRng(&rng);
+  }
+  return r;
+}
+
+static double average_us(int (*generate)(byte *), int rounds) {
+  byte key[KEY_SIZE];
+  int64_t started = esp_timer_get_time();
+  for (int i = 0; i < rounds; i++) {
+    if (generate(key)) {
+      fprintf(stderr, "Generating a key failed\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  return (double)(esp_timer_get_time() - started) / rounds;
+}
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 10000;
+  if (rounds <= 0) {
+    fprintf(stderr, "Run at least one round\n");
+    return EXIT_FAILURE;
+  }
+
+  if (!rng_init()) {
+    return EXIT_FAILURE;
+  }
+
+  double fresh = average_us(key_fresh, rounds);
+  double borrowed = average_us(key_borrowed, rounds);
+  printf("32-byte key, average of %d: %.2f us with a fresh DRBG, %.2f us with the shared one (%.1fx)\n", rounds, fresh,
+         borrowed, fresh / borrowed);
+
+  return borrowed < fresh ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,11 @@
+// Host stand-ins for the ESP-IDF and FreeRTOS calls of main/rng.c (see rng_bench.c)
+#include <assert.h>
+
+#ifndef RNG_BENCH_ESP_ERR_H
+#define RNG_BENCH_ESP_ERR_H
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_ERROR_CHECK(x) do { esp_err_t err_ = (x); assert(err_ == ESP_OK); (void)err_; } while (0)
+
+#endif
@@ -0,0 +1,10 @@
+#include <stdio.h>
+
+#ifndef RNG_BENCH_ESP_LOG_H
+#define RNG_BENCH_ESP_LOG_H
+
+#define ESP_LOGE(tag, fmt, ...) printf("E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) printf("W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) printf("I %s: " fmt "\n", tag, ##__VA_ARGS__)
+
+#endif
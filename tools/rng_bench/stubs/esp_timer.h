@@ -0,0 +1,34 @@
+#include <stdint.h>
+#include <time.h>
+
+#include "esp_err.h"
+
+#ifndef RNG_BENCH_ESP_TIMER_H
+#define RNG_BENCH_ESP_TIMER_H
+
+static inline int64_t esp_timer_get_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// The reseed timer never fires in the bench, it measures the requests between two reseeds
+typedef struct {
+  void (*callback)(void *arg);
+  const char *name;
+} esp_timer_create_args_t;
+
+typedef const esp_timer_create_args_t *esp_timer_handle_t;
+
+static inline esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle) {
+  *handle = args;
+  return ESP_OK;
+}
+
+static inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t handle, uint64_t period_us) {
+  (void)handle;
+  (void)period_us;
+  return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,12 @@
+#include <stdint.h>
+
+#ifndef RNG_BENCH_FREERTOS_H
+#define RNG_BENCH_FREERTOS_H
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY ((TickType_t)0xffffffff)
+
+#endif
@@ -0,0 +1,32 @@
+#include "FreeRTOS.h"
+
+#ifndef RNG_BENCH_SEMPHR_H
+#define RNG_BENCH_SEMPHR_H
+
+// The bench is single-threaded, the mutex costs what an uncontended one does: nothing worth counting here
+typedef int *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  static int mutex;
+  return &mutex;
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t mux, TickType_t wait) {
+  (void)wait;
+  if (*mux) {
+    return pdFALSE;
+  }
+  *mux = 1;
+  return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t mux) {
+  *mux = 0;
+  return pdTRUE;
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t mux) {
+  (void)mux;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#include "FreeRTOS.h"
+
+#ifndef RNG_BENCH_TASK_H
+#define RNG_BENCH_TASK_H
+
+typedef void *TaskHandle_t;
+
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  static int task;
+  return &task;
+}
+
+static inline TickType_t xTaskGetTickCount(void) {
+  static TickType_t ticks;
+  return ++ticks;
+}
+
+#endif
@@ -0,0 +1,26 @@
+// wolfCrypt for the host, just what the Hash_DRBG needs. The seed comes from /dev/urandom.
+#ifndef RNG_BENCH_USER_SETTINGS_H
+#define RNG_BENCH_USER_SETTINGS_H
+
+#define HAVE_HASHDRBG
+#define SINGLE_THREADED
+#define NO_FILESYSTEM
+#define NO_WOLFSSL_DIR
+#define WOLFCRYPT_ONLY
+#define NO_RSA
+#define NO_DH
+#define NO_DSA
+#define NO_MD4
+#define NO_MD5
+#define NO_SHA
+#define NO_DES3
+#define NO_AES
+#define NO_HMAC
+#define NO_ASN
+#define NO_CODING
+#define NO_PWDBASED
+#define NO_OLD_RNGNAME
+#define WOLFSSL_NO_ASM
+#define NO_INLINE
+
+#endif
@@ -0,0 +1,176 @@
+// Runs the sensor fusion (main/fusion.c) and the filter after it (main/filter.c) against simulated SHT4x sensors
+// with faults, sampling once a minute.
+//
+// Usage:
+//   sensor_sim [days]
+//
+// Every sensor reads the room temperature with some noise and a small offset, rounded to 0.01 °C like the
+// real ones, and fails now and then the way they do on the bus (bad CRC, no answer). Each scenario adds a
+// fault: a sensor warmed by the display, one that drops off the bus for a while, one that spikes.
+// The exit code is non-zero when the fused temperature strays from the room temperature or is missing
+// while a sensor without faults answered. A lone reading cannot be checked against another sensor, so the fusion
+// may pass a spike through then; the largest error is checked after the filter, which has to hold it back.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "filter.h"
+#include "fusion.h"
+#include "sim.h"
+
+#define SAMPLE_PERIOD_S 60
+#define MAX_RMS_ERROR 0.1        // Fused temperature vs room temperature (in °C)
+#define MAX_ERROR 0.5
+#define FILTER_MEDIAN 3          // The defaults of menuconfig
+#define FILTER_TAU_S 60
+#define FILTER_MAX_RATE (0.5f / 60)
+
+typedef struct {
+  double noise;                  // Standard deviation of the readings (in °C)
+  double offset;
+  double failure_rate;           // Share of the reads that fail
+  double spike_rate;             // Share of the reads that are off by `spike`
+  double spike;
+  double drift_per_day;          // Reads warmer and warmer, e.g. next to the display (in °C a day)
+  int offline_from_s;            // Does not answer from this time ...
+  int offline_to_s;              // ... until this one
+} SimSensor;
+
+typedef struct {
+  const char *name;
+  int count;
+  SimSensor sensors[FUSION_MAX_SENSORS];
+} Scenario;
+
+static const Scenario scenarios[] = {
+  {"one sensor, bad CRC now and then", 1, {{.noise = 0.03, .failure_rate = 0.01}}},
+  {"two sensors, one spiking", 2,
+   {{.noise = 0.03, .offset = 0.05, .failure_rate = 0.01},
+    {.noise = 0.03, .offset = -0.05, .failure_rate = 0.01, .spike_rate = 0.02, .spike = 4.0}}},
+  {"three sensors, one warmed by the display", 3,
+   {{.noise = 0.03, .offset = 0.05, .failure_rate = 0.01},
+    {.noise = 0.03, .offset = -0.05, .failure_rate = 0.01},
+    {.noise = 0.03, .failure_rate = 0.01, .drift_per_day = 1.5}}},
+  {"three sensors, one off the bus for 6 hours", 3,
+   {{.noise = 0.03, .offset = 0.05, .failure_rate = 0.01},
+    {.noise = 0.03, .offset = -0.05, .failure_rate = 0.01},
+    {.noise = 0.03, .failure_rate = 0.01, .offline_from_s = SIM_DAY_S / 2, .offline_to_s = SIM_DAY_S / 2 + 6 * 3600}}},
+  {"four sensors, one spiking, one drifting", 4,
+   {{.noise = 0.03, .offset = 0.05, .failure_rate = 0.01},
+    {.noise = 0.03, .offset = -0.05, .failure_rate = 0.01},
+    {.noise = 0.03, .failure_rate = 0.01, .spike_rate = 0.05, .spike = -3.0},
+    {.noise = 0.03, .failure_rate = 0.01, .drift_per_day = 2.0}}},
+};
+
+static double uniform(void) {
+  return rand() / (RAND_MAX + 1.0);
+}
+
+static bool simulate(const Scenario *scenario, int days) {
+  srand(1);
+  fusion_init(scenario->count);
+  Filter filter;
+  filter_init(&filter, FILTER_MEDIAN, FILTER_TAU_S, FILTER_MAX_RATE);
+
+  int samples = 0;
+  int missing = 0;
+  int missing_with_reading = 0;
+  int lone = 0;
+  double error_sum = 0;
+  double max_error = 0;
+  double filtered_error_sum = 0;
+  double filtered_max_error = 0;
+
+  for (int t = 0; t < days * SIM_DAY_S; t += SAMPLE_PERIOD_S) {
+    double room = 20 + 1.5 * sin(2 * M_PI * t / SIM_DAY_S) + 0.3 * sin(2 * M_PI * t / 5400.0);
+    SensorSample readings[FUSION_MAX_SENSORS] = {0};
+    bool working_reading = false;
+    int answered = 0;
+
+    for (int i = 0; i < scenario->count; i++) {
+      const SimSensor *s = &scenario->sensors[i];
+      SensorSample *r = &readings[i];
+      r->latency_us = 800 + (uint32_t)(uniform() * 400);
+
+      if (!fusion_due(i)) {
+        r->read = SENSOR_READ_SKIPPED;
+        continue;
+      }
+      bool offline = t >= s->offline_from_s && t < s->offline_to_s;
+      if (offline || uniform() < s->failure_rate) {
+        r->read = SENSOR_READ_FAILED;
+        continue;
+      }
+
+      double temp = room + s->offset + s->noise * sim_gaussian() + s->drift_per_day * t / SIM_DAY_S;
+      if (uniform() < s->spike_rate) {
+        temp += s->spike;
+      }
+      r->read = SENSOR_READ_OK;
+      r->temperature = roundf((float)temp * 100) / 100;
+      r->humidity = 45;
+      answered++;
+      working_reading |= s->spike_rate == 0 && s->drift_per_day == 0;
+    }
+
+    SensorFused fused = fusion_update(readings);
+    samples++;
+    if (!fused.valid) {
+      missing++;
+      missing_with_reading += working_reading;
+      continue;
+    }
+
+    double filtered = filter_add(&filter, fused.temperature, SAMPLE_PERIOD_S);
+    double fe = fabs(filtered - room);
+    filtered_error_sum += fe * fe;
+    if (fe > filtered_max_error) {
+      filtered_max_error = fe;
+    }
+
+    double e = fabs(fused.temperature - room);
+    error_sum += e * e;
+    if (answered < 2 && scenario->count > 1) {
+      lone++;
+    } else if (e > max_error) {
+      max_error = e;
+    }
+  }
+
+  double rms = sqrt(error_sum / (samples - missing));
+  double filtered_rms = sqrt(filtered_error_sum / (samples - missing));
+  printf("%s: rms %.3f C, max %.3f C, missing %d of %d, lone %d\n", scenario->name, rms, max_error, missing, samples,
+         lone);
+  printf("  filtered: rms %.3f C, max %.3f C, held %lu, delay %.0f s\n", filtered_rms, filtered_max_error,
+         (unsigned long)filter.held, filter_delay_s(&filter));
+  for (int i = 0; i < scenario->count; i++) {
+    const SensorStatus *s = fusion_status(i);
+    printf("  sensor %d: %-8s reads %5lu failures %4lu outliers %5lu deviation %.2f C latency %lu us (max %lu us)\n", i,
+           fusion_health_str(s->health), (unsigned long)s->reads, (unsigned long)s->failures,
+           (unsigned long)s->outliers, s->deviation, (unsigned long)s->latency_avg_us,
+           (unsigned long)s->latency_max_us);
+  }
+
+  bool ok = rms < MAX_RMS_ERROR && missing_with_reading == 0 && filtered_rms < MAX_RMS_ERROR &&
+            filtered_max_error < MAX_ERROR;
+  if (!ok) {
+    printf("  FAILED\n");
+  }
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  int days = argc > 1 ? atoi(argv[1]) : 3;
+  if (days < 1) {
+    fprintf(stderr, "Simulate at least a day\n");
+    return EXIT_FAILURE;
+  }
+
+  bool passed = true;
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    passed &= simulate(&scenarios[i], days);
+  }
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,77 @@
+// Shared by the host simulations in tools/: the noise of the simulated sensors and the rooms the heating is
+// simulated in. Header only, every sim builds it into its own executable.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifndef SIM_H
+#define SIM_H
+
+#define SIM_DAY_S (24 * 3600)
+
+// Normally distributed, with mean 0 and standard deviation 1 (Box-Muller on rand(), so srand() repeats a run)
+static inline double sim_gaussian(void) {
+  double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+  double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+// A radiator node heats an air node, which loses heat to the outside, so the controller's first-order model never
+// matches it exactly. The boiler output reaches the radiator after a delay.
+typedef struct {
+  const char *name;
+  double supply_temp;            // Boiler flow temperature
+  double supply_rate;            // 1/s, how fast the radiator approaches the flow temperature
+  double radiator_rate;          // 1/s, radiator to room heat transfer as seen by the radiator
+  double room_rate;              // 1/s, radiator to room heat transfer as seen by the room
+  double loss_rate;              // 1/s, room to outside
+  int boiler_delay_s;            // Time until the hot water reaches the radiator
+  double outside_mean;
+  double outside_swing;          // Amplitude of the daily cycle, the coldest at 3:00
+} SimRoom;
+
+static const SimRoom sim_rooms[] = {
+  {"panel radiators, insulated house", 60, 1.0 / 600, 1.0 / 900, 1.0 / 30000, 1.0 / 90000, 120, 5, 4},
+  {"cast iron radiators, 8 min delay", 65, 1.0 / 1200, 1.0 / 1800, 1.0 / 40000, 1.0 / 100000, 480, 0, 3},
+  {"small room, fast radiator", 55, 1.0 / 300, 1.0 / 600, 1.0 / 25000, 1.0 / 40000, 60, 8, 5},
+};
+
+#define SIM_ROOMS (sizeof(sim_rooms) / sizeof(sim_rooms[0]))
+
+typedef struct {
+  const SimRoom *room;
+  bool *boiler;                  // Relay states on their way to the radiator, one a second
+  double radiator;
+  double air;
+} SimRoomState;
+
+static inline void sim_room_init(SimRoomState *state, const SimRoom *room, double air) {
+  state->room = room;
+  state->boiler = calloc(room->boiler_delay_s + 1, sizeof(bool));
+  state->radiator = room->outside_mean + 10;
+  state->air = air;
+}
+
+static inline void sim_room_free(SimRoomState *state) {
+  free(state->boiler);
+}
+
+// The outside temperature at `t` seconds from the start
+static inline double sim_room_outside(const SimRoom *room, int t) {
+  return room->outside_mean + room->outside_swing * sin(2 * M_PI * (t - 9 * 3600) / SIM_DAY_S);
+}
+
+// Moves the room on by a second at `t`, with the relay as it is now
+static inline void sim_room_step(SimRoomState *state, int t, bool relay, double outside) {
+  const SimRoom *room = state->room;
+  bool delayed = state->boiler[t % (room->boiler_delay_s + 1)];
+  state->boiler[t % (room->boiler_delay_s + 1)] = relay;
+
+  double to_room = state->radiator - state->air;
+  state->radiator += (delayed ? room->supply_rate * (room->supply_temp - state->radiator) : 0) -
+                     room->radiator_rate * to_room;
+  state->air += room->room_rate * to_room - room->loss_rate * (state->air - outside);
+}
+
+#endif
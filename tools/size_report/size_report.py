@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Per-object flash/RAM usage from a GNU ld link map.
+
+`idf.py size-components` stops at archive granularity, which hides what a
+crypto profile actually pulls in. This walks the memory map section of
+build/main.map and sums every input section per archive member.
+
+Usage:
+    size_report.py [--filter REGEX] [--limit N] [build/main.map]
+"""
+
+import argparse
+import re
+import sys
+from collections import defaultdict
+
+# Input section followed by address, size and the object it came from. Long
+# section names push the rest onto the next line, which is joined beforehand.
+SECTION_RE = re.compile(r"^ (\.\S+|COMMON)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+MEMBER_RE = re.compile(r"(?:.*/)?([^/]+\.a)\((.+)\)$")
+
+CATEGORIES = (
+    ("text", (".text", ".iram", ".literal", ".flash.text")),
+    ("rodata", (".rodata", ".flash.rodata", ".srodata")),
+    ("data", (".data", ".sdata", ".dram")),
+    ("bss", (".bss", ".sbss", "COMMON", ".noinit")),
+)
+
+
+def category(section):
+    for name, prefixes in CATEGORIES:
+        if section.startswith(prefixes):
+            return name
+    return None
+
+
+def parse(path):
+    sizes = defaultdict(lambda: defaultdict(int))
+    with open(path) as f:
+        lines = iter(f.read().splitlines())
+
+    # Skip the archive list and discarded sections
+    for line in lines:
+        if line.startswith("Linker script and memory map"):
+            break
+
+    pending = None
+    for line in lines:
+        if pending is not None:
+            line = pending + " " + line.strip()
+            pending = None
+        elif re.match(r"^ (\.\S+|COMMON)$", line):
+            pending = line
+            continue
+
+        m = SECTION_RE.match(line)
+        if not m:
+            continue
+        section, addr, size, origin = m.groups()
+        size = int(size, 16)
+        cat = category(section)
+        if size == 0 or cat is None or int(addr, 16) == 0:
+            continue
+
+        member = MEMBER_RE.match(origin.strip())
+        key = "%s:%s" % member.groups() if member else origin.strip().rsplit("/", 1)[-1]
+        sizes[key][cat] += size
+    return sizes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", nargs="?", default="build/main.map")
+    parser.add_argument("--filter", help="only objects matching this regex, e.g. libwolfssl")
+    parser.add_argument("--limit", type=int, default=0, help="show only the N largest objects")
+    args = parser.parse_args()
+
+    sizes = parse(args.map)
+    if args.filter:
+        pattern = re.compile(args.filter)
+        sizes = {k: v for k, v in sizes.items() if pattern.search(k)}
+
+    rows = sorted(sizes.items(), key=lambda kv: -(kv[1]["text"] + kv[1]["rodata"] + kv[1]["data"]))
+    if args.limit:
+        rows = rows[:args.limit]
+
+    names = [name for name, _ in CATEGORIES]
+    width = max([len(k) for k, _ in rows] + [len("Object")])
+    print("%-*s %8s %8s %8s %8s %8s" % (width, "Object", *names, "flash"))
+    total = defaultdict(int)
+    for key, s in rows:
+        flash = s["text"] + s["rodata"] + s["data"]
+        print("%-*s %8d %8d %8d %8d %8d" % (width, key, *(s[n] for n in names), flash))
+        for n in names:
+            total[n] += s[n]
+    flash = total["text"] + total["rodata"] + total["data"]
+    print("%-*s %8d %8d %8d %8d %8d" % (width, "Total", *(total[n] for n in names), flash))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())